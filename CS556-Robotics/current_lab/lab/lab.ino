@@ -6,10 +6,24 @@
 #include "robot/actuators/servo_controller.h"
 #include "robot/display/display.h"
 #include "robot/drivetrain/differential_drive.h"
+#include "robot/drivetrain/motion_queue.h"
+#include "robot/drivetrain/motor_calibration.h"
+#include "robot/drivetrain/velocity_controller.h"
+#include "robot/drivetrain/velocity_profile.h"
 #include "robot/navigator/navigator.h"
 #include "robot/navigator/navigator_tests.h"
+#include "robot/navigator/path_follower.h"
+#include "robot/navigator/pose_history.h"
+#include "robot/odometer/heading_estimator.h"
 #include "robot/odometer/odometry.h"
+#include "robot/odometer/odometry_calibration.h"
+#include "robot/odometer/pose_integration.h"
+#include "robot/sensors/encoder_service.h"
 #include "robot/sensors/sonar.h"
+#include "robot/sensors/sonar_filter.h"
+#include "robot/sensors/wheel_velocity.h"
+#include "robot/utils/control_timer.h"
+#include "robot/utils/eeprom_layout.h"
 #include "robot/utils/logger.h"
 #include "robot/utils/util.h"
 #include "robot/robot.h"
@@ -19,10 +33,23 @@
 #include "robot/actuators/servo_controller.cpp"
 #include "robot/display/display.cpp"
 #include "robot/drivetrain/differential_drive.cpp"
+#include "robot/drivetrain/motion_queue.cpp"
+#include "robot/drivetrain/motor_calibration.cpp"
+#include "robot/drivetrain/velocity_controller.cpp"
+#include "robot/drivetrain/velocity_profile.cpp"
 #include "robot/navigator/navigator.cpp"
 #include "robot/navigator/navigator_tests.cpp"
+#include "robot/navigator/path_follower.cpp"
+#include "robot/navigator/pose_history.cpp"
+#include "robot/odometer/heading_estimator.cpp"
 #include "robot/odometer/odometry.cpp"
+#include "robot/odometer/odometry_calibration.cpp"
+#include "robot/odometer/pose_integration.cpp"
+#include "robot/sensors/encoder_service.cpp"
 #include "robot/sensors/sonar.cpp"
+#include "robot/sensors/sonar_filter.cpp"
+#include "robot/sensors/wheel_velocity.cpp"
+#include "robot/utils/control_timer.cpp"
 #include "robot/utils/logger.cpp"
 #include "robot/utils/util.cpp"
 #include "robot/robot.cpp"
@@ -40,6 +67,7 @@ Robot robot = Robot();
 void setup() {
   Logger::configure(BAUD_RATE, LogLevel::INFO);
   robot.drive->configure();
+  robot.navigator->configure();
 
   delay(20);
 }
@@ -52,4 +80,19 @@ void loop() {
   //test_3_2a_straight_line_15m();
   //test_3_2b_square_clockwise();
   //test_3_2e_square_counter_clockwise();
+  //test_3_2b_square_clockwise_queued();
+  //test_3_2e_square_counter_clockwise_queued();
+  //test_4_1_pure_pursuit_square();
+  //test_4_2_control_tick_jitter();
+  //test_4_3a_odometry_kernel_benchmark();
+  //test_4_3b_odometry_kernel_drift_square();
+  //test_4_4_imu_heading_square();
+  //test_4_5_pose_covariance_square();
+  //test_4_6_encoder_service_sampling();
+  //test_4_7_umbmark_calibration();
+  //test_4_8_pose_history_sonar();
+  //test_4_9_record_replay_log();
+  //test_4_10_wheel_velocity_estimator();
+  //test_4_11_async_sonar_while_driving();
+  //test_4_12_adaptive_sonar_schedule();
 }
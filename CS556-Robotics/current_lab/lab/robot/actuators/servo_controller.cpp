@@ -8,9 +8,19 @@
 ServoController::ServoController() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Initialized");
   current_angle = DEFAULT_SERVO_ANGLE;
+  current_pulse_us = 0;
   pin = DEFAULT_SERVO_PIN;
   speed_degrees_per_sec = DEFAULT_SERVO_SPEED;
   attached = false;
+  motion = ServoMotion::IDLE;
+  leg_start_angle = DEFAULT_SERVO_ANGLE;
+  leg_target_angle = DEFAULT_SERVO_ANGLE;
+  leg_start_us = 0;
+  leg_duration_us = 0;
+  sweep_min_angle = MIN_SERVO_ANGLE;
+  sweep_max_angle = MAX_SERVO_ANGLE;
+  sweep_legs_remaining = 0;
+  sweep_forever = false;
 }
 
 // ========== CONFIGURATION ==========
@@ -39,8 +49,9 @@ void ServoController::attach(int pin) {
   }
   
   this->pin = pin;
-  servo.attach(pin);
+  servo.attach(pin, SERVO_MIN_PULSE_US, SERVO_MAX_PULSE_US);
   attached = true;
+  current_pulse_us = 0;
   
   // Small delay to let servo stabilize
   delay(DEFAULT_SETTLING_TIME_MS);
@@ -52,6 +63,7 @@ void ServoController::detach() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Detaching servo");
   
   if (attached) {
+    motion = ServoMotion::IDLE;
     servo.detach();
     attached = false;
   } else {
@@ -92,14 +104,14 @@ void ServoController::set_angle(int angle) {
   }
   
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("Setting angle to " + String(constrained) + "°").c_str());
-  servo.write(constrained);
-  current_angle = constrained;
+  motion = ServoMotion::IDLE;
+  write_angle(constrained);
   
   delay(DEFAULT_SERVO_STEP_DELAY);
 }
 
 int ServoController::get_angle() {
-  return current_angle;
+  return (int)(current_angle + 0.5f);
 }
 
 void ServoController::move_to_angle(int target_angle) {
@@ -109,16 +121,10 @@ void ServoController::move_to_angle(int target_angle) {
   }
   
   int target = constrain_angle(target_angle);
-  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Moving from " + String(current_angle) + "° to " + String(target) + "°").c_str());
-  
-  int step_delay = calculate_step_delay();
-  int direction = (target > current_angle) ? 1 : -1;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Moving from " + String(get_angle()) + "° to " + String(target) + "°").c_str());
   
-  // Move one degree at a time for smooth motion
-  while (current_angle != target) {
-    current_angle += direction;
-    servo.write(current_angle);
-    delay(step_delay);
+  start_move_to_angle(target, duration_at_speed_us(current_angle, target) / 1000);
+  while (poll()) {
   }
   
   // Extra settling time at final position
@@ -146,6 +152,38 @@ void ServoController::move_to_max() {
 void ServoController::sweep(int min_angle, int max_angle, int num_sweeps) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweeping between " + String(min_angle) + "° and " + String(max_angle) + "° for " + String(num_sweeps) + " cycles").c_str());
   
+  start_sweep(min_angle, max_angle, num_sweeps);
+}
+
+void ServoController::sweep_full_range(int num_sweeps) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweeping full range for " + String(num_sweeps) + " cycles").c_str());
+  sweep(MIN_SERVO_ANGLE, MAX_SERVO_ANGLE, num_sweeps);
+}
+
+// ========== NON-BLOCKING MOTION ENGINE ==========
+
+bool ServoController::start_move_to_angle(float target_angle, unsigned long duration_ms) {
+  if (!attached) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Servo not attached");
+    return false;
+  }
+  
+  float target = constrain(target_angle, (float)MIN_SERVO_ANGLE, (float)MAX_SERVO_ANGLE);
+  motion = ServoMotion::MOVING;
+  start_leg(current_angle, target, micros(), duration_ms * 1000UL);
+  return true;
+}
+
+bool ServoController::start_sweep(int min_angle, int max_angle, int num_sweeps) {
+  if (!attached) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Servo not attached");
+    return false;
+  }
+  if (num_sweeps < 0) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid num_sweeps (must be 0 or more)");
+    return false;
+  }
+  
   int constrained_min = constrain_angle(min_angle);
   int constrained_max = constrain_angle(max_angle);
   
@@ -155,19 +193,60 @@ void ServoController::sweep(int min_angle, int max_angle, int num_sweeps) {
     constrained_min = constrained_max;
     constrained_max = temp;
   }
+  if (constrained_min == constrained_max) {
+    // Nothing to sweep; legs of zero length would never end.
+    return start_move_to_angle(constrained_min, duration_at_speed_us(current_angle, constrained_min) / 1000);
+  }
+  
+  sweep_min_angle = constrained_min;
+  sweep_max_angle = constrained_max;
+  sweep_forever = num_sweeps == 0;
+  sweep_legs_remaining = 2 * num_sweeps - 1;
+  motion = ServoMotion::SWEEPING;
+  start_leg(current_angle, sweep_max_angle, micros(), duration_at_speed_us(current_angle, sweep_max_angle));
+  return true;
+}
+
+bool ServoController::poll() {
+  if (motion == ServoMotion::IDLE) {
+    return false;
+  }
   
-  for (int i = 0; i < num_sweeps; i++) {
-    Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweep cycle " + String(i + 1) + "/" + String(num_sweeps)).c_str());
-    move_to_angle(constrained_max);
-    move_to_angle(constrained_min);
+  unsigned long elapsed_us = micros() - leg_start_us;
+  while (elapsed_us >= leg_duration_us) {
+    // Leg finished: stop, or chain the next sweep leg onto its end time.
+    if (motion == ServoMotion::MOVING || (!sweep_forever && sweep_legs_remaining <= 0)) {
+      write_angle(leg_target_angle);
+      motion = ServoMotion::IDLE;
+      return false;
+    }
+    sweep_legs_remaining--;
+    float next = leg_target_angle == sweep_max_angle ? sweep_min_angle : sweep_max_angle;
+    unsigned long next_start_us = leg_start_us + leg_duration_us;
+    elapsed_us -= leg_duration_us;
+    start_leg(leg_target_angle, next, next_start_us, duration_at_speed_us(leg_target_angle, next));
   }
   
-  Logger::log_info(CLASS_NAME, __FUNCTION__, "Sweep complete");
+  float fraction = (float)elapsed_us / (float)leg_duration_us;
+  float eased = fraction * fraction * (3.0f - 2.0f * fraction);
+  write_angle(leg_start_angle + eased * (leg_target_angle - leg_start_angle));
+  return true;
 }
 
-void ServoController::sweep_full_range(int num_sweeps) {
-  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweeping full range for " + String(num_sweeps) + " cycles").c_str());
-  sweep(MIN_SERVO_ANGLE, MAX_SERVO_ANGLE, num_sweeps);
+void ServoController::stop() {
+  motion = ServoMotion::IDLE;
+}
+
+bool ServoController::is_moving() {
+  return motion != ServoMotion::IDLE;
+}
+
+ServoMotion ServoController::get_motion() {
+  return motion;
+}
+
+float ServoController::get_commanded_angle() {
+  return current_angle;
 }
 
 // ========== UTILITY FUNCTIONS ==========
@@ -187,15 +266,22 @@ int ServoController::constrain_angle(int angle) {
 
 // ========== PRIVATE HELPER FUNCTIONS ==========
 
-int ServoController::calculate_step_delay() {
-  // Calculate delay between 1-degree steps based on speed setting
-  // speed_degrees_per_sec degrees/second → delay = 1000 / speed_degrees_per_sec ms/degree
-  int delay_ms = 1000 / speed_degrees_per_sec;
-  
-  // Ensure minimum delay for servo stability
-  if (delay_ms < DEFAULT_SERVO_STEP_DELAY) {
-    delay_ms = DEFAULT_SERVO_STEP_DELAY;
+void ServoController::write_angle(float angle) {
+  current_angle = angle;
+  int pulse_us = SERVO_MIN_PULSE_US + (int)(angle * (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US) / MAX_SERVO_ANGLE + 0.5f);
+  if (pulse_us != current_pulse_us) {
+    servo.writeMicroseconds(pulse_us);
+    current_pulse_us = pulse_us;
   }
-  
-  return delay_ms;
+}
+
+void ServoController::start_leg(float from, float target, unsigned long start_us, unsigned long duration_us) {
+  leg_start_angle = from;
+  leg_target_angle = target;
+  leg_start_us = start_us;
+  leg_duration_us = duration_us;
+}
+
+unsigned long ServoController::duration_at_speed_us(float from, float to) {
+  return (unsigned long)(fabs(to - from) * 1.0e6f / speed_degrees_per_sec);
 }
@@ -36,6 +36,18 @@ using namespace Pololu3piPlus32U4;
 //   - Angle (degrees) = 0 to 180
 //   - Pulse width (ms) = 1.0 + (angle / 180) * 1.0
 //   - PWM frequency: 50Hz (20ms period)
+//   - The Servo library's write() maps 0-180° to 544-2400μs; this class
+//     uses the same map through writeMicroseconds(), ~10μs per degree, so
+//     angles are commanded to ~0.1° instead of whole degrees
+//
+// Trajectories:
+//   start_move_to_angle() and start_sweep() only set up a motion; poll(),
+//   called every pass of loop() like DifferentialDrive::poll(), evaluates
+//   the angle for the current time and writes it when the pulse width
+//   changes. Each leg follows a smoothstep profile, 3s^2 - 2s^3 of the
+//   elapsed fraction s, so the servo starts and stops without a jolt
+//   (peak speed 1.5x the average). Sweep legs are chained back to back on
+//   the same time base, so a sweep does not drift.
 //
 // Common Applications:
 //   - Sensor panning and tilting
@@ -56,6 +68,15 @@ const int MAX_SERVO_ANGLE = 180;           // Maximum angle (degrees)
 const int DEFAULT_SERVO_SPEED = 60;        // Default speed in degrees/second
 const int DEFAULT_SERVO_STEP_DELAY = 15;   // Delay between steps in ms
 const int DEFAULT_SETTLING_TIME_MS = 200;  // Time for servo to reach position
+const int SERVO_MIN_PULSE_US = 544;        // Pulse width at 0° (Servo library default)
+const int SERVO_MAX_PULSE_US = 2400;       // Pulse width at 180° (Servo library default)
+
+// What the servo is doing
+enum class ServoMotion {
+  IDLE,                  // Holding the commanded angle
+  MOVING,                // Single move to a target
+  SWEEPING               // Back and forth between two angles
+};
 
 class ServoController : public Configurable {
   public:
@@ -112,14 +133,14 @@ class ServoController : public Configurable {
     void set_angle(int angle);
     
     // Purpose: Get current servo angle
-    // Description: Returns the last commanded angle
+    // Description: Returns the last commanded angle, rounded
     // Args: None
     // Return: int - current angle in degrees
     int get_angle();
     
     // Purpose: Move servo to angle with smooth transition
-    // Description: Gradually moves servo to target angle at set speed
-    //   Blocks until movement is complete
+    // Description: Runs start_move_to_angle() at the set speed, then waits
+    //   for the servo to settle. Blocks until movement is complete
     // Args: target_angle - target angle in degrees (0-180)
     // Return: void
     void move_to_angle(int target_angle);
@@ -145,19 +166,72 @@ class ServoController : public Configurable {
     // ========== SWEEP FUNCTIONS ==========
     
     // Purpose: Sweep servo back and forth between two angles
-    // Description: Continuously moves between min and max angles
+    // Description: Starts a background sweep (see start_sweep()) and returns;
+    //   keep calling poll() and read get_commanded_angle() for the direction
     // Args: min_angle - minimum angle for sweep (0-180)
     //       max_angle - maximum angle for sweep (0-180)
-    //       num_sweeps - number of complete back-and-forth cycles
+    //       num_sweeps - number of complete back-and-forth cycles, 0 = until stop()
     // Return: void
     void sweep(int min_angle, int max_angle, int num_sweeps);
     
     // Purpose: Sweep servo across full range
-    // Description: Sweeps from 0° to 180° and back
-    // Args: num_sweeps - number of complete cycles
+    // Description: Starts a background sweep from 0° to 180° and back
+    // Args: num_sweeps - number of complete cycles, 0 = until stop()
     // Return: void
     void sweep_full_range(int num_sweeps);
     
+    // ========== NON-BLOCKING MOTION ENGINE ==========
+    //
+    // Each start_* function sets up a trajectory and returns immediately. The
+    // caller then calls poll() from its loop until it returns false.
+    //
+    //   robot.servo->start_sweep(45, 135, 0);
+    //   while (...) {
+    //     robot.servo->poll();
+    //     float angle = robot.servo->get_commanded_angle();
+    //   }
+    
+    // Purpose: Start a timed move to an angle without blocking
+    // Args: target_angle - target angle in degrees (0-180, fractions allowed)
+    //       duration_ms - time for the move, 0 = jump there on the next poll()
+    // Return: bool - true if the motion was started, false if not attached
+    bool start_move_to_angle(float target_angle, unsigned long duration_ms);
+    
+    // Purpose: Start a sweep between two angles without blocking
+    // Description: Moves to max_angle first, then alternates; each leg takes
+    //   |max - min| / speed (the first from the current angle)
+    // Args: min_angle, max_angle - sweep limits in degrees (0-180, either order)
+    //       num_sweeps - complete back-and-forth cycles, 0 = until stop()
+    // Return: bool - true if the sweep was started, false if not attached
+    bool start_sweep(int min_angle, int max_angle, int num_sweeps);
+    
+    // Purpose: Advance the running motion to the current time
+    // Description: Writes the interpolated angle when its pulse width changes.
+    //   Cheap enough to call every pass of loop()
+    // Args: None
+    // Return: bool - true while a motion is still running
+    bool poll();
+    
+    // Purpose: Stop the running motion at the angle commanded last
+    // Args: None
+    // Return: void
+    void stop();
+    
+    // Purpose: Check whether a motion is running
+    // Args: None
+    // Return: bool
+    bool is_moving();
+    
+    // Purpose: Get the running motion
+    // Args: None
+    // Return: ServoMotion
+    ServoMotion get_motion();
+    
+    // Purpose: Get the angle commanded by the last poll()
+    // Args: None
+    // Return: float - angle in degrees, with the fraction
+    float get_commanded_angle();
+    
     // ========== UTILITY FUNCTIONS ==========
     
     // Purpose: Validate angle is within allowed range
@@ -174,16 +248,40 @@ class ServoController : public Configurable {
     
   private:
     Servo servo;                  // Arduino Servo object
-    int current_angle;            // Current servo position in degrees
+    float current_angle;          // Last commanded position in degrees
+    int current_pulse_us;         // Pulse width written for current_angle
     int pin;                      // GPIO pin for servo
     int speed_degrees_per_sec;    // Speed for smooth movements
     bool attached;                // Attachment status
     
-    // Purpose: Calculate delay between steps for smooth movement
-    // Description: Computes step delay based on speed setting
-    // Args: None
-    // Return: int - delay in milliseconds
-    int calculate_step_delay();
+    ServoMotion motion;           // Running motion
+    float leg_start_angle;        // Angle at the start of the current leg
+    float leg_target_angle;       // Angle at the end of the current leg
+    unsigned long leg_start_us;   // micros() the current leg started
+    unsigned long leg_duration_us;
+    float sweep_min_angle;        // Sweep limits
+    float sweep_max_angle;
+    int sweep_legs_remaining;     // Legs after the current one (sweeps only)
+    bool sweep_forever;           // Sweep until stop()
+    
+    // Purpose: Command an angle through writeMicroseconds()
+    // Args: angle - degrees, already within limits
+    // Return: void
+    void write_angle(float angle);
+    
+    // Purpose: Begin a leg of the current motion at the given time
+    // Args: from - leg start angle
+    //       target - leg end angle
+    //       start_us - micros() the leg starts
+    //       duration_us - leg duration
+    // Return: void
+    void start_leg(float from, float target, unsigned long start_us, unsigned long duration_us);
+    
+    // Purpose: Time for a move between two angles at the set speed
+    // Args: from, to - angles in degrees
+    // Return: unsigned long - duration in microseconds
+    unsigned long duration_at_speed_us(float from, float to);
+
 };
 
 #endif
@@ -83,12 +83,16 @@ void test_servo_sweep() {
   // Sweep a limited range
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweeping 45° to 135° for " + String(TEST_SWEEP_CYCLES) + " cycles").c_str());
   robot.servo->sweep(45, 135, TEST_SWEEP_CYCLES);
+  while (robot.servo->poll()) {
+  }
   
   delay(1000);
   
   // Sweep full range
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Sweeping full range for " + String(TEST_SWEEP_CYCLES) + " cycles").c_str());
   robot.servo->sweep_full_range(TEST_SWEEP_CYCLES);
+  while (robot.servo->poll()) {
+  }
   
   // Return to center
   robot.servo->center();
@@ -120,6 +124,29 @@ void test_servo_speed_control() {
   delay(1000);
 }
 
+void test_servo_background_sweep() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Test: Background sweep");
+  
+  // The loop stays free while the servo sweeps; log the commanded angle
+  // now and then and count how often the loop gets around.
+  robot.servo->start_sweep(45, 135, 0);
+  unsigned long start_ms = millis();
+  unsigned long last_log_ms = start_ms;
+  unsigned long passes = 0;
+  while (millis() - start_ms < TEST_BACKGROUND_SWEEP_MS) {
+    robot.servo->poll();
+    passes++;
+    if (millis() - last_log_ms >= TEST_ANGLE_LOG_PERIOD_MS) {
+      last_log_ms += TEST_ANGLE_LOG_PERIOD_MS;
+      Logger::log_info(CLASS_NAME, __FUNCTION__, ("Commanded angle: " + String(robot.servo->get_commanded_angle(), 1) + "°").c_str());
+    }
+  }
+  robot.servo->stop();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Loop passes during sweep: " + String(passes)).c_str());
+  
+  robot.servo->center();
+}
+
 void run_all_servo_tests() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Starting all servo tests");
   
@@ -128,6 +155,7 @@ void run_all_servo_tests() {
   test_servo_move_to_limits();
   test_servo_smooth_movement();
   test_servo_sweep();
+  test_servo_background_sweep();
   test_servo_speed_control();
   
   Logger::log_info(CLASS_NAME, __FUNCTION__, "All servo tests complete");
@@ -5,6 +5,8 @@
 const int TEST_ANGLE_1 = 45;            // Test angle 1
 const int TEST_ANGLE_2 = 135;           // Test angle 2
 const int TEST_SWEEP_CYCLES = 2;        // Number of sweep cycles
+const unsigned long TEST_BACKGROUND_SWEEP_MS = 5000;  // Length of the background sweep test
+const unsigned long TEST_ANGLE_LOG_PERIOD_MS = 250;   // Commanded angle log interval
 
 // Test functions for servo controller
 void test_servo_center();
@@ -12,6 +14,7 @@ void test_servo_move_to_angles();
 void test_servo_move_to_limits();
 void test_servo_smooth_movement();
 void test_servo_sweep();
+void test_servo_background_sweep();
 void test_servo_speed_control();
 
 // Run all servo tests in sequence
@@ -24,9 +24,9 @@ static void print_float_line(OLED &oled, uint8_t row, const char *label, float v
   oled.print(buf);
 }
 
-static void print_int64_line(OLED &oled, uint8_t row, const char *label, int64_t value) {
-  char buf[20];
-  // AVR snprintf has limited long long support; downcast to long for reliable rendering.
+static void print_int32_line(OLED &oled, uint8_t row, const char *label, int32_t value) {
+  char buf[16];
+  // int32_t is long on AVR; the cast keeps %ld correct on other targets.
   snprintf(buf, sizeof(buf), "%ld", (long)value);
   oled.gotoXY(0, row);
   oled.print(label);
@@ -53,7 +53,7 @@ void Display::clear() {
   oled.clear();
 }
 
-void Display::print_encoder(int64_t left, int64_t right) {
+void Display::print_encoder(int32_t left, int32_t right) {
   ensure_oled_ready();
 
   if ((uint16_t)(millis() - lastUpdateTimeMs) <= DISPLAY_UPDATE_MS) {
@@ -66,8 +66,8 @@ void Display::print_encoder(int64_t left, int64_t right) {
 
   oled.clear();
 
-  print_int64_line(oled, 0, "L: ", left);
-  print_int64_line(oled, 1, "R: ", right);
+  print_int32_line(oled, 0, "L: ", left);
+  print_int32_line(oled, 1, "R: ", right);
 
 }
 
@@ -94,7 +94,7 @@ void Display::print_odom(float x, float y, float theta) {
   print_float_line(oled, 2, "theta: ", thetaDeg, kPrecision);
 }
 
-void Display::print_odom_and_encoder(float x, float y, float theta, int64_t left, int64_t right) {
+void Display::print_odom_and_encoder(float x, float y, float theta, int32_t left, int32_t right) {
   ensure_oled_ready();
 
   if ((uint16_t)(millis() - lastUpdateTimeMs) <= DISPLAY_UPDATE_MS) {
@@ -115,7 +115,7 @@ void Display::print_odom_and_encoder(float x, float y, float theta, int64_t left
   print_float_line(oled, 1, "y: ", y, kPrecision);
   print_float_line(oled, 2, "theta: ", thetaDeg, kPrecision);
 
-  // Encoders can exceed 32-bit; render as int64 via snprintf to avoid base misinterpretation.
-  print_int64_line(oled, 3, "L: ", left);
-  print_int64_line(oled, 4, "R: ", right);
+  // Encoder totals exceed 16 bits on long runs; render the full 32-bit value.
+  print_int32_line(oled, 3, "L: ", left);
+  print_int32_line(oled, 4, "R: ", right);
 }
@@ -13,9 +13,9 @@ public:
   Display();
 
   void clear();
-  void print_encoder(int64_t left, int64_t right);
+  void print_encoder(int32_t left, int32_t right);
   void print_odom(float x, float y, float theta);
-  void print_odom_and_encoder(float x, float y, float theta, int64_t left, int64_t right);
+  void print_odom_and_encoder(float x, float y, float theta, int32_t left, int32_t right);
 
 private:
   void ensure_oled_ready();
@@ -9,6 +9,35 @@ DifferentialDrive::DifferentialDrive() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Initialized");
   turn_speed_ratio = DEFAULT_TURN_SPEED_RATIO;
   wheelbase_mm = DEFAULT_WHEELBASE_MM;
+  motion_state = MotionState::IDLE;
+  motion_start_ms = 0;
+  motion_duration_ms = 0;
+  motion_start_us = 0;
+  reset_tick_stats();
+  
+  stop_mode = DEFAULT_STOP_MODE;
+  brake_decel_mm_per_s2 = DEFAULT_BRAKE_DECEL_MM_PER_S2;
+  motion_distance_mm = 0.0f;
+  motion_encoder_stop = false;
+  motion_commanded_mm = 0.0f;
+  motion_left_nominal = 0.0f;
+  motion_right_nominal = 0.0f;
+  motion_reference_speed = 0.0f;
+  motion_speed_ratio = 1.0f;
+  motion_left_counts = 0;
+  motion_right_counts = 0;
+  mm_per_count = (float)(M_PI * DIA_L * 10.0f) / (N_L * GEAR_RATIO);
+  left_velocity.set_mm_per_count(mm_per_count);
+  right_velocity.set_mm_per_count(mm_per_count);
+  left_velocity.set_calibration(&calibration, MotorSide::LEFT);
+  right_velocity.set_calibration(&calibration, MotorSide::RIGHT);
+  last_battery_ms = 0;
+  closed_loop = DEFAULT_CLOSED_LOOP;
+  velocity_active = false;
+  last_left_counts = 0;
+  last_right_counts = 0;
+  last_control_us = 0;
+  queue_running = false;
 }
 
 // ========== CONFIGURATION ==========
@@ -27,55 +56,149 @@ void DifferentialDrive::configure() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Right motor flip: " + String(DEFAULT_FLIP_RIGHT_MOTOR ? "true" : "false")).c_str());
   flip_right_motor(DEFAULT_FLIP_RIGHT_MOTOR);
   
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Closed loop: " + String(DEFAULT_CLOSED_LOOP ? "true" : "false")).c_str());
+  encoders.init();
+  set_velocity_gains(DEFAULT_VELOCITY_KP, DEFAULT_VELOCITY_KI, DEFAULT_VELOCITY_KD, DEFAULT_VELOCITY_KFF);
+  set_closed_loop(DEFAULT_CLOSED_LOOP);
+  calibration.load();
+  
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Stop mode: " + String(DEFAULT_STOP_MODE == StopMode::ENCODER ? "encoder" : "timer")).c_str());
+  set_stop_mode(DEFAULT_STOP_MODE);
+  set_brake_deceleration(DEFAULT_BRAKE_DECEL_MM_PER_S2);
+  
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Profile: accel=" + String(DEFAULT_PROFILE_ACCEL_MM_PER_S2) + " mm/s^2, jerk=" + String(DEFAULT_PROFILE_JERK_MM_PER_S3) + " mm/s^3").c_str());
+  set_profile_type(DEFAULT_PROFILE_TYPE);
+  set_profile_limits(DEFAULT_PROFILE_ACCEL_MM_PER_S2, DEFAULT_PROFILE_JERK_MM_PER_S3);
+  
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Configuration complete");
 }
 
 void DifferentialDrive::set_wheel_speeds(int left_speed_mm_per_s, int right_speed_mm_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Setting wheel speeds");
-  motors.setSpeeds(left_speed_mm_per_s, right_speed_mm_per_s);
+  
+  if (left_speed_mm_per_s == 0 && right_speed_mm_per_s == 0) {
+    stop_motors();
+    return;
+  }
+  
+  apply_wheel_speeds(left_speed_mm_per_s, right_speed_mm_per_s);
+}
+
+void DifferentialDrive::apply_wheel_speeds(float left_speed, float right_speed) {
+  bool starting = !velocity_active;
+  if (starting) {
+    // Starting from rest: fresh encoder baseline so the first delta covers one period only.
+    last_left_counts = encoders.getCountsLeft();
+    last_right_counts = encoders.getCountsRight();
+    last_control_us = micros();
+    left_velocity.reset();
+    right_velocity.reset();
+    calibration.update_battery();
+    last_battery_ms = millis();
+  }
+  
+  left_velocity.set_target(left_speed);
+  right_velocity.set_target(right_speed);
+  velocity_active = true;
+  
+  if (!closed_loop) {
+    motors.setSpeeds((int16_t)left_speed, (int16_t)right_speed);
+  } else if (starting) {
+    // Feed-forward gets the wheels moving now; poll() takes over from the next period.
+    motors.setSpeeds(left_velocity.feed_forward(), right_velocity.feed_forward());
+  }
 }
 
 void DifferentialDrive::drive_forward(int speed_mm_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Driving forward");
-  motors.setSpeeds(speed_mm_per_s, speed_mm_per_s);
+  set_wheel_speeds(speed_mm_per_s, speed_mm_per_s);
 }
 
 void DifferentialDrive::drive_backward(int speed_mm_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Driving backward");
-  motors.setSpeeds(-speed_mm_per_s, -speed_mm_per_s);
+  set_wheel_speeds(-speed_mm_per_s, -speed_mm_per_s);
 }
 
 // ========== NON-BLOCKING CONTINUOUS HELPERS ==========
 
 void DifferentialDrive::drive_forward_unbounded(int speed_mm_per_s) {
+  abort_queue();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
   drive_forward(speed_mm_per_s);
 }
 
 void DifferentialDrive::drive_backward_unbounded(int speed_mm_per_s) {
+  abort_queue();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
   drive_backward(speed_mm_per_s);
 }
 
 void DifferentialDrive::turn_left_unbounded(int speed_mm_per_s) {
+  abort_queue();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
   turn_left_low_level(speed_mm_per_s);
 }
 
 void DifferentialDrive::turn_right_unbounded(int speed_mm_per_s) {
+  abort_queue();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
   turn_right_low_level(speed_mm_per_s);
 }
 
+bool DifferentialDrive::command_twist(float v_m_per_s, float omega_rad_per_s) {
+  abort_queue();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
+  
+  float v_mm_per_s = v_m_per_s * 1000.0f;
+  float rim_mm_per_s = omega_rad_per_s * wheelbase_mm * 0.5f;
+  float left_speed = v_mm_per_s - rim_mm_per_s;
+  float right_speed = v_mm_per_s + rim_mm_per_s;
+  
+  if (left_speed == 0.0f && right_speed == 0.0f) {
+    stop_motors();
+    return false;
+  }
+  
+  // One common factor keeps right/left (and so the curvature) unchanged.
+  float fastest = fabs(left_speed) > fabs(right_speed) ? fabs(left_speed) : fabs(right_speed);
+  bool saturated = fastest > MAX_WHEEL_SPEED_MM_PER_S;
+  if (saturated) {
+    float scale = MAX_WHEEL_SPEED_MM_PER_S / fastest;
+    left_speed *= scale;
+    right_speed *= scale;
+  }
+  
+  apply_wheel_speeds(left_speed, right_speed);
+  return saturated;
+}
+
 void DifferentialDrive::turn_left_low_level(int speed_mm_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Turning left");
-  motors.setSpeeds(-speed_mm_per_s, speed_mm_per_s);
+  set_wheel_speeds(-speed_mm_per_s, speed_mm_per_s);
 }
 
 void DifferentialDrive::turn_right_low_level(int speed_mm_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Turning right");
-  motors.setSpeeds(speed_mm_per_s, -speed_mm_per_s);
+  set_wheel_speeds(speed_mm_per_s, -speed_mm_per_s);
 }
 
 void DifferentialDrive::halt() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Halted");
-  motors.setSpeeds(0, 0);
+  abort_queue();
+  stop_motors();
+  if (motion_state == MotionState::RUNNING) {
+    motion_state = MotionState::CANCELLED;
+  }
 }
 
 void DifferentialDrive::set_turn_speed_ratio(float ratio) {
@@ -104,6 +227,54 @@ float DifferentialDrive::get_wheelbase() {
   return wheelbase_mm;
 }
 
+void DifferentialDrive::set_closed_loop(bool enable) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, enable ? "Closed-loop velocity control" : "Open-loop PWM control");
+  if (enable != closed_loop) {
+    stop_motors();
+  }
+  closed_loop = enable;
+}
+
+bool DifferentialDrive::is_closed_loop() {
+  return closed_loop;
+}
+
+void DifferentialDrive::set_velocity_gains(float kp, float ki, float kd, float kff) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("kp=" + String(kp) + ", ki=" + String(ki) + ", kd=" + String(kd) + ", kff=" + String(kff)).c_str());
+  left_velocity.set_gains(kp, ki, kd, kff);
+  right_velocity.set_gains(kp, ki, kd, kff);
+}
+
+bool DifferentialDrive::calibrate_motors() {
+  halt();
+  delay(500);
+  
+  bool ok = calibration.calibrate(motors, encoders, mm_per_count);
+  stop_motors();
+  if (ok) {
+    calibration.save();
+  }
+  return ok;
+}
+
+bool DifferentialDrive::has_motor_calibration() {
+  return calibration.is_valid();
+}
+
+void DifferentialDrive::log_motor_calibration() {
+  calibration.update_battery();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Battery: " + String(calibration.get_battery_mv()) + " mV").c_str());
+  calibration.log_table();
+}
+
+float DifferentialDrive::get_left_wheel_speed() {
+  return left_velocity.get_measured();
+}
+
+float DifferentialDrive::get_right_wheel_speed() {
+  return right_velocity.get_measured();
+}
+
 void DifferentialDrive::flip_left_motor(bool flip) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Flipping left motor");
   motors.flipLeftMotor(flip);
@@ -117,212 +288,754 @@ void DifferentialDrive::flip_right_motor(bool flip) {
 // ========== HIGH-LEVEL MOTION PRIMITIVES ==========
 
 void DifferentialDrive::move_forward(float distance_m, float speed_m_per_s) {
+  if (start_move_forward(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+    delay(POST_MOVE_SETTLE_MS);
+  }
+}
+
+void DifferentialDrive::move_backward(float distance_m, float speed_m_per_s) {
+  if (start_move_backward(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::turn_left(float duration_s, float speed_m_per_s) {
+  if (start_turn_left_duration(duration_s, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::turn_left(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
+  if (start_turn_left(thetaOrTime, speed_m_per_s, mode)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::turn_right(float duration_s, float speed_m_per_s) {
+  if (start_turn_right_duration(duration_s, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::turn_right(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
+  if (start_turn_right(thetaOrTime, speed_m_per_s, mode)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::move_forward_turning_left(float distance_m, float speed_m_per_s) {
+  if (start_move_forward_turning_left(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::move_forward_turning_right(float distance_m, float speed_m_per_s) {
+  if (start_move_forward_turning_right(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::move_backward_turning_left(float distance_m, float speed_m_per_s) {
+  if (start_move_backward_turning_left(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::move_backward_turning_right(float distance_m, float speed_m_per_s) {
+  if (start_move_backward_turning_right(distance_m, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+void DifferentialDrive::arc(float radius_m, float angle_rad, float speed_m_per_s) {
+  if (start_arc(radius_m, angle_rad, speed_m_per_s)) {
+    wait_for_motion();
+  }
+}
+
+// ========== NON-BLOCKING MOTION ENGINE ==========
+
+bool DifferentialDrive::start_move_forward(float distance_m, float speed_m_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
   if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  drive_forward(speed_mm_per_s);
-
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
-  delay(duration_ms);
-
-  halt();
-
-  delay(3000);
+  unsigned long duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  
+  return begin_motion(speed_mm_per_s, speed_mm_per_s, duration_ms, meters_to_millimeters(distance_m), true);
 }
 
-void DifferentialDrive::move_backward(float distance_m, float speed_m_per_s) {
+bool DifferentialDrive::start_move_backward(float distance_m, float speed_m_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
   if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  unsigned long duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
   
-  drive_backward(speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_motion(-speed_mm_per_s, -speed_mm_per_s, duration_ms, meters_to_millimeters(distance_m), true);
 }
 
-void DifferentialDrive::turn_left(float duration_s, float speed_m_per_s) {
-  turn_left_duration(duration_s, speed_m_per_s);
-}
-
-void DifferentialDrive::turn_left(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
+bool DifferentialDrive::start_turn_left(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
   switch (mode) {
     case TurnMode::ANGLE:
       Logger::log_debug(CLASS_NAME, __FUNCTION__, ("ANGLE mode: angle=" + String(thetaOrTime) + " rad").c_str());
-      turn_left_angle(thetaOrTime, speed_m_per_s);
-      break;
+      return start_turn_left_angle(thetaOrTime, speed_m_per_s);
     
     case TurnMode::DURATION:
       Logger::log_debug(CLASS_NAME, __FUNCTION__, ("DURATION mode: duration=" + String(thetaOrTime) + " s").c_str());
-      turn_left_duration(thetaOrTime, speed_m_per_s);
-      break;
+      return start_turn_left_duration(thetaOrTime, speed_m_per_s);
   }
+  return false;
 }
 
-void DifferentialDrive::turn_right(float duration_s, float speed_m_per_s) {
-  turn_right_duration(duration_s, speed_m_per_s);
-}
-
-void DifferentialDrive::turn_right(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
+bool DifferentialDrive::start_turn_right(float thetaOrTime, float speed_m_per_s, TurnMode mode) {
   switch (mode) {
     case TurnMode::ANGLE:
       Logger::log_debug(CLASS_NAME, __FUNCTION__, ("ANGLE mode: angle=" + String(thetaOrTime) + " rad").c_str());
-      turn_right_angle(thetaOrTime, speed_m_per_s);
-      break;
+      return start_turn_right_angle(thetaOrTime, speed_m_per_s);
     
     case TurnMode::DURATION:
       Logger::log_debug(CLASS_NAME, __FUNCTION__, ("DURATION mode: duration=" + String(thetaOrTime) + " s").c_str());
-      turn_right_duration(thetaOrTime, speed_m_per_s);
-      break;
+      return start_turn_right_duration(thetaOrTime, speed_m_per_s);
   }
+  return false;
 }
 
-void DifferentialDrive::turn_left_angle(float angle_rad, float speed_m_per_s) {
+bool DifferentialDrive::start_turn_left_angle(float angle_rad, float speed_m_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("angle=" + String(angle_rad) + " rad, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
   if (!validate_float(angle_rad, 0.0f, 6.28319f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
   float duration_s = calculate_turn_duration_s(angle_rad, wheelbase_mm, speed_mm_per_s);
-  int duration_ms = convert_duration_to_ms(duration_s);
+  unsigned long duration_ms = convert_duration_to_ms(duration_s);
+  float wheel_arc_mm = angle_rad * wheelbase_mm / 2.0f;
   
-  turn_left_low_level(speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_motion(-speed_mm_per_s, speed_mm_per_s, duration_ms, wheel_arc_mm, true);
 }
 
-void DifferentialDrive::turn_right_angle(float angle_rad, float speed_m_per_s) {
+bool DifferentialDrive::start_turn_right_angle(float angle_rad, float speed_m_per_s) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("angle=" + String(angle_rad) + " rad, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
   if (!validate_float(angle_rad, 0.0f, 6.28319f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
   float duration_s = calculate_turn_duration_s(angle_rad, wheelbase_mm, speed_mm_per_s);
-  int duration_ms = convert_duration_to_ms(duration_s);
+  unsigned long duration_ms = convert_duration_to_ms(duration_s);
+  float wheel_arc_mm = angle_rad * wheelbase_mm / 2.0f;
   
-  turn_right_low_level(speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_motion(speed_mm_per_s, -speed_mm_per_s, duration_ms, wheel_arc_mm, true);
 }
 
-void DifferentialDrive::turn_right_duration(float duration_s, float speed_m_per_s) {
+bool DifferentialDrive::start_turn_right_duration(float duration_s, float speed_m_per_s) {
   if (!validate_float(duration_s, 0.0f, 60.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int duration_ms = convert_duration_to_ms(duration_s);
+  unsigned long duration_ms = convert_duration_to_ms(duration_s);
+  float wheel_travel_mm = speed_mm_per_s * duration_s;
   
-  turn_right_low_level(speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_motion(speed_mm_per_s, -speed_mm_per_s, duration_ms, wheel_travel_mm, false);
 }
 
-void DifferentialDrive::turn_left_duration(float duration_s, float speed_m_per_s) {
+bool DifferentialDrive::start_turn_left_duration(float duration_s, float speed_m_per_s) {
   if (!validate_float(duration_s, 0.0f, 60.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
   int speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int duration_ms = convert_duration_to_ms(duration_s);
+  unsigned long duration_ms = convert_duration_to_ms(duration_s);
+  float wheel_travel_mm = speed_mm_per_s * duration_s;
   
-  turn_left_low_level(speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_motion(-speed_mm_per_s, speed_mm_per_s, duration_ms, wheel_travel_mm, false);
 }
 
-void DifferentialDrive::move_forward_turning_left(float distance_m, float speed_m_per_s) {
+bool DifferentialDrive::start_move_forward_turning_left(float distance_m, float speed_m_per_s) {
+  return start_curve(distance_m, speed_m_per_s, 1, 1, true);
+}
+
+bool DifferentialDrive::start_move_forward_turning_right(float distance_m, float speed_m_per_s) {
+  return start_curve(distance_m, speed_m_per_s, 1, 1, false);
+}
+
+bool DifferentialDrive::start_move_backward_turning_left(float distance_m, float speed_m_per_s) {
+  return start_curve(distance_m, speed_m_per_s, -1, -1, true);
+}
+
+bool DifferentialDrive::start_move_backward_turning_right(float distance_m, float speed_m_per_s) {
+  return start_curve(distance_m, speed_m_per_s, -1, -1, false);
+}
+
+bool DifferentialDrive::start_curve(float distance_m, float speed_m_per_s, int left_sign, int right_sign, bool inner_is_left) {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
   if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
-  int outer_speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int inner_speed_mm_per_s = calculate_inner_speed(outer_speed_mm_per_s, turn_speed_ratio);
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  bool reverse = left_sign < 0 && right_sign < 0;
+  if (turn_speed_ratio >= 1.0f) {
+    // Equal wheel speeds: no curve at all.
+    float speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s) * left_sign;
+    unsigned long duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+    return begin_motion(speed_mm_per_s, speed_mm_per_s, duration_ms, meters_to_millimeters(distance_m), true);
+  }
   
-  set_wheel_speeds(inner_speed_mm_per_s, outer_speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  // The wheel speed ratio fixes the radius: v_in / v_out = (R - L/2) / (R + L/2).
+  float half_base = wheelbase_mm / 2.0f;
+  float radius_mm = half_base * (1.0f + turn_speed_ratio) / (1.0f - turn_speed_ratio);
+  
+  // distance_m is the outer wheel travel; speed_m_per_s the outer wheel speed.
+  MotionSegment segment;
+  segment.type = SegmentType::ARC;
+  segment.distance_mm = 0.0f;
+  segment.radius_mm = radius_mm;
+  segment.angle_rad = meters_to_millimeters(distance_m) / (radius_mm + half_base);
+  segment.speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s) * radius_mm / (radius_mm + half_base);
+  
+  // A positive angle puts the left wheel on the inside, also when reversing.
+  if (!inner_is_left) {
+    segment.angle_rad = -segment.angle_rad;
+  }
+  
+  return begin_segment(segment, reverse);
 }
 
-void DifferentialDrive::move_forward_turning_right(float distance_m, float speed_m_per_s) {
-  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
+bool DifferentialDrive::start_arc(float radius_m, float angle_rad, float speed_m_per_s) {
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("radius=" + String(radius_m) + " m, angle=" + String(angle_rad) + " rad, speed=" + String(speed_m_per_s) + " m/s").c_str());
   
-  if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
+  if (!validate_float(radius_m, 0.0f, 100.0f) || radius_m == 0.0f ||
+      !validate_float(angle_rad, -6.28319f, 6.28319f) || angle_rad == 0.0f ||
+      !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
     halt();
-    return;
+    return false;
   }
   
-  int outer_speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int inner_speed_mm_per_s = calculate_inner_speed(outer_speed_mm_per_s, turn_speed_ratio);
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  MotionSegment segment;
+  segment.type = SegmentType::ARC;
+  segment.distance_mm = 0.0f;
+  segment.radius_mm = meters_to_millimeters(radius_m);
+  segment.angle_rad = angle_rad;
+  segment.speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s);
   
-  set_wheel_speeds(outer_speed_mm_per_s, inner_speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  return begin_segment(segment, false);
 }
 
-void DifferentialDrive::move_backward_turning_left(float distance_m, float speed_m_per_s) {
-  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
+bool DifferentialDrive::begin_segment(const MotionSegment &segment, bool reverse) {
+  float left_speed, right_speed, distance_mm;
+  plan_segment(segment, left_speed, right_speed, distance_mm);
+  if (reverse) {
+    left_speed = -left_speed;
+    right_speed = -right_speed;
+  }
   
-  if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
-    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
+  float reference_speed = (fabs(left_speed) + fabs(right_speed)) / 2.0f;
+  unsigned long duration_ms = reference_speed > 0.0f ? (unsigned long)(1000.0f * distance_mm / reference_speed) : 0;
+  
+  return begin_motion(left_speed, right_speed, duration_ms, distance_mm, true);
+}
+
+bool DifferentialDrive::begin_motion(float left_speed, float right_speed, unsigned long duration_ms,
+                                     float distance_mm, bool encoder_stop) {
+  abort_queue();
+  motion_start_us = micros();
+  motion_speed_ratio = 1.0f;
+  return launch_motion(left_speed, right_speed, duration_ms, distance_mm, encoder_stop, 0.0f, 0.0f);
+}
+
+bool DifferentialDrive::launch_motion(float left_speed, float right_speed, unsigned long duration_ms,
+                                      float distance_mm, bool encoder_stop,
+                                      float start_speed, float end_speed) {
+  float left_abs = fabs(left_speed);
+  float right_abs = fabs(right_speed);
+  float reference_speed = (left_abs + right_abs) / 2.0f;
+  if (reference_speed <= 0.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Speed must be positive");
     halt();
+    return false;
+  }
+  
+  motion_start_ms = millis();
+  motion_duration_ms = duration_ms;
+  motion_distance_mm = distance_mm;
+  motion_encoder_stop = encoder_stop && stop_mode == StopMode::ENCODER;
+  motion_commanded_mm = 0.0f;
+  motion_left_counts = 0;
+  motion_right_counts = 0;
+  motion_left_nominal = left_speed;
+  motion_right_nominal = right_speed;
+  motion_reference_speed = reference_speed;
+  motion_state = MotionState::RUNNING;
+  
+  profile.start(distance_mm, reference_speed, start_speed, end_speed);
+  float first_speed = profile.step(VELOCITY_CONTROL_PERIOD_US * 1.0e-6f, 0.0f);
+  float scale = first_speed / reference_speed;
+  apply_wheel_speeds(motion_left_nominal * scale, motion_right_nominal * scale);
+  return true;
+}
+
+void DifferentialDrive::advance_motion(float dt_s) {
+  // Distance commanded during the period that just ended.
+  motion_commanded_mm += profile.get_speed() * dt_s;
+  
+  if (motion_target_reached()) {
+    if (queue_running && !motion_queue.is_empty()) {
+      float travelled = motion_encoder_stop ? get_motion_progress_mm() : motion_commanded_mm;
+      float overshoot = travelled - motion_distance_mm;
+      float carry_mm = overshoot > 0.0f ? overshoot / motion_speed_ratio : 0.0f;
+      start_next_segment(profile.get_speed() / motion_speed_ratio, carry_mm);
+    } else {
+      end_motion(MotionState::COMPLETE);
+    }
     return;
   }
   
-  int outer_speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int inner_speed_mm_per_s = calculate_inner_speed(outer_speed_mm_per_s, turn_speed_ratio);
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  if (motion_encoder_stop) {
+    unsigned long ramp_ms = (unsigned long)(1000.0f * motion_reference_speed / profile.get_max_acceleration());
+    unsigned long timeout_ms = 2 * (motion_duration_ms + ramp_ms) + ENCODER_STOP_TIMEOUT_MARGIN_MS;
+    if ((unsigned long)(millis() - motion_start_ms) >= timeout_ms) {
+      Logger::log_warning(CLASS_NAME, __FUNCTION__, "Encoder target not reached, stopping");
+      end_motion(MotionState::CANCELLED);
+      return;
+    }
+  }
   
-  set_wheel_speeds(-inner_speed_mm_per_s, -outer_speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  float travelled = motion_encoder_stop ? get_motion_progress_mm() : motion_commanded_mm;
+  float speed = profile.step(dt_s, travelled);
+  float scale = speed / motion_reference_speed;
+  apply_wheel_speeds(motion_left_nominal * scale, motion_right_nominal * scale);
 }
 
-void DifferentialDrive::move_backward_turning_right(float distance_m, float speed_m_per_s) {
-  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(distance_m) + " m, speed=" + String(speed_m_per_s) + " m/s").c_str());
+bool DifferentialDrive::motion_target_reached() {
+  bool chained = queue_running && !motion_queue.is_empty();
   
-  if (!validate_float(distance_m, 0.0f, 100.0f) || !validate_float(speed_m_per_s, 0.0f, 0.4f)) {
-    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
-    halt();
+  if (!motion_encoder_stop) {
+    return motion_commanded_mm >= motion_distance_mm;
+  }
+  if (chained) {
+    // The wheels keep turning into the next segment: no braking look-ahead.
+    return get_motion_progress_mm() >= motion_distance_mm;
+  }
+  return encoder_target_reached();
+}
+
+void DifferentialDrive::stop_motors() {
+  motors.setSpeeds(0, 0);
+  left_velocity.set_target(0.0f);
+  right_velocity.set_target(0.0f);
+  left_velocity.reset();
+  right_velocity.reset();
+  velocity_active = false;
+}
+
+void DifferentialDrive::update_velocity_control(unsigned long now_us) {
+  int16_t left_counts = encoders.getCountsLeft();
+  int16_t right_counts = encoders.getCountsRight();
+  
+  // int16_t subtraction wraps correctly across counter rollover.
+  int16_t delta_left = (int16_t)(left_counts - last_left_counts);
+  int16_t delta_right = (int16_t)(right_counts - last_right_counts);
+  unsigned long dt_us = now_us - last_control_us;
+  
+  last_left_counts = left_counts;
+  last_right_counts = right_counts;
+  last_control_us = now_us;
+  motion_left_counts += delta_left;
+  motion_right_counts += delta_right;
+  
+  int16_t left_pwm = left_velocity.update(delta_left, dt_us);
+  int16_t right_pwm = right_velocity.update(delta_right, dt_us);
+  
+  if (closed_loop) {
+    motors.setSpeeds(left_pwm, right_pwm);
+  }
+}
+
+void DifferentialDrive::end_motion(MotionState end_state) {
+  abort_queue();
+  stop_motors();
+  motion_state = end_state;
+  tick_stats.motion_us += micros() - motion_start_us;
+  
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, end_state == MotionState::COMPLETE ? "Motion complete" : "Motion cancelled");
+}
+
+bool DifferentialDrive::poll() {
+  bool motion_running = motion_state == MotionState::RUNNING;
+  if (!motion_running && !velocity_active) {
+    return false;
+  }
+  
+  unsigned long tick_start_us = micros();
+  
+  unsigned long since_control_us = tick_start_us - last_control_us;
+  if (velocity_active && since_control_us >= VELOCITY_CONTROL_PERIOD_US) {
+    if ((unsigned long)(millis() - last_battery_ms) >= BATTERY_SAMPLE_PERIOD_MS) {
+      calibration.update_battery();
+      last_battery_ms = millis();
+    }
+    update_velocity_control(tick_start_us);
+    if (motion_running) {
+      advance_motion(since_control_us * 1.0e-6f);
+    }
+  }
+  
+  if (!motion_running) {
+    return false;
+  }
+  
+  unsigned long tick_us = micros() - tick_start_us;
+  tick_stats.ticks++;
+  tick_stats.last_us = tick_us;
+  tick_stats.total_us += tick_us;
+  if (tick_us > tick_stats.max_us) {
+    tick_stats.max_us = tick_us;
+  }
+  
+  return motion_state == MotionState::RUNNING;
+}
+
+void DifferentialDrive::cancel() {
+  if (motion_state != MotionState::RUNNING) {
     return;
   }
   
-  int outer_speed_mm_per_s = (int)meters_per_s_to_mm_per_s(speed_m_per_s);
-  int inner_speed_mm_per_s = calculate_inner_speed(outer_speed_mm_per_s, turn_speed_ratio);
-  int duration_ms = calculate_motion_duration_ms(distance_m, speed_m_per_s);
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Cancelling motion");
+  end_motion(MotionState::CANCELLED);
+}
+
+// ========== SEGMENT QUEUE ==========
+
+bool DifferentialDrive::queue_line(float distance_m, float speed_m_per_s) {
+  if (!validate_float(distance_m, -100.0f, 100.0f) || distance_m == 0.0f ||
+      !validate_float(speed_m_per_s, 0.0f, 0.4f) || speed_m_per_s == 0.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
+    return false;
+  }
   
-  set_wheel_speeds(-outer_speed_mm_per_s, -inner_speed_mm_per_s);
-  delay(duration_ms);
-  halt();
+  MotionSegment segment;
+  segment.type = SegmentType::LINE;
+  segment.distance_mm = meters_to_millimeters(distance_m);
+  segment.radius_mm = 0.0f;
+  segment.angle_rad = 0.0f;
+  segment.speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s);
+  return push_segment(segment);
+}
+
+bool DifferentialDrive::queue_arc(float radius_m, float angle_rad, float speed_m_per_s) {
+  if (!validate_float(radius_m, 0.0f, 100.0f) || radius_m == 0.0f ||
+      !validate_float(angle_rad, -6.28319f, 6.28319f) || angle_rad == 0.0f ||
+      !validate_float(speed_m_per_s, 0.0f, 0.4f) || speed_m_per_s == 0.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
+    return false;
+  }
+  
+  MotionSegment segment;
+  segment.type = SegmentType::ARC;
+  segment.distance_mm = 0.0f;
+  segment.radius_mm = meters_to_millimeters(radius_m);
+  segment.angle_rad = angle_rad;
+  segment.speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s);
+  return push_segment(segment);
+}
+
+bool DifferentialDrive::queue_turn(float angle_rad, float speed_m_per_s) {
+  if (!validate_float(angle_rad, -6.28319f, 6.28319f) || angle_rad == 0.0f ||
+      !validate_float(speed_m_per_s, 0.0f, 0.4f) || speed_m_per_s == 0.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid parameters");
+    return false;
+  }
+  
+  MotionSegment segment;
+  segment.type = SegmentType::TURN;
+  segment.distance_mm = 0.0f;
+  segment.radius_mm = 0.0f;
+  segment.angle_rad = angle_rad;
+  segment.speed_mm_per_s = meters_per_s_to_mm_per_s(speed_m_per_s);
+  return push_segment(segment);
+}
+
+bool DifferentialDrive::push_segment(const MotionSegment &segment) {
+  if (!motion_queue.push(segment)) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Motion queue full");
+    return false;
+  }
+  return true;
+}
+
+bool DifferentialDrive::start_queue() {
+  if (motion_queue.is_empty()) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Motion queue empty");
+    return false;
+  }
+  
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("segments=" + String(motion_queue.size())).c_str());
+  
+  // A running primitive is replaced; the queue itself must survive the switch.
+  if (motion_state == MotionState::RUNNING && !queue_running) {
+    motion_state = MotionState::CANCELLED;
+  }
+  queue_running = true;
+  motion_start_us = micros();
+  return start_next_segment(0.0f, 0.0f);
+}
+
+void DifferentialDrive::clear_queue() {
+  if (queue_running && motion_state == MotionState::RUNNING) {
+    end_motion(MotionState::CANCELLED);
+  }
+  motion_queue.clear();
+  queue_running = false;
+}
+
+uint8_t DifferentialDrive::get_queued_segments() {
+  return motion_queue.size();
+}
+
+float DifferentialDrive::estimate_queue_time_s() {
+  float max_accel = profile.get_max_acceleration();
+  float start_speed = 0.0f;
+  float total_s = 0.0f;
+  
+  for (uint8_t i = 0; i < motion_queue.size(); i++) {
+    const MotionSegment &segment = *motion_queue.peek(i);
+    float left_speed, right_speed, distance_mm;
+    float ratio = plan_segment(segment, left_speed, right_speed, distance_mm);
+    float cruise = (fabs(left_speed) + fabs(right_speed)) / 2.0f;
+    
+    // Limit the exit speed to what the segment can accelerate to.
+    float end_speed = segment_exit_speed(segment, i + 1);
+    float reachable = sqrtf(start_speed * start_speed + 2.0f * max_accel * distance_mm / ratio);
+    if (end_speed > reachable) {
+      end_speed = reachable;
+    }
+    
+    total_s += profile.minimum_time(distance_mm, cruise, start_speed * ratio, end_speed * ratio);
+    start_speed = end_speed;
+  }
+  
+  return total_s;
+}
+
+bool DifferentialDrive::start_next_segment(float start_speed, float carry_mm) {
+  MotionSegment segment;
+  if (!motion_queue.pop(segment)) {
+    return false;
+  }
+  
+  float left_speed, right_speed, distance_mm;
+  float ratio = plan_segment(segment, left_speed, right_speed, distance_mm);
+  float end_speed = segment_exit_speed(segment, 0);
+  
+  // Overshoot of the previous segment already covers part of this one.
+  float remaining_mm = distance_mm - carry_mm * ratio;
+  if (remaining_mm < 0.0f) {
+    remaining_mm = 0.0f;
+  }
+  
+  float cruise = (fabs(left_speed) + fabs(right_speed)) / 2.0f;
+  unsigned long duration_ms = (unsigned long)(1000.0f * distance_mm / cruise);
+  motion_speed_ratio = ratio;
+  
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, ("distance=" + String(remaining_mm) + " mm, exit speed=" + String(end_speed) + " mm/s").c_str());
+  
+  return launch_motion(left_speed, right_speed, duration_ms, remaining_mm, true,
+                       start_speed * ratio, end_speed * ratio);
+}
+
+float DifferentialDrive::plan_segment(const MotionSegment &segment, float &left_speed, float &right_speed, float &distance_mm) {
+  float speed = segment.speed_mm_per_s;
+  float half_base = wheelbase_mm / 2.0f;
+  
+  switch (segment.type) {
+    case SegmentType::LINE: {
+      float sign = segment.distance_mm < 0.0f ? -1.0f : 1.0f;
+      left_speed = sign * speed;
+      right_speed = sign * speed;
+      distance_mm = fabs(segment.distance_mm);
+      break;
+    }
+    
+    case SegmentType::ARC: {
+      // Positive angle turns left: the left wheel is on the inside.
+      float sign = segment.angle_rad < 0.0f ? -1.0f : 1.0f;
+      left_speed = speed * (segment.radius_mm - sign * half_base) / segment.radius_mm;
+      right_speed = speed * (segment.radius_mm + sign * half_base) / segment.radius_mm;
+      // Mean wheel travel; when R < L/2 the inner wheel runs backwards.
+      float lever_mm = segment.radius_mm > half_base ? segment.radius_mm : half_base;
+      distance_mm = fabs(segment.angle_rad) * lever_mm;
+      break;
+    }
+    
+    case SegmentType::TURN: {
+      float sign = segment.angle_rad < 0.0f ? -1.0f : 1.0f;
+      left_speed = -sign * speed;
+      right_speed = sign * speed;
+      distance_mm = fabs(segment.angle_rad) * half_base;
+      break;
+    }
+  }
+  
+  // Keep the outer wheel within reach of the motors.
+  float fastest = fabs(left_speed) > fabs(right_speed) ? fabs(left_speed) : fabs(right_speed);
+  float ratio_scale = 1.0f;
+  if (fastest > MAX_WHEEL_SPEED_MM_PER_S) {
+    ratio_scale = MAX_WHEEL_SPEED_MM_PER_S / fastest;
+    left_speed *= ratio_scale;
+    right_speed *= ratio_scale;
+  }
+  
+  if (segment.type == SegmentType::TURN) {
+    return 1.0f;
+  }
+  return (fabs(left_speed) + fabs(right_speed)) / (2.0f * speed * ratio_scale);
+}
+
+float DifferentialDrive::junction_speed(const MotionSegment &a, const MotionSegment &b) {
+  if (a.type == SegmentType::TURN || b.type == SegmentType::TURN) {
+    return 0.0f;
+  }
+  
+  bool a_forward = a.type == SegmentType::ARC || a.distance_mm > 0.0f;
+  bool b_forward = b.type == SegmentType::ARC || b.distance_mm > 0.0f;
+  if (a_forward != b_forward) {
+    return 0.0f;
+  }
+  
+  float speed = a.speed_mm_per_s < b.speed_mm_per_s ? a.speed_mm_per_s : b.speed_mm_per_s;
+  
+  // A curvature change steps both wheel speeds by v * (L/2) * |k_a - k_b|.
+  float curvature_a = a.type == SegmentType::ARC ? (a.angle_rad < 0.0f ? -1.0f : 1.0f) / a.radius_mm : 0.0f;
+  float curvature_b = b.type == SegmentType::ARC ? (b.angle_rad < 0.0f ? -1.0f : 1.0f) / b.radius_mm : 0.0f;
+  float step_per_speed = (wheelbase_mm / 2.0f) * fabs(curvature_a - curvature_b);
+  if (step_per_speed > 0.0f && speed * step_per_speed > QUEUE_MAX_WHEEL_STEP_MM_PER_S) {
+    speed = QUEUE_MAX_WHEEL_STEP_MM_PER_S / step_per_speed;
+  }
+  
+  return speed;
+}
+
+float DifferentialDrive::segment_exit_speed(const MotionSegment &segment, uint8_t next_index) {
+  float max_accel = profile.get_max_acceleration();
+  float speed = 0.0f;  // The queue ends at rest.
+  
+  // Walk backwards: each junction may not exceed what the rest of the queue can brake from.
+  for (int i = (int)motion_queue.size() - 1; i >= (int)next_index; i--) {
+    const MotionSegment &next = *motion_queue.peek(i);
+    const MotionSegment &previous = i == next_index ? segment : *motion_queue.peek(i - 1);
+    
+    float left_speed, right_speed, distance_mm;
+    float ratio = plan_segment(next, left_speed, right_speed, distance_mm);
+    float brakeable = sqrtf(speed * speed + 2.0f * max_accel * distance_mm / ratio);
+    float junction = junction_speed(previous, next);
+    speed = junction < brakeable ? junction : brakeable;
+  }
+  
+  return speed;
+}
+
+void DifferentialDrive::abort_queue() {
+  if (queue_running) {
+    motion_queue.clear();
+    queue_running = false;
+  }
+}
+
+bool DifferentialDrive::is_busy() {
+  return motion_state == MotionState::RUNNING;
+}
+
+MotionState DifferentialDrive::get_motion_state() {
+  return motion_state;
+}
+
+void DifferentialDrive::wait_for_motion() {
+  while (poll()) {
+  }
+}
+
+void DifferentialDrive::set_stop_mode(StopMode mode) {
+  stop_mode = mode;
+}
+
+StopMode DifferentialDrive::get_stop_mode() {
+  return stop_mode;
+}
+
+void DifferentialDrive::set_brake_deceleration(float decel_mm_per_s2) {
+  if (validate_float(decel_mm_per_s2, 1.0f, 100000.0f)) {
+    brake_decel_mm_per_s2 = decel_mm_per_s2;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid brake deceleration");
+  }
+}
+
+void DifferentialDrive::set_profile_type(ProfileType type) {
+  profile.set_type(type);
+}
+
+ProfileType DifferentialDrive::get_profile_type() {
+  return profile.get_type();
+}
+
+void DifferentialDrive::set_profile_limits(float max_accel_mm_per_s2, float max_jerk_mm_per_s3) {
+  profile.set_limits(max_accel_mm_per_s2, max_jerk_mm_per_s3);
+}
+
+float DifferentialDrive::get_motion_progress_mm() {
+  float left_mm = labs(motion_left_counts) * mm_per_count;
+  float right_mm = labs(motion_right_counts) * mm_per_count;
+  return (left_mm + right_mm) / 2.0f;
+}
+
+bool DifferentialDrive::encoder_target_reached() {
+  float left_speed = fabs(left_velocity.get_measured());
+  float right_speed = fabs(right_velocity.get_measured());
+  float speed = (left_speed + right_speed) / 2.0f;
+  
+  // Distance covered before the wheels stop: one control period of latency (progress
+  // is sampled once per period) plus the braking distance v^2 / 2a.
+  float latency_s = VELOCITY_CONTROL_PERIOD_US * 1.0e-6f;
+  float look_ahead_mm = speed * latency_s + (speed * speed) / (2.0f * brake_decel_mm_per_s2);
+  
+  return get_motion_progress_mm() + look_ahead_mm >= motion_distance_mm;
+}
+
+const MotionTickStats& DifferentialDrive::get_tick_stats() {
+  return tick_stats;
+}
+
+void DifferentialDrive::reset_tick_stats() {
+  tick_stats.ticks = 0;
+  tick_stats.last_us = 0;
+  tick_stats.max_us = 0;
+  tick_stats.total_us = 0;
+  tick_stats.motion_us = 0;
 }
@@ -3,7 +3,12 @@
 
 #include <Pololu3piPlus32U4.h>
 #include "../configurable.h"
+#include "../odometer/odometry.h"
 #include "../utils/logger.h"
+#include "motor_calibration.h"
+#include "velocity_controller.h"
+#include "velocity_profile.h"
+#include "motion_queue.h"
 using namespace Pololu3piPlus32U4;
 
 // ============================================================
@@ -32,6 +37,64 @@ using namespace Pololu3piPlus32U4;
 //   - Negative speed: Motor spins backward
 //   - Speed range: -400 to +400 (values outside this range are clamped)
 //
+// Closed-Loop Velocity Control:
+//   - With closed loop enabled (default), wheel speeds are true mm/s targets
+//   - A WheelVelocityController per wheel runs every VELOCITY_CONTROL_PERIOD_US
+//     from poll(), using the encoder count deltas since the previous period
+//   - With closed loop disabled, wheel speeds go straight to Motors::setSpeeds()
+//     as raw PWM (the original behaviour); speeds are still measured
+//   - The feed-forward term comes from a MotorCalibration table (loaded from
+//     EEPROM in configure(), rebuilt by calibrate_motors()), scaled for the
+//     battery voltage sampled every BATTERY_SAMPLE_PERIOD_MS while driving
+//
+// Encoder-Terminated Motion (StopMode::ENCODER, default):
+//   - Straight moves stop on the mean wheel travel |d_left|+|d_right| / 2
+//   - In-place turns stop on the same mean wheel travel, which equals the
+//     encoder heading change times wheelbase/2: |dθ| = (|d_left|+|d_right|) / L
+//   - Arcs stop on the mean wheel travel |θ| * max(R, L/2); with both wheels
+//     following their own radius R -/+ L/2 this ends on the requested sweep angle
+//   - Braking look-ahead: the stop is issued early by the distance the robot
+//     covers before it comes to rest, v*t_latency + v^2 / (2*a_brake)
+//   - Duration-based turns are always timed
+//
+// Arcs:
+//   - arc(R, θ, v): left wheel v * (R - L/2) / R, right wheel v * (R + L/2) / R
+//     (θ > 0, turning left; the wheels swap for θ < 0)
+//   - Wheel speeds and the stop distance are computed once when the arc starts;
+//     the control tick only scales them by the velocity profile (no trig)
+//   - move_*_turning_*() are arcs of the radius implied by turn_speed_ratio r:
+//     R = (L/2) * (1 + r) / (1 - r), e.g. 147 mm for r = 0.5
+//
+// Velocity Profiles:
+//   - Every motion primitive ramps its wheel speeds through a VelocityProfile
+//     (S-curve by default) instead of stepping straight to the cruise speed
+//   - The profile is stepped once per control period; the nominal wheel speeds
+//     of the primitive are scaled by v_profile / v_cruise, so curves keep their
+//     wheel-speed ratio during the ramps
+//   - Progress along the profile comes from the encoders (StopMode::ENCODER) or
+//     from the integrated commanded speed (StopMode::TIMER, duration turns)
+//
+// Segment Queue:
+//   - queue_line()/queue_arc()/queue_turn() append segments to a MotionQueue;
+//     start_queue() runs them back to back from poll()
+//   - Each segment is profiled with a non-zero end speed when the next one
+//     continues in the same direction, so the robot does not stop between them
+//   - Junction speed = min(cruise_a, cruise_b), limited by the wheel speed step
+//     a curvature change causes, and by a backward pass over the queue so every
+//     later segment can still slow down in time: v_j <= sqrt(v_next^2 + 2*a*len)
+//   - In-place turns and direction reversals have a junction speed of zero;
+//     the robot slows to a stop there but the next segment starts on the same tick
+//   - Intermediate segments end on reaching their distance and pass any overshoot
+//     on to the next segment; only the last one uses the braking look-ahead
+//
+// Twist Commands (unicycle model):
+//   - command_twist(v, ω): V_left = v - ω*L/2, V_right = v + ω*L/2
+//   - If either wheel would exceed MAX_WHEEL_SPEED_MM_PER_S both are scaled by
+//     the same factor, so the curvature ω/v (the path) is kept and only the
+//     speed along it drops
+//   - A few multiplies and no logging: meant to be called from a control loop
+//     every tick, with poll() running the velocity loop
+//
 // Mathematical Model:
 //   - Left motor speed: V_left (mm/s)
 //   - Right motor speed: V_right (mm/s)
@@ -50,12 +113,44 @@ enum class TurnMode {
   DURATION    // Rotation based on time duration in seconds
 };
 
+// Enum to select how distance/angle primitives decide they are finished
+enum class StopMode {
+  TIMER,      // Stop after distance/speed (or angle/turn rate) has elapsed - open loop
+  ENCODER     // Stop when the encoders show the target distance or heading
+};
+
+// State of the non-blocking motion engine
+enum class MotionState {
+  IDLE,       // No motion primitive has been started
+  RUNNING,    // A motion primitive is in progress (poll() must be called)
+  COMPLETE,   // The last motion primitive ran to completion
+  CANCELLED   // The last motion primitive was stopped before completion
+};
+
+// CPU cost of the motion engine, measured inside poll() while a motion is running
+struct MotionTickStats {
+  unsigned long ticks;       // Number of poll() calls that serviced a running motion
+  unsigned long last_us;     // CPU time spent in the most recent tick [us]
+  unsigned long max_us;      // Worst-case CPU time of a single tick [us]
+  unsigned long total_us;    // CPU time spent in all ticks [us]
+  unsigned long motion_us;   // Wall-clock time of the serviced motions [us]
+};
+
 // Default configuration constants for Pololu 3pi+ robot
 // Updated to match the provided wheelbase (distance between wheel centers).
 const float DEFAULT_WHEELBASE_MM = 98.0f;  // Distance between left and right wheels [mm]
 const float DEFAULT_TURN_SPEED_RATIO = 0.5f;  // Inner wheel speed as fraction of outer wheel speed
 const bool DEFAULT_FLIP_LEFT_MOTOR = false;  // Set to true if left motor is wired backwards
 const bool DEFAULT_FLIP_RIGHT_MOTOR = false;  // Set to true if right motor is wired backwards
+const unsigned long POST_MOVE_SETTLE_MS = 3000;  // Pause after blocking move_forward() [ms]
+const bool DEFAULT_CLOSED_LOOP = true;  // Track wheel speeds in mm/s with the encoder velocity loop
+const unsigned long VELOCITY_CONTROL_PERIOD_US = 10000;  // Velocity loop period (100 Hz) [us]
+const StopMode DEFAULT_STOP_MODE = StopMode::ENCODER;  // End distance/angle moves on encoder counts
+const float DEFAULT_BRAKE_DECEL_MM_PER_S2 = 1500.0f;  // Deceleration after the motors are stopped [mm/s^2]
+const unsigned long ENCODER_STOP_TIMEOUT_MARGIN_MS = 1000;  // Give up at 2x planned time + margin (stalled wheel)
+const unsigned long BATTERY_SAMPLE_PERIOD_MS = 500;  // Battery voltage refresh for the feed-forward table
+const float MAX_WHEEL_SPEED_MM_PER_S = 400.0f;  // Queued segments are scaled down to keep both wheels below this
+const float QUEUE_MAX_WHEEL_STEP_MM_PER_S = 100.0f;  // Largest wheel speed jump allowed at a segment junction
 
 class DifferentialDrive : public Configurable {
   public:
@@ -125,42 +220,314 @@ class DifferentialDrive : public Configurable {
     
     // Purpose: Move robot forward while turning left
     // Description: Left wheel reduced speed, right wheel forward speed
-    //   Inner wheel speed controlled by turn_speed_ratio
-    // Args: distance_m - distance to travel in meters (positive)
+    //   Inner wheel speed controlled by turn_speed_ratio; runs as an exact arc
+    //   of radius (L/2)(1 + r)/(1 - r), see arc()
+    // Args: distance_m - outer wheel travel in meters (positive)
     //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
     // Return: void
     void move_forward_turning_left(float distance_m, float speed_m_per_s);
     
     // Purpose: Move robot forward while turning right
     // Description: Right wheel reduced speed, left wheel forward speed
-    //   Inner wheel speed controlled by turn_speed_ratio
-    // Args: distance_m - distance to travel in meters (positive)
+    //   Inner wheel speed controlled by turn_speed_ratio; runs as an exact arc
+    //   of radius (L/2)(1 + r)/(1 - r), see arc()
+    // Args: distance_m - outer wheel travel in meters (positive)
     //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
     // Return: void
     void move_forward_turning_right(float distance_m, float speed_m_per_s);
     
     // Purpose: Move robot backward while turning left
     // Description: Left wheel reduced speed backward, right wheel backward speed
-    //   Inner wheel speed controlled by turn_speed_ratio
-    // Args: distance_m - distance to travel in meters (positive)
+    //   Inner wheel speed controlled by turn_speed_ratio; runs as an exact arc
+    //   of radius (L/2)(1 + r)/(1 - r), see arc()
+    // Args: distance_m - outer wheel travel in meters (positive)
     //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
     // Return: void
     void move_backward_turning_left(float distance_m, float speed_m_per_s);
     
     // Purpose: Move robot backward while turning right
     // Description: Right wheel reduced speed backward, left wheel backward speed
-    //   Inner wheel speed controlled by turn_speed_ratio
-    // Args: distance_m - distance to travel in meters (positive)
+    //   Inner wheel speed controlled by turn_speed_ratio; runs as an exact arc
+    //   of radius (L/2)(1 + r)/(1 - r), see arc()
+    // Args: distance_m - outer wheel travel in meters (positive)
     //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
     // Return: void
     void move_backward_turning_right(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Drive forward along a circular arc
+    // Description: Both wheel speeds and the stop condition follow from the
+    //   radius, sweep angle and wheelbase_mm
+    // Args: radius_m - turning radius of the robot centre in meters (positive,
+    //         smaller than wheelbase/2 makes the inner wheel reverse)
+    //       angle_rad - signed sweep angle (positive = left/counterclockwise)
+    //       speed_m_per_s - speed of the robot centre in m/s (0.0 to 0.4)
+    // Return: void
+    void arc(float radius_m, float angle_rad, float speed_m_per_s);
+    
+    // ========== NON-BLOCKING MOTION ENGINE ==========
+    //
+    // Each start_* function validates its arguments, commands the wheels and returns
+    // immediately. The caller then calls poll() from its loop (together with
+    // Navigator::update(), sonar, display, ...) until it returns false.
+    // The blocking primitives above are start_* followed by wait_for_motion().
+    //
+    //   robot.drive->start_move_forward(1.0, 0.2);
+    //   while (robot.drive->poll()) {
+    //     robot.navigator->update();
+    //   }
+    
+    // Purpose: Start a straight forward move without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - forward speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_forward(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a straight backward move without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - backward speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_backward(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a counterclockwise in-place rotation without blocking
+    // Args: thetaOrTime - rotation angle (rad) if ANGLE mode, or duration (s) if DURATION mode
+    //       speed_m_per_s - rotation speed in m/s (0.0 to 0.4)
+    //       mode - TurnMode::ANGLE or TurnMode::DURATION
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_turn_left(float thetaOrTime, float speed_m_per_s, TurnMode mode);
+    
+    // Purpose: Start a clockwise in-place rotation without blocking
+    // Args: thetaOrTime - rotation angle (rad) if ANGLE mode, or duration (s) if DURATION mode
+    //       speed_m_per_s - rotation speed in m/s (0.0 to 0.4)
+    //       mode - TurnMode::ANGLE or TurnMode::DURATION
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_turn_right(float thetaOrTime, float speed_m_per_s, TurnMode mode);
+    
+    // Purpose: Start a forward-left curve without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_forward_turning_left(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a forward-right curve without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_forward_turning_right(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a backward-left curve without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_backward_turning_left(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a backward-right curve without blocking
+    // Args: distance_m - distance to travel in meters (positive)
+    //       speed_m_per_s - outer wheel speed in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_move_backward_turning_right(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Start a forward arc without blocking
+    // Args: radius_m - turning radius of the robot centre in meters (positive)
+    //       angle_rad - signed sweep angle (positive = left/counterclockwise)
+    //       speed_m_per_s - speed of the robot centre in m/s (0.0 to 0.4)
+    // Return: bool - true if the motion was started, false if parameters are invalid
+    bool start_arc(float radius_m, float angle_rad, float speed_m_per_s);
+    
+    // Purpose: Advance the running motion by one tick
+    // Description: Runs the wheel velocity loop when its period has elapsed and
+    //   halts the motors once the motion's end condition is reached.
+    //   Cheap enough to call every pass of loop(); records its own CPU cost.
+    //   Keep calling it after drive_*_unbounded() so the velocity loop runs.
+    // Args: None
+    // Return: bool - true while a motion is still running
+    bool poll();
+    
+    // Purpose: Stop the running motion before it completes
+    // Description: Halts the motors and marks the motion as CANCELLED
+    // Args: None
+    // Return: void
+    void cancel();
+    
+    // Purpose: Check whether a motion is in progress
+    // Args: None
+    // Return: bool - true if state is RUNNING
+    bool is_busy();
+    
+    // Purpose: Get the state of the motion engine
+    // Args: None
+    // Return: MotionState - IDLE, RUNNING, COMPLETE or CANCELLED
+    MotionState get_motion_state();
+    
+    // Purpose: Block until the running motion finishes
+    // Description: Calls poll() in a loop; used by the blocking primitives
+    // Args: None
+    // Return: void
+    void wait_for_motion();
+    
+    // Purpose: Select how distance/angle primitives terminate
+    // Args: mode - StopMode::TIMER or StopMode::ENCODER
+    // Return: void
+    void set_stop_mode(StopMode mode);
+    
+    // Purpose: Get the current termination mode
+    // Args: None
+    // Return: StopMode - TIMER or ENCODER
+    StopMode get_stop_mode();
+    
+    // Purpose: Set the deceleration used for the braking look-ahead
+    // Description: Lower values stop earlier; tune until encoder moves neither
+    //   overshoot nor undershoot at the speeds in use
+    // Args: decel_mm_per_s2 - wheel deceleration after halt (positive)
+    // Return: void
+    void set_brake_deceleration(float decel_mm_per_s2);
+    
+    // Purpose: Select the velocity profile shape used by all motion primitives
+    // Args: type - ProfileType::STEP, TRAPEZOIDAL or S_CURVE
+    // Return: void
+    void set_profile_type(ProfileType type);
+    
+    // Purpose: Get the velocity profile shape
+    // Args: None
+    // Return: ProfileType
+    ProfileType get_profile_type();
+    
+    // Purpose: Set acceleration and jerk limits of the velocity profile
+    // Args: max_accel_mm_per_s2 - acceleration limit (positive)
+    //       max_jerk_mm_per_s3 - jerk limit (positive, S-curve only)
+    // Return: void
+    void set_profile_limits(float max_accel_mm_per_s2, float max_jerk_mm_per_s3);
+    
+    // Purpose: Get the encoder-measured progress of the current/last motion
+    // Args: None
+    // Return: float - reference wheel travel since the motion started [mm]
+    float get_motion_progress_mm();
+    
+    // ========== SEGMENT QUEUE ==========
+    //
+    // Segments are validated when queued and run by start_queue(); poll() then
+    // moves from one segment to the next without halting.
+    //
+    //   robot.drive->queue_line(1.0, 0.2);
+    //   robot.drive->queue_turn(-M_PI / 2, 0.2);
+    //   robot.drive->start_queue();
+    //   while (robot.drive->poll()) {
+    //     robot.navigator->update();
+    //   }
+    
+    // Purpose: Append a straight segment to the queue
+    // Args: distance_m - signed distance in meters (negative = backward)
+    //       speed_m_per_s - cruise speed in m/s (0.0 to 0.4)
+    // Return: bool - false if parameters are invalid or the queue is full
+    bool queue_line(float distance_m, float speed_m_per_s);
+    
+    // Purpose: Append a forward constant-radius arc to the queue
+    // Args: radius_m - turning radius of the robot centre in meters (positive)
+    //       angle_rad - signed sweep angle (positive = left/counterclockwise)
+    //       speed_m_per_s - cruise speed of the robot centre in m/s (0.0 to 0.4)
+    // Return: bool - false if parameters are invalid or the queue is full
+    bool queue_arc(float radius_m, float angle_rad, float speed_m_per_s);
+    
+    // Purpose: Append an in-place rotation to the queue
+    // Args: angle_rad - signed rotation angle (positive = left/counterclockwise)
+    //       speed_m_per_s - wheel speed in m/s (0.0 to 0.4)
+    // Return: bool - false if parameters are invalid or the queue is full
+    bool queue_turn(float angle_rad, float speed_m_per_s);
+    
+    // Purpose: Start running the queued segments without blocking
+    // Description: Cancels any running motion; call poll() until it returns false
+    // Args: None
+    // Return: bool - false if the queue is empty
+    bool start_queue();
+    
+    // Purpose: Drop all queued segments and stop a running queue
+    // Args: None
+    // Return: void
+    void clear_queue();
+    
+    // Purpose: Get the number of segments still waiting to run
+    // Args: None
+    // Return: uint8_t - pending segments (the running one is not counted)
+    uint8_t get_queued_segments();
+    
+    // Purpose: Shortest time the queued segments can be run in
+    // Description: Uses the same junction speeds as start_queue() and the
+    //   trapezoidal bound of the velocity profile; used to judge lap times
+    // Args: None
+    // Return: float - time [s]
+    float estimate_queue_time_s();
+    
+    // Purpose: Get per-tick CPU cost of the motion engine
+    // Args: None
+    // Return: const MotionTickStats& - accumulated since the last reset_tick_stats()
+    const MotionTickStats& get_tick_stats();
+    
+    // Purpose: Clear the per-tick CPU cost statistics
+    // Args: None
+    // Return: void
+    void reset_tick_stats();
 
+    // Purpose: Drive with a linear and angular velocity (unicycle model)
+    // Description: Continuous like the unbounded helpers: cancels any running
+    //   motion and keeps driving until the next command or halt(). A saturating
+    //   wheel scales both wheels together so the path curvature is preserved.
+    //   (0, 0) stops the motors.
+    // Args: v_m_per_s - forward speed of the robot centre in m/s (negative = backward)
+    //       omega_rad_per_s - angular speed in rad/s (positive = counterclockwise)
+    // Return: bool - true if the command had to be scaled down
+    bool command_twist(float v_m_per_s, float omega_rad_per_s);
+    
     // Continuous low-level helpers (non-blocking, no delay): caller must halt() when done.
+    // Calling one of these cancels any running motion primitive.
     void drive_forward_unbounded(int speed_mm_per_s);
     void drive_backward_unbounded(int speed_mm_per_s);
     void turn_left_unbounded(int speed_mm_per_s);
     void turn_right_unbounded(int speed_mm_per_s);
     
+    // ========== CLOSED-LOOP VELOCITY CONTROL ==========
+    
+    // Purpose: Enable or disable the per-wheel velocity loop
+    // Description: When disabled, wheel speeds are sent to the motors as raw PWM
+    // Args: enable - true for closed-loop mm/s tracking, false for open-loop PWM
+    // Return: void
+    void set_closed_loop(bool enable);
+    
+    // Purpose: Check whether the velocity loop is enabled
+    // Args: None
+    // Return: bool - true if closed loop
+    bool is_closed_loop();
+    
+    // Purpose: Set the gains of both wheel velocity controllers
+    // Args: kp, ki, kd, kff - see WheelVelocityController::set_gains()
+    // Return: void
+    void set_velocity_gains(float kp, float ki, float kd, float kff);
+    
+    // Purpose: Measure both motors and store a new speed-to-PWM table
+    // Description: Blocking (~17 s); the robot spins in place in both
+    //   directions. The table is saved to EEPROM and used from the next motion on.
+    // Args: None
+    // Return: bool - false if the sweep failed (previous table is kept)
+    bool calibrate_motors();
+    
+    // Purpose: Check whether a measured motor table is in use
+    // Args: None
+    // Return: bool - true if loaded from EEPROM or calibrated
+    bool has_motor_calibration();
+    
+    // Purpose: Log the motor calibration table and current battery voltage
+    // Args: None
+    // Return: void
+    void log_motor_calibration();
+    
+    // Purpose: Get the measured left wheel speed
+    // Args: None
+    // Return: float - filtered speed in mm/s from the last control period
+    float get_left_wheel_speed();
+    
+    // Purpose: Get the measured right wheel speed
+    // Args: None
+    // Return: float - filtered speed in mm/s from the last control period
+    float get_right_wheel_speed();
+    
     // ========== CONFIGURATION ==========
     
     // Purpose: Configure the turn speed reduction factor
@@ -205,7 +572,7 @@ class DifferentialDrive : public Configurable {
     void flip_right_motor(bool flip);
     
     // Purpose: Stop all motors immediately
-    // Description: Sets both motor speeds to 0
+    // Description: Sets both motor speeds to 0 and cancels any running motion
     // Args: None
     // Return: void
     void halt();
@@ -214,10 +581,10 @@ class DifferentialDrive : public Configurable {
     // ========== LOW-LEVEL MOTOR CONTROL ==========
     
     // Purpose: Set motor speeds for the left and right wheels
-    // Description: Directly controls the left and right wheel DC motors in their raw speed range
-    //   Positive = forward, Negative = backward
-    // Args: left_speed_mm_per_s - left motor speed (typically -400 to 400)
-    //       right_speed_mm_per_s - right motor speed (typically -400 to 400)
+    // Description: Sets the velocity loop targets (closed loop) or the raw motor
+    //   PWM (open loop). Positive = forward, Negative = backward
+    // Args: left_speed_mm_per_s - left wheel speed (typically -400 to 400)
+    //       right_speed_mm_per_s - right wheel speed (typically -400 to 400)
     // Return: void
     void set_wheel_speeds(int left_speed_mm_per_s, int right_speed_mm_per_s);
     
@@ -246,12 +613,122 @@ class DifferentialDrive : public Configurable {
     void turn_right_low_level(int speed_mm_per_s);
     
     // Helper methods for duration-based turning
-    void turn_left_duration(float duration_s, float speed_m_per_s);
-    void turn_right_duration(float duration_s, float speed_m_per_s);
+    bool start_turn_left_duration(float duration_s, float speed_m_per_s);
+    bool start_turn_right_duration(float duration_s, float speed_m_per_s);
     
     // Helper methods for angle-based turning
-    void turn_left_angle(float angle_rad, float speed_m_per_s);
-    void turn_right_angle(float angle_rad, float speed_m_per_s);
+    bool start_turn_left_angle(float angle_rad, float speed_m_per_s);
+    bool start_turn_right_angle(float angle_rad, float speed_m_per_s);
+    
+    // Helper for the curved primitives: validates, then starts the implied arc
+    // Args: left_sign/right_sign - +1 or -1 applied to the wheel speeds
+    //       inner_is_left - true if the left wheel is the inner (slower) wheel
+    bool start_curve(float distance_m, float speed_m_per_s, int left_sign, int right_sign, bool inner_is_left);
+    
+    // ========== MOTION ENGINE INTERNALS ==========
+    
+    // Purpose: Plan the velocity profile and start driving the wheels
+    // Args: left_speed/right_speed - nominal (cruise) wheel speeds [mm/s]
+    //       duration_ms - unprofiled time of the motion, used for the stall timeout
+    //       distance_mm - reference wheel travel until the motion completes
+    //       encoder_stop - true to end on encoder counts (StopMode::ENCODER applies)
+    // Return: bool - false if the cruise speed is zero
+    bool begin_motion(float left_speed, float right_speed, unsigned long duration_ms,
+                      float distance_mm, bool encoder_stop);
+    
+    // Purpose: Start a single segment outside the queue
+    // Description: Wheel speeds and distance come from plan_segment(), so they
+    //   are computed once here and the control tick only scales them
+    // Args: segment - segment to run
+    //       reverse - drive the segment backwards (both wheel speeds negated)
+    // Return: bool - false if the cruise speed is zero
+    bool begin_segment(const MotionSegment &segment, bool reverse);
+    
+    // Purpose: Plan the velocity profile of one motion and command the wheels
+    // Description: Shared by begin_motion() and the segment queue; does not
+    //   reset the motion start time, so chained segments count as one motion
+    // Args: as begin_motion(), plus
+    //       start_speed/end_speed - reference wheel speed at either end [mm/s]
+    // Return: bool - false if the cruise speed is zero
+    bool launch_motion(float left_speed, float right_speed, unsigned long duration_ms,
+                       float distance_mm, bool encoder_stop,
+                       float start_speed, float end_speed);
+    
+    // Purpose: Check whether the running motion has covered its distance
+    // Description: Segments followed by another one end as soon as they reach
+    //   their distance; the last one uses the braking look-ahead
+    // Args: None
+    // Return: bool - true if the motion (or segment) is complete
+    bool motion_target_reached();
+    
+    // ========== SEGMENT QUEUE INTERNALS ==========
+    
+    // Purpose: Append a validated segment, logging if the queue is full
+    // Args: segment - segment to append
+    // Return: bool - false if the queue is full
+    bool push_segment(const MotionSegment &segment);
+    
+    // Purpose: Pop the next segment and start it
+    // Args: start_speed - robot centre speed handed over by the previous segment [mm/s]
+    //       carry_mm - distance the previous segment overshot by [mm]
+    // Return: bool - false if the queue is empty
+    bool start_next_segment(float start_speed, float carry_mm);
+    
+    // Purpose: Convert a segment into nominal wheel speeds
+    // Args: segment - segment to convert
+    //       left_speed/right_speed - receive the cruise wheel speeds [mm/s]
+    //       distance_mm - receives the mean wheel travel [mm]
+    // Return: float - ratio of mean wheel speed to robot centre speed
+    float plan_segment(const MotionSegment &segment, float &left_speed, float &right_speed, float &distance_mm);
+    
+    // Purpose: Highest centre speed at which segment a can hand over to segment b
+    // Args: a, b - consecutive segments
+    // Return: float - junction speed [mm/s], 0 for turns and reversals
+    float junction_speed(const MotionSegment &a, const MotionSegment &b);
+    
+    // Purpose: Highest speed a segment may end with so the queue after it can still stop
+    // Args: segment - segment whose end speed is wanted
+    //       next_index - queue offset of the segment that follows it
+    // Return: float - centre speed [mm/s]
+    float segment_exit_speed(const MotionSegment &segment, uint8_t next_index);
+    
+    // Purpose: Stop a running queue and drop its pending segments
+    // Args: None
+    // Return: void
+    void abort_queue();
+    
+    // Purpose: Advance the running motion by one control period
+    // Description: Checks the end condition, then steps the profile and
+    //   commands the scaled wheel speeds
+    // Args: dt_s - time since the previous control period [s]
+    // Return: void
+    void advance_motion(float dt_s);
+    
+    // Purpose: Set wheel targets without the stop-on-zero semantics of set_wheel_speeds()
+    // Description: Starts the velocity loop if it is not running
+    // Args: left_speed/right_speed - wheel speeds [mm/s] (closed loop) or PWM (open loop)
+    // Return: void
+    void apply_wheel_speeds(float left_speed, float right_speed);
+    
+    // Purpose: Check the encoder end condition including braking look-ahead
+    // Args: None
+    // Return: bool - true if the motors should be stopped now
+    bool encoder_target_reached();
+    
+    // Purpose: Stop both motors and the velocity loop
+    // Args: None
+    // Return: void
+    void stop_motors();
+    
+    // Purpose: Run one period of the wheel velocity loop
+    // Args: now_us - micros() at the start of the tick
+    // Return: void
+    void update_velocity_control(unsigned long now_us);
+    
+    // Purpose: Stop the motors and leave the RUNNING state
+    // Args: end_state - COMPLETE or CANCELLED
+    // Return: void
+    void end_motion(MotionState end_state);
     
     // ========== DATA MEMBERS ==========
     
@@ -259,6 +736,42 @@ class DifferentialDrive : public Configurable {
     Motors motors;                // Pololu Motors class controlling both DC motors
     float turn_speed_ratio;       // Inner wheel speed multiplier [0.0, 1.0]
     float wheelbase_mm;           // Distance between left and right wheels (mm)
+    
+    // Motion engine state
+    MotionState motion_state;           // Current engine state
+    unsigned long motion_start_ms;      // millis() when the running motion started
+    unsigned long motion_duration_ms;   // Planned duration of the running motion
+    unsigned long motion_start_us;      // micros() when the running motion started
+    MotionTickStats tick_stats;         // Per-tick CPU cost of poll()
+    StopMode stop_mode;                 // How distance/angle motions terminate
+    float brake_decel_mm_per_s2;        // Deceleration assumed by the look-ahead
+    float motion_distance_mm;           // Reference wheel travel of the running motion
+    bool motion_encoder_stop;           // true: end on encoder progress, false: on commanded distance
+    float motion_commanded_mm;          // Integrated profile speed since motion start
+    float motion_left_nominal;          // Cruise wheel speeds of the running motion [mm/s]
+    float motion_right_nominal;
+    float motion_reference_speed;       // Cruise speed of the mean wheel [mm/s]
+    VelocityProfile profile;            // Speed ramp of the running motion
+    float motion_speed_ratio;           // Reference wheel speed / robot centre speed
+    int32_t motion_left_counts;         // Left encoder counts since motion start
+    int32_t motion_right_counts;        // Right encoder counts since motion start
+    float mm_per_count;                 // Wheel travel per encoder count [mm]
+    
+    // Segment queue state
+    MotionQueue motion_queue;           // Segments waiting to run
+    bool queue_running;                 // true while poll() is working through the queue
+    
+    // Velocity loop state
+    Encoders encoders;                        // Pololu encoders (read without reset)
+    WheelVelocityController left_velocity;    // Left wheel speed loop
+    WheelVelocityController right_velocity;   // Right wheel speed loop
+    bool closed_loop;                         // true: targets in mm/s, false: raw PWM
+    bool velocity_active;                     // true while a non-zero speed is commanded
+    int16_t last_left_counts;                 // Encoder counts at the last control period
+    int16_t last_right_counts;
+    unsigned long last_control_us;            // micros() at the last control period
+    MotorCalibration calibration;             // Speed-to-PWM table for the feed-forward
+    unsigned long last_battery_ms;            // millis() of the last battery sample
 };
 
 #endif
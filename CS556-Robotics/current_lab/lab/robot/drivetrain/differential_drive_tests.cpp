@@ -70,6 +70,157 @@ void test_move_backward_turning_right() {
   delay(2000);
 }
 
+void test_arc() {
+  String msg = "9. Quarter arcs of radius " + String(ARC_RADIUS_M) + " m left then right at " + String(ROBOT_SPEED_M_PER_S) + " m/s";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, msg.c_str());
+  robot.drive->arc(ARC_RADIUS_M, M_PI / 2.0f, ROBOT_SPEED_M_PER_S);
+  delay(2000);
+  robot.drive->arc(ARC_RADIUS_M, -M_PI / 2.0f, ROBOT_SPEED_M_PER_S);
+  delay(2000);
+}
+
+// Rise time and steady-state error of one wheel during a step
+struct StepTracker {
+  unsigned long t10_ms;     // First time the speed reached 10% of target (0 = not yet)
+  unsigned long t90_ms;     // First time the speed reached 90% of target (0 = not yet)
+  float error_sum;          // Sum of |target - measured| over the steady window
+};
+
+static void track_step(StepTracker &tracker, float measured, float target, unsigned long elapsed_ms, bool in_window) {
+  if (tracker.t10_ms == 0 && measured >= 0.1f * target) {
+    tracker.t10_ms = elapsed_ms;
+  }
+  if (tracker.t90_ms == 0 && measured >= 0.9f * target) {
+    tracker.t90_ms = elapsed_ms;
+  }
+  if (in_window) {
+    tracker.error_sum += fabs(target - measured);
+  }
+}
+
+static void log_step(const char *wheel, const StepTracker &tracker, int samples) {
+  long rise_ms = (tracker.t10_ms > 0 && tracker.t90_ms > 0) ? (long)(tracker.t90_ms - tracker.t10_ms) : -1;
+  float sse = samples > 0 ? tracker.error_sum / samples : 0.0f;
+  String msg = String(wheel) + ": rise=" + String(rise_ms) + " ms, steady-state error=" + String(sse) + " mm/s";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, msg.c_str());
+}
+
+static void run_step(int target_mm_per_s, bool closed_loop) {
+  robot.drive->set_closed_loop(closed_loop);
+  robot.drive->halt();
+  delay(500);
+
+  StepTracker left = {0, 0, 0.0f};
+  StepTracker right = {0, 0, 0.0f};
+  float mismatch_sum = 0.0f;
+  int window_samples = 0;
+
+  robot.drive->drive_forward_unbounded(target_mm_per_s);
+  unsigned long start_ms = millis();
+  unsigned long next_sample_ms = start_ms;
+
+  while ((unsigned long)(millis() - start_ms) < STEP_RECORD_MS) {
+    robot.drive->poll();
+
+    unsigned long now_ms = millis();
+    if ((long)(now_ms - next_sample_ms) < 0) {
+      continue;
+    }
+    next_sample_ms += VELOCITY_CONTROL_PERIOD_US / 1000;
+
+    unsigned long elapsed_ms = now_ms - start_ms;
+    bool in_window = elapsed_ms >= STEP_RECORD_MS - STEP_STEADY_WINDOW_MS;
+    float v_left = robot.drive->get_left_wheel_speed();
+    float v_right = robot.drive->get_right_wheel_speed();
+
+    track_step(left, v_left, target_mm_per_s, elapsed_ms, in_window);
+    track_step(right, v_right, target_mm_per_s, elapsed_ms, in_window);
+    if (in_window) {
+      mismatch_sum += fabs(v_left - v_right);
+      window_samples++;
+    }
+  }
+
+  robot.drive->halt();
+
+  String header = String(closed_loop ? "closed" : "open") + " loop, step to " + String(target_mm_per_s) + " mm/s";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, header.c_str());
+  log_step("left", left, window_samples);
+  log_step("right", right, window_samples);
+  float mismatch = window_samples > 0 ? mismatch_sum / window_samples : 0.0f;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("left/right mismatch=" + String(mismatch) + " mm/s").c_str());
+}
+
+void test_velocity_step_response() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Velocity step response (robot drives forward, needs ~2 m of floor)");
+
+  bool was_closed_loop = robot.drive->is_closed_loop();
+  const int num_steps = sizeof(STEP_TARGETS_MM_PER_S) / sizeof(STEP_TARGETS_MM_PER_S[0]);
+
+  for (int i = 0; i < num_steps; i++) {
+    run_step(STEP_TARGETS_MM_PER_S[i], false);
+    run_step(STEP_TARGETS_MM_PER_S[i], true);
+  }
+
+  robot.drive->set_closed_loop(was_closed_loop);
+  delay(2000);
+}
+
+void test_motor_calibration() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Motor calibration (robot spins in place, then drives ~2 m forward)");
+
+  if (!robot.drive->calibrate_motors()) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Calibration failed");
+    return;
+  }
+  robot.drive->log_motor_calibration();
+
+  bool was_closed_loop = robot.drive->is_closed_loop();
+  robot.drive->set_velocity_gains(0.0f, 0.0f, 0.0f, DEFAULT_VELOCITY_KFF);
+
+  const int num_steps = sizeof(STEP_TARGETS_MM_PER_S) / sizeof(STEP_TARGETS_MM_PER_S[0]);
+  for (int i = 0; i < num_steps; i++) {
+    run_step(STEP_TARGETS_MM_PER_S[i], true);
+  }
+
+  robot.drive->set_velocity_gains(DEFAULT_VELOCITY_KP, DEFAULT_VELOCITY_KI, DEFAULT_VELOCITY_KD, DEFAULT_VELOCITY_KFF);
+  robot.drive->set_closed_loop(was_closed_loop);
+  delay(2000);
+}
+
+void test_command_twist() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Twist: one full circle, commanded every control period");
+
+  // One revolution takes 2*pi / omega seconds.
+  unsigned long circle_ms = (unsigned long)(2000.0f * M_PI / TWIST_OMEGA_RAD_PER_S);
+  unsigned long start_ms = millis();
+  unsigned long next_command_ms = start_ms;
+  while ((unsigned long)(millis() - start_ms) < circle_ms) {
+    if ((long)(millis() - next_command_ms) >= 0) {
+      robot.drive->command_twist(ROBOT_SPEED_M_PER_S, TWIST_OMEGA_RAD_PER_S);
+      next_command_ms += VELOCITY_CONTROL_PERIOD_US / 1000;
+    }
+    robot.drive->poll();
+  }
+  robot.drive->halt();
+  delay(1000);
+
+  // 0.4 m/s at 4 rad/s asks for ~600 mm/s on the outer wheel.
+  bool saturated = robot.drive->command_twist(0.4f, 4.0f);
+  robot.drive->halt();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, saturated ? "Saturating command scaled down" : "Saturating command NOT scaled");
+
+  // CPU cost: the command is issued at rest and stopped again right away.
+  unsigned long begin_us = micros();
+  for (int i = 0; i < TWIST_TIMING_CALLS; i++) {
+    robot.drive->command_twist(0.1f, (i & 1) ? 0.5f : -0.5f);
+  }
+  unsigned long per_call_us = (micros() - begin_us) / TWIST_TIMING_CALLS;
+  robot.drive->halt();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("command_twist: " + String(per_call_us) + " us per call").c_str());
+  delay(2000);
+}
+
 void run_all_tests() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Starting all tests");
   test_move_forward();
@@ -80,5 +231,6 @@ void run_all_tests() {
   test_move_forward_turning_left();
   test_move_backward_turning_left();
   test_move_backward_turning_right();
+  test_arc();
   Logger::log_info(CLASS_NAME, __FUNCTION__, "All tests complete");
 }
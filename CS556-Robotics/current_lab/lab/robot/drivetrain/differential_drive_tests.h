@@ -5,6 +5,14 @@
 const float ROBOT_SPEED_M_PER_S = 0.1;  // 0.1 m/s
 const float DURATION_S = 0.94;          // 0.94 seconds
 const float DISTANCE_M = 1.0;           // 1 meter
+const float ARC_RADIUS_M = 0.3;         // 30 cm radius
+const float TWIST_OMEGA_RAD_PER_S = 0.5;  // Circle of radius ROBOT_SPEED_M_PER_S / 0.5 = 20 cm
+const int TWIST_TIMING_CALLS = 1000;    // Calls averaged for the CPU time measurement
+
+// Velocity step-response benchmark parameters
+const int STEP_TARGETS_MM_PER_S[] = {100, 200, 300};  // Step sizes to benchmark
+const unsigned long STEP_RECORD_MS = 1500;            // Recording time per step
+const unsigned long STEP_STEADY_WINDOW_MS = 500;      // Final window used for steady-state error
 
 // Test functions for differential drive
 void print_test_parameters();
@@ -16,6 +24,21 @@ void test_move_forward_turning_right();
 void test_move_forward_turning_left();
 void test_move_backward_turning_left();
 void test_move_backward_turning_right();
+void test_arc();
+
+// Velocity loop benchmark: rise time (10%-90%), steady-state error and
+// left/right mismatch for each step in STEP_TARGETS_MM_PER_S, open vs closed loop
+void test_velocity_step_response();
+
+// Motor calibration: runs the PWM sweep (robot spins in place), logs the table,
+// then repeats the step response with feed-forward only (kp = ki = kd = 0) so
+// the steady-state error shows how well the table alone predicts wheel speed
+void test_motor_calibration();
+
+// Twist interface: drives one circle with command_twist() called every control
+// period, checks that a saturating command keeps its curvature and logs the
+// CPU time of one call
+void test_command_twist();
 
 // Run all tests in sequence
 void run_all_tests();
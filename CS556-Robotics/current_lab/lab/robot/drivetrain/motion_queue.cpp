@@ -0,0 +1,51 @@
+#include "motion_queue.h"
+
+MotionQueue::MotionQueue() {
+  clear();
+}
+
+bool MotionQueue::push(const MotionSegment &segment) {
+  if (is_full()) {
+    return false;
+  }
+
+  uint8_t tail = (head + count) % MOTION_QUEUE_CAPACITY;
+  segments[tail] = segment;
+  count++;
+  return true;
+}
+
+bool MotionQueue::pop(MotionSegment &segment) {
+  if (is_empty()) {
+    return false;
+  }
+
+  segment = segments[head];
+  head = (head + 1) % MOTION_QUEUE_CAPACITY;
+  count--;
+  return true;
+}
+
+const MotionSegment* MotionQueue::peek(uint8_t offset) const {
+  if (offset >= count) {
+    return nullptr;
+  }
+  return &segments[(head + offset) % MOTION_QUEUE_CAPACITY];
+}
+
+uint8_t MotionQueue::size() const {
+  return count;
+}
+
+bool MotionQueue::is_empty() const {
+  return count == 0;
+}
+
+bool MotionQueue::is_full() const {
+  return count >= MOTION_QUEUE_CAPACITY;
+}
+
+void MotionQueue::clear() {
+  head = 0;
+  count = 0;
+}
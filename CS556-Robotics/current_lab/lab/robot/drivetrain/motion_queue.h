@@ -0,0 +1,91 @@
+#ifndef motion_queue_h
+#define motion_queue_h
+
+#include <stdint.h>
+
+// ============================================================
+// MOTION SEGMENT QUEUE
+// ============================================================
+//
+// Purpose: Fixed-capacity FIFO of motion segments for back-to-back execution
+//
+// Description:
+//   DifferentialDrive pops one segment at a time and hands the speed at the
+//   end of a segment to the start of the next one, so a course such as a
+//   square runs without halting between legs. The queue is a ring buffer in a
+//   static array; nothing is allocated at run time.
+//
+// Segment Conventions:
+//   - LINE: distance_mm signed (negative = backward)
+//   - ARC:  radius_mm > 0, angle_rad signed (positive = left/CCW), driving forward
+//   - TURN: in-place rotation, angle_rad signed (positive = left/CCW)
+//   - speed_mm_per_s is the cruise speed of the mean wheel (robot centre for
+//     LINE/ARC, wheel rim for TURN)
+//
+// ============================================================
+
+const uint8_t MOTION_QUEUE_CAPACITY = 16;  // Maximum number of pending segments
+
+enum class SegmentType {
+  LINE,   // Straight line
+  ARC,    // Constant-radius arc
+  TURN    // In-place rotation
+};
+
+struct MotionSegment {
+  SegmentType type;
+  float distance_mm;       // LINE: signed length [mm]
+  float radius_mm;         // ARC: turning radius of the robot centre [mm]
+  float angle_rad;         // ARC/TURN: signed sweep angle [rad]
+  float speed_mm_per_s;    // Cruise speed of the mean wheel [mm/s]
+};
+
+class MotionQueue {
+  public:
+    // Purpose: Initialize an empty queue
+    // Args: None
+    // Return: void
+    MotionQueue();
+
+    // Purpose: Append a segment at the tail
+    // Args: segment - segment to copy into the queue
+    // Return: bool - false if the queue is full
+    bool push(const MotionSegment &segment);
+
+    // Purpose: Remove the segment at the head
+    // Args: segment - receives the removed segment
+    // Return: bool - false if the queue is empty
+    bool pop(MotionSegment &segment);
+
+    // Purpose: Look at a pending segment without removing it
+    // Args: offset - 0 for the head, 1 for the one after, ...
+    // Return: const MotionSegment* - nullptr if offset >= size()
+    const MotionSegment* peek(uint8_t offset) const;
+
+    // Purpose: Number of pending segments
+    // Args: None
+    // Return: uint8_t
+    uint8_t size() const;
+
+    // Purpose: Check for pending segments
+    // Args: None
+    // Return: bool - true if no segment is pending
+    bool is_empty() const;
+
+    // Purpose: Check for free space
+    // Args: None
+    // Return: bool - true if push() would fail
+    bool is_full() const;
+
+    // Purpose: Drop all pending segments
+    // Args: None
+    // Return: void
+    void clear();
+
+  private:
+    MotionSegment segments[MOTION_QUEUE_CAPACITY];  // Ring buffer storage
+    uint8_t head;                                   // Index of the oldest segment
+    uint8_t count;                                  // Number of pending segments
+};
+
+#endif
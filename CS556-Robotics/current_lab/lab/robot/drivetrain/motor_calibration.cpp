@@ -0,0 +1,247 @@
+#include "motor_calibration.h"
+#include <EEPROM.h>
+#include <stddef.h>
+#include "../utils/eeprom_layout.h"
+#include "../utils/logger.h"
+#include "../utils/util.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "MotorCalibration"
+
+MotorCalibration::MotorCalibration() {
+  record.magic = 0;
+  record.version = 0;
+  record.reference_mv = CALIBRATION_REFERENCE_MV;
+  for (uint8_t side = 0; side < 2; side++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      for (uint8_t i = 0; i < CALIBRATION_TABLE_SIZE; i++) {
+        record.pwm[side][dir][i] = 0;
+      }
+    }
+  }
+  record.checksum = 0;
+  valid = false;
+  battery_mv = CALIBRATION_REFERENCE_MV;
+  battery_scale = 1.0f;
+}
+
+// ========== CALIBRATION ==========
+
+bool MotorCalibration::calibrate(Motors &motors, Encoders &encoders, float mm_per_count) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Starting PWM sweep (robot spins in place)");
+
+  // Effective PWM and measured speed per [side][direction][sweep point].
+  float pwm[2][2][CALIBRATION_SWEEP_POINTS];
+  float speed[2][2][CALIBRATION_SWEEP_POINTS];
+
+  // Direction 0: left forward, right reverse. Direction 1: left reverse, right forward.
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    int16_t sign = dir == 0 ? 1 : -1;
+
+    for (uint8_t k = 0; k < CALIBRATION_SWEEP_POINTS; k++) {
+      int16_t level = k * CALIBRATION_PWM_STEP;
+      float left_speed, right_speed;
+      uint16_t mv;
+      measure(motors, encoders, mm_per_count, sign * level, -sign * level, left_speed, right_speed, mv);
+
+      float effective = level * (float)mv / CALIBRATION_REFERENCE_MV;
+      uint8_t right_dir = 1 - dir;
+      pwm[(uint8_t)MotorSide::LEFT][dir][k] = effective;
+      speed[(uint8_t)MotorSide::LEFT][dir][k] = fabs(left_speed);
+      pwm[(uint8_t)MotorSide::RIGHT][right_dir][k] = effective;
+      speed[(uint8_t)MotorSide::RIGHT][right_dir][k] = fabs(right_speed);
+
+      Logger::log_debug(CLASS_NAME, __FUNCTION__, ("pwm=" + String(sign * level) + " left=" + String(left_speed) +
+                                                   " right=" + String(right_speed) + " mm/s, battery=" + String(mv) + " mV").c_str());
+    }
+
+    motors.setSpeeds(0, 0);
+    delay(CALIBRATION_SETTLE_MS);
+  }
+
+  MotorCalibrationRecord candidate = record;
+  for (uint8_t side = 0; side < 2; side++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      if (!build_row(pwm[side][dir], speed[side][dir], candidate.pwm[side][dir])) {
+        Logger::log_error(CLASS_NAME, __FUNCTION__, ("Wheel " + String(side == 0 ? "left" : "right") +
+                                                     " did not reach the minimum speed, keeping previous table").c_str());
+        return false;
+      }
+    }
+  }
+
+  candidate.magic = CALIBRATION_MAGIC;
+  candidate.version = CALIBRATION_VERSION;
+  candidate.reference_mv = CALIBRATION_REFERENCE_MV;
+  candidate.checksum = record_checksum(candidate);
+  record = candidate;
+  valid = true;
+  update_battery();
+
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration complete");
+  return true;
+}
+
+bool MotorCalibration::load() {
+  MotorCalibrationRecord stored;
+  EEPROM.get(EEPROM_MOTOR_CALIBRATION_ADDR, stored);
+
+  if (stored.magic != CALIBRATION_MAGIC || stored.version != CALIBRATION_VERSION) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "No calibration stored, using nominal feed-forward");
+    return false;
+  }
+  if (stored.checksum != record_checksum(stored)) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Calibration checksum mismatch, ignoring stored table");
+    return false;
+  }
+
+  record = stored;
+  valid = true;
+  update_battery();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration loaded from EEPROM");
+  return true;
+}
+
+bool MotorCalibration::save() {
+  if (!valid) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "No calibration to save");
+    return false;
+  }
+
+  EEPROM.put(EEPROM_MOTOR_CALIBRATION_ADDR, record);
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration saved to EEPROM");
+  return true;
+}
+
+bool MotorCalibration::is_valid() const {
+  return valid;
+}
+
+void MotorCalibration::log_table() const {
+  if (!valid) {
+    Logger::log_info(CLASS_NAME, __FUNCTION__, "No calibration table");
+    return;
+  }
+
+  const char *names[2][2] = {{"left fwd", "left rev"}, {"right fwd", "right rev"}};
+  for (uint8_t side = 0; side < 2; side++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      String row = String(names[side][dir]) + ":";
+      for (uint8_t i = 0; i < CALIBRATION_TABLE_SIZE; i++) {
+        row += " " + String(record.pwm[side][dir][i] >> CALIBRATION_PWM_FRACTION_BITS);
+      }
+      Logger::log_info(CLASS_NAME, __FUNCTION__, row.c_str());
+    }
+  }
+}
+
+// ========== LOOKUP ==========
+
+void MotorCalibration::update_battery() {
+  battery_mv = readBatteryMillivolts();
+
+  // On USB power with the switch off the reading is meaningless.
+  if (battery_mv < CALIBRATION_MIN_BATTERY_MV) {
+    battery_scale = 1.0f;
+  } else {
+    battery_scale = (float)record.reference_mv / battery_mv;
+  }
+}
+
+uint16_t MotorCalibration::get_battery_mv() const {
+  return battery_mv;
+}
+
+float MotorCalibration::speed_to_pwm(MotorSide side, float speed_mm_per_s) const {
+  if (!valid) {
+    return speed_mm_per_s;
+  }
+
+  float magnitude = fabs(speed_mm_per_s);
+  if (magnitude < 0.5f) {
+    return 0.0f;
+  }
+
+  const int16_t *row = record.pwm[(uint8_t)side][speed_mm_per_s < 0.0f ? 1 : 0];
+  float position = magnitude / CALIBRATION_SPEED_STEP_MM_PER_S;
+  uint8_t index = position < CALIBRATION_TABLE_SIZE - 2 ? (uint8_t)position : CALIBRATION_TABLE_SIZE - 2;
+  float fraction = position - index;  // > 1 past the last entry: linear extrapolation
+
+  float effective = row[index] + fraction * (row[index + 1] - row[index]);
+  float pwm = effective * battery_scale / (1 << CALIBRATION_PWM_FRACTION_BITS);
+
+  return speed_mm_per_s < 0.0f ? -pwm : pwm;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+void MotorCalibration::measure(Motors &motors, Encoders &encoders, float mm_per_count, int16_t left_pwm, int16_t right_pwm,
+                               float &left_speed, float &right_speed, uint16_t &battery_mv) {
+  motors.setSpeeds(left_pwm, right_pwm);
+  delay(CALIBRATION_SETTLE_MS);
+
+  // Battery sags under load: sample it while the motors run.
+  uint16_t mv_before = readBatteryMillivolts();
+  int16_t left_start = encoders.getCountsLeft();
+  int16_t right_start = encoders.getCountsRight();
+  unsigned long start_us = micros();
+
+  delay(CALIBRATION_MEASURE_MS);
+
+  int16_t left_delta = (int16_t)(encoders.getCountsLeft() - left_start);
+  int16_t right_delta = (int16_t)(encoders.getCountsRight() - right_start);
+  float elapsed_s = (micros() - start_us) * 1.0e-6f;
+  uint16_t mv_after = readBatteryMillivolts();
+
+  left_speed = left_delta * mm_per_count / elapsed_s;
+  right_speed = right_delta * mm_per_count / elapsed_s;
+  battery_mv = (mv_before + mv_after) / 2;
+  if (battery_mv < CALIBRATION_MIN_BATTERY_MV) {
+    battery_mv = CALIBRATION_REFERENCE_MV;
+  }
+}
+
+bool MotorCalibration::build_row(const float *pwm, float *speed, int16_t *row) {
+  // Friction and noise can make a reading dip; the inverse needs a monotonic curve.
+  for (uint8_t k = 1; k < CALIBRATION_SWEEP_POINTS; k++) {
+    if (speed[k] < speed[k - 1]) {
+      speed[k] = speed[k - 1];
+    }
+  }
+  if (speed[CALIBRATION_SWEEP_POINTS - 1] < CALIBRATION_MIN_TOP_SPEED_MM_PER_S) {
+    return false;
+  }
+
+  // Break-away: highest level at which the wheel still stood still.
+  uint8_t first = 0;
+  while (first + 1 < CALIBRATION_SWEEP_POINTS && speed[first + 1] < CALIBRATION_BREAKAWAY_MM_PER_S) {
+    first++;
+  }
+
+  uint8_t k = first + 1;
+  for (uint8_t i = 0; i < CALIBRATION_TABLE_SIZE; i++) {
+    float target = i * CALIBRATION_SPEED_STEP_MM_PER_S;
+    float effective;
+
+    if (i == 0) {
+      effective = pwm[first];
+    } else {
+      while (k < CALIBRATION_SWEEP_POINTS - 1 && speed[k] < target) {
+        k++;
+      }
+      // Interpolate inside the sweep, extrapolate along the last segment beyond it.
+      float span = speed[k] - speed[k - 1];
+      float fraction = span > 0.0f ? (target - speed[k - 1]) / span : 1.0f;
+      effective = pwm[k - 1] + fraction * (pwm[k] - pwm[k - 1]);
+    }
+
+    float fixed = effective * (1 << CALIBRATION_PWM_FRACTION_BITS);
+    row[i] = fixed > 32767.0f ? 32767 : (int16_t)fixed;
+  }
+
+  return true;
+}
+
+uint16_t MotorCalibration::record_checksum(const MotorCalibrationRecord &record) {
+  return calculate_checksum((const uint8_t *)&record, offsetof(MotorCalibrationRecord, checksum));
+}
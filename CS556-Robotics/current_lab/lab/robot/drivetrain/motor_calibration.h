@@ -0,0 +1,144 @@
+#ifndef motor_calibration_h
+#define motor_calibration_h
+
+#include <Pololu3piPlus32U4.h>
+#include <stdint.h>
+using namespace Pololu3piPlus32U4;
+
+// ============================================================
+// MOTOR CALIBRATION TABLE
+// ============================================================
+//
+// Purpose: Map a wheel speed in mm/s to the PWM that produces it, for the
+//   battery voltage the robot has right now
+//
+// Description:
+//   The motor driver applies PWM/400 of the battery voltage, so a fixed PWM
+//   gives a faster wheel on a fresh pack than on a sagging one, and the curve
+//   is not linear (dead band, friction). calibrate() spins the robot in place
+//   through a PWM sweep, measures each wheel in each direction from the
+//   encoders and builds an inverse table: PWM at uniform speed steps.
+//
+// Battery Normalisation:
+//   - Motor speed follows the applied voltage, PWM * V_batt
+//   - The sweep stores "effective PWM" = PWM * V_batt / V_ref (V_ref = reference_mv)
+//   - A lookup returns PWM = table(speed) * V_ref / V_batt(now)
+//   - V_batt is sampled by update_battery(), not on every lookup (analogRead is slow)
+//
+// Lookup (constant time, no search):
+//   - i = |speed| / CALIBRATION_SPEED_STEP_MM_PER_S, linear interpolation
+//     between entries i and i+1; extrapolated from the last two entries
+//   - Entry 0 holds the break-away PWM, so small targets overcome the dead band
+//
+// Storage:
+//   - The table is kept in fixed point (1/16 PWM) and saved to EEPROM at
+//     EEPROM_MOTOR_CALIBRATION_ADDR with a magic number, version and checksum
+//
+// ============================================================
+
+enum class MotorSide {
+  LEFT,
+  RIGHT
+};
+
+const uint8_t CALIBRATION_TABLE_SIZE = 17;                // Entries per wheel and direction
+const float CALIBRATION_SPEED_STEP_MM_PER_S = 25.0f;      // Speed between entries (0..400 mm/s)
+const uint8_t CALIBRATION_PWM_FRACTION_BITS = 4;          // Table fixed point: 1/16 PWM
+const int16_t CALIBRATION_PWM_STEP = 40;                  // PWM increment of the sweep
+const uint8_t CALIBRATION_SWEEP_POINTS = 11;              // 0, 40, ..., 400
+const unsigned long CALIBRATION_SETTLE_MS = 250;          // Wait after each PWM change
+const unsigned long CALIBRATION_MEASURE_MS = 500;         // Encoder counting window per PWM level
+const float CALIBRATION_BREAKAWAY_MM_PER_S = 5.0f;        // Below this the wheel counts as stopped
+const float CALIBRATION_MIN_TOP_SPEED_MM_PER_S = 100.0f;  // A sweep slower than this is rejected
+const uint16_t CALIBRATION_REFERENCE_MV = 5000;           // V_ref the table is normalised to
+const uint16_t CALIBRATION_MIN_BATTERY_MV = 3000;         // Below this (USB power) no compensation
+const uint16_t CALIBRATION_MAGIC = 0x4D43;                // "MC"
+const uint8_t CALIBRATION_VERSION = 1;
+
+// Persistent form of the table, stored as-is in EEPROM
+struct MotorCalibrationRecord {
+  uint16_t magic;
+  uint8_t version;
+  uint16_t reference_mv;
+  int16_t pwm[2][2][CALIBRATION_TABLE_SIZE];   // [side][forward, reverse][speed step], 1/16 PWM
+  uint16_t checksum;                           // calculate_checksum() of everything above
+};
+
+class MotorCalibration {
+  public:
+    // Purpose: Initialize an empty (invalid) calibration
+    // Args: None
+    // Return: void
+    MotorCalibration();
+
+    // ========== CALIBRATION ==========
+
+    // Purpose: Run the PWM sweep and rebuild the table
+    // Description: Blocking (~17 s). The robot spins in place, first
+    //   counterclockwise then clockwise, so it needs a clear area but no floor
+    //   travel. The previous table is kept if the sweep fails.
+    // Args: motors - motor driver to command
+    //       encoders - encoders to measure with (read without reset)
+    //       mm_per_count - wheel travel per encoder count [mm]
+    // Return: bool - true if a valid table was built
+    bool calibrate(Motors &motors, Encoders &encoders, float mm_per_count);
+
+    // Purpose: Load the table from EEPROM
+    // Args: None
+    // Return: bool - false if no valid record is stored
+    bool load();
+
+    // Purpose: Save the table to EEPROM
+    // Args: None
+    // Return: bool - false if there is no valid table to save
+    bool save();
+
+    // Purpose: Check whether lookups use a measured table
+    // Args: None
+    // Return: bool - true after a successful load() or calibrate()
+    bool is_valid() const;
+
+    // Purpose: Log the table (PWM per speed step, per wheel and direction)
+    // Args: None
+    // Return: void
+    void log_table() const;
+
+    // ========== LOOKUP ==========
+
+    // Purpose: Sample the battery voltage used to scale lookups
+    // Args: None
+    // Return: void
+    void update_battery();
+
+    // Purpose: Get the battery voltage of the last update_battery()
+    // Args: None
+    // Return: uint16_t - [mV]
+    uint16_t get_battery_mv() const;
+
+    // Purpose: PWM that drives a wheel at the given speed
+    // Description: Constant time: one table index, one interpolation, one scale
+    // Args: side - LEFT or RIGHT wheel
+    //       speed_mm_per_s - signed wheel speed [mm/s]
+    // Return: float - signed PWM (not clamped); speed itself if no table is loaded
+    float speed_to_pwm(MotorSide side, float speed_mm_per_s) const;
+
+  private:
+    // Purpose: Measure one wheel speed pair at a PWM level
+    // Return: void, speeds in mm/s (signed) and battery in mV
+    void measure(Motors &motors, Encoders &encoders, float mm_per_count, int16_t left_pwm, int16_t right_pwm,
+                 float &left_speed, float &right_speed, uint16_t &battery_mv);
+
+    // Purpose: Fill one table row from sweep points (effective PWM vs speed)
+    // Return: bool - false if the wheel never reached CALIBRATION_MIN_TOP_SPEED_MM_PER_S
+    bool build_row(const float *pwm, float *speed, int16_t *row);
+
+    // Purpose: Checksum of a record, excluding the checksum field itself
+    static uint16_t record_checksum(const MotorCalibrationRecord &record);
+
+    MotorCalibrationRecord record;   // Table and header, identical to the EEPROM copy
+    bool valid;                      // true if record holds a measured table
+    uint16_t battery_mv;             // Last sampled battery voltage [mV]
+    float battery_scale;             // reference_mv / battery_mv, 1 when not compensating
+};
+
+#endif
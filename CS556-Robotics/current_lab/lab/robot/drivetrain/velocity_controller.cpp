@@ -0,0 +1,113 @@
+#include "velocity_controller.h"
+#include "../utils/logger.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "WheelVelocityController"
+
+WheelVelocityController::WheelVelocityController() {
+  kp = DEFAULT_VELOCITY_KP;
+  ki = DEFAULT_VELOCITY_KI;
+  kd = DEFAULT_VELOCITY_KD;
+  kff = DEFAULT_VELOCITY_KFF;
+  mm_per_count = 1.0f;
+  calibration = nullptr;
+  side = MotorSide::LEFT;
+  target = 0.0f;
+  reset();
+}
+
+// ========== CONFIGURATION ==========
+
+void WheelVelocityController::set_gains(float kp, float ki, float kd, float kff) {
+  this->kp = kp;
+  this->ki = ki;
+  this->kd = kd;
+  this->kff = kff;
+}
+
+void WheelVelocityController::set_mm_per_count(float mm_per_count) {
+  if (mm_per_count > 0.0f) {
+    this->mm_per_count = mm_per_count;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid mm_per_count");
+  }
+}
+
+void WheelVelocityController::set_calibration(const MotorCalibration *calibration, MotorSide side) {
+  this->calibration = calibration;
+  this->side = side;
+}
+
+// ========== CONTROL ==========
+
+void WheelVelocityController::set_target(float target_mm_per_s) {
+  target = target_mm_per_s;
+}
+
+float WheelVelocityController::get_target() {
+  return target;
+}
+
+float WheelVelocityController::get_measured() {
+  return measured;
+}
+
+int16_t WheelVelocityController::get_output() {
+  return output;
+}
+
+int16_t WheelVelocityController::feed_forward() {
+  output = clamp_pwm(kff * feed_forward_pwm());
+  return output;
+}
+
+int16_t WheelVelocityController::update(int16_t delta_counts, unsigned long dt_us) {
+  if (dt_us == 0) {
+    return output;
+  }
+
+  float dt_s = dt_us * 1.0e-6f;
+  float previous = measured;
+  float raw = (delta_counts * mm_per_count) / dt_s;
+  measured += DEFAULT_VELOCITY_FILTER_ALPHA * (raw - measured);
+
+  float error = target - measured;
+  float derivative = (measured - previous) / dt_s;
+
+  float candidate_integral = integral + error * dt_s;
+  float pwm = kff * feed_forward_pwm() + kp * error + ki * candidate_integral - kd * derivative;
+
+  // Anti-windup: only keep the new integral if it does not push further into saturation.
+  bool saturated_high = pwm > MAX_MOTOR_PWM && error > 0.0f;
+  bool saturated_low = pwm < -MAX_MOTOR_PWM && error < 0.0f;
+  if (!saturated_high && !saturated_low) {
+    integral = candidate_integral;
+  }
+
+  output = clamp_pwm(pwm);
+  return output;
+}
+
+void WheelVelocityController::reset() {
+  measured = 0.0f;
+  integral = 0.0f;
+  output = 0;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+float WheelVelocityController::feed_forward_pwm() {
+  if (calibration != nullptr && calibration->is_valid()) {
+    return calibration->speed_to_pwm(side, target);
+  }
+  return target;
+}
+
+int16_t WheelVelocityController::clamp_pwm(float pwm) {
+  if (pwm > MAX_MOTOR_PWM) {
+    return MAX_MOTOR_PWM;
+  } else if (pwm < -MAX_MOTOR_PWM) {
+    return -MAX_MOTOR_PWM;
+  }
+  return (int16_t)pwm;
+}
@@ -0,0 +1,132 @@
+#ifndef velocity_controller_h
+#define velocity_controller_h
+
+#include <stdint.h>
+#include "motor_calibration.h"
+
+// ============================================================
+// WHEEL VELOCITY CONTROLLER
+// ============================================================
+//
+// Purpose: Closed-loop speed control of one wheel in real mm/s
+//
+// Description:
+//   Motors::setSpeeds() takes raw PWM units (-400..400), not a speed. The
+//   relation between the two depends on the motor, the battery and the floor,
+//   so commanding "200" gives a different speed on each wheel. This controller
+//   closes the loop on the encoder counts: every control period it converts the
+//   count delta to a measured wheel speed and computes the PWM that drives the
+//   error to zero.
+//
+// Control Law (evaluated at a fixed rate by DifferentialDrive):
+//   - v_meas = low-pass( delta_counts * mm_per_count / dt )
+//   - e      = v_target - v_meas
+//   - pwm    = kff * ff(v_target) + kp * e + ki * ∫e dt - kd * dv_meas/dt
+//     ff() is the battery-compensated MotorCalibration table when one is
+//     loaded, otherwise the identity (1 PWM per mm/s)
+//   - pwm is clamped to ±MAX_MOTOR_PWM; the integrator stops accumulating
+//     while the output is saturated in the direction of the error (anti-windup)
+//
+// The feed-forward term gets the wheel close to the target on the first tick;
+// the PI terms remove the remaining (battery/friction dependent) error.
+// The derivative acts on the measurement so target steps do not kick the output.
+//
+// ============================================================
+
+const int16_t MAX_MOTOR_PWM = 400;                  // Motors::setSpeeds() limit
+const float DEFAULT_VELOCITY_KP = 0.6f;             // PWM per (mm/s) of error
+const float DEFAULT_VELOCITY_KI = 8.0f;             // PWM per (mm/s * s) of accumulated error
+const float DEFAULT_VELOCITY_KD = 0.0f;             // PWM per (mm/s^2) of measured acceleration
+const float DEFAULT_VELOCITY_KFF = 1.0f;            // PWM per (mm/s) of target (~400 mm/s at full PWM, 75:1 gearing)
+const float DEFAULT_VELOCITY_FILTER_ALPHA = 0.5f;   // Low-pass weight of the newest speed sample (0, 1]
+
+class WheelVelocityController {
+  public:
+    // Purpose: Initialize controller with default gains and zero target
+    // Args: None
+    // Return: void
+    WheelVelocityController();
+
+    // ========== CONFIGURATION ==========
+
+    // Purpose: Set the controller gains
+    // Args: kp - proportional gain [PWM/(mm/s)]
+    //       ki - integral gain [PWM/(mm/s*s)]
+    //       kd - derivative gain [PWM/(mm/s^2)]
+    //       kff - feed-forward gain [PWM/(mm/s)]
+    // Return: void
+    void set_gains(float kp, float ki, float kd, float kff);
+
+    // Purpose: Set the encoder scale used to convert counts to distance
+    // Args: mm_per_count - wheel travel per encoder count [mm]
+    // Return: void
+    void set_mm_per_count(float mm_per_count);
+
+    // Purpose: Use a measured speed-to-PWM table for the feed-forward term
+    // Args: calibration - table shared by both wheels (nullptr for nominal feed-forward)
+    //       side - which wheel of the table this controller drives
+    // Return: void
+    void set_calibration(const MotorCalibration *calibration, MotorSide side);
+
+    // ========== CONTROL ==========
+
+    // Purpose: Set the target wheel speed
+    // Args: target_mm_per_s - signed wheel speed [mm/s]
+    // Return: void
+    void set_target(float target_mm_per_s);
+
+    // Purpose: Get the target wheel speed
+    // Args: None
+    // Return: float - target speed [mm/s]
+    float get_target();
+
+    // Purpose: Get the filtered measured wheel speed
+    // Args: None
+    // Return: float - measured speed [mm/s] as of the last update()
+    float get_measured();
+
+    // Purpose: Get the PWM command produced by the last update()
+    // Args: None
+    // Return: int16_t - PWM in [-MAX_MOTOR_PWM, MAX_MOTOR_PWM]
+    int16_t get_output();
+
+    // Purpose: Open-loop PWM for the current target (feed-forward only)
+    // Description: Used to command the motor before the first measurement exists
+    // Args: None
+    // Return: int16_t - PWM in [-MAX_MOTOR_PWM, MAX_MOTOR_PWM]
+    int16_t feed_forward();
+
+    // Purpose: Run one control step
+    // Args: delta_counts - encoder counts since the previous step
+    //       dt_us - time since the previous step [us]
+    // Return: int16_t - PWM command for Motors::setSpeeds()
+    int16_t update(int16_t delta_counts, unsigned long dt_us);
+
+    // Purpose: Clear integrator, filter and output state
+    // Description: Call when the wheel is stopped so the next start does not
+    //   inherit a stale integral term. The target is left unchanged.
+    // Args: None
+    // Return: void
+    void reset();
+
+  private:
+    // Purpose: Clamp a PWM value to the motor driver range
+    int16_t clamp_pwm(float pwm);
+
+    // Purpose: Feed-forward PWM for the current target (before kff)
+    float feed_forward_pwm();
+
+    float kp;                  // Proportional gain
+    float ki;                  // Integral gain
+    float kd;                  // Derivative gain
+    float kff;                 // Feed-forward gain
+    float mm_per_count;        // Wheel travel per encoder count [mm]
+    const MotorCalibration *calibration;  // Speed-to-PWM table, nullptr if none
+    MotorSide side;            // Wheel of the calibration table
+    float target;              // Target speed [mm/s]
+    float measured;            // Filtered measured speed [mm/s]
+    float integral;            // Accumulated error [mm]
+    int16_t output;            // Last PWM command
+};
+
+#endif
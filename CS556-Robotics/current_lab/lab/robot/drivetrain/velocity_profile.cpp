@@ -0,0 +1,152 @@
+#include "velocity_profile.h"
+#include "../utils/logger.h"
+#include "../utils/util.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "VelocityProfile"
+
+VelocityProfile::VelocityProfile() {
+  type = DEFAULT_PROFILE_TYPE;
+  max_accel = DEFAULT_PROFILE_ACCEL_MM_PER_S2;
+  max_jerk = DEFAULT_PROFILE_JERK_MM_PER_S3;
+  distance = 0.0f;
+  cruise_speed = 0.0f;
+  end_speed = 0.0f;
+  speed = 0.0f;
+  accel = 0.0f;
+}
+
+// ========== CONFIGURATION ==========
+
+void VelocityProfile::set_type(ProfileType type) {
+  this->type = type;
+}
+
+ProfileType VelocityProfile::get_type() {
+  return type;
+}
+
+void VelocityProfile::set_limits(float max_accel, float max_jerk) {
+  if (max_accel > 0.0f && max_jerk > 0.0f) {
+    this->max_accel = max_accel;
+    this->max_jerk = max_jerk;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid limits (must be positive)");
+  }
+}
+
+float VelocityProfile::get_max_acceleration() {
+  return max_accel;
+}
+
+// ========== PROFILE ==========
+
+void VelocityProfile::start(float distance, float cruise_speed, float start_speed, float end_speed) {
+  this->distance = distance;
+  this->cruise_speed = cruise_speed;
+  this->end_speed = end_speed < cruise_speed ? end_speed : cruise_speed;
+  speed = start_speed;
+  accel = 0.0f;
+}
+
+float VelocityProfile::step(float dt_s, float travelled) {
+  if (type == ProfileType::STEP) {
+    speed = cruise_speed;
+    accel = 0.0f;
+    return speed;
+  }
+
+  float remaining = distance - travelled;
+  float v_goal = end_speed;
+
+  if (remaining > 0.0f) {
+    // Distance consumed while the jerk limit builds up the deceleration.
+    float margin = (type == ProfileType::S_CURVE) ? speed * max_accel / max_jerk : 0.0f;
+    float braking = remaining - margin;
+    if (braking < 0.0f) {
+      braking = 0.0f;
+    }
+
+    float v_brake = sqrtf(end_speed * end_speed + 2.0f * max_accel * braking);
+    v_goal = v_brake < cruise_speed ? v_brake : cruise_speed;
+
+    // Never stall short of the target: the encoders must still see it.
+    float creep = PROFILE_CREEP_SPEED_MM_PER_S < cruise_speed ? PROFILE_CREEP_SPEED_MM_PER_S : cruise_speed;
+    if (v_goal < creep) {
+      v_goal = creep;
+    }
+  }
+
+  float error = v_goal - speed;
+
+  if (type == ProfileType::TRAPEZOIDAL) {
+    accel = dt_s > 0.0f ? error / dt_s : 0.0f;
+    if (accel > max_accel) {
+      accel = max_accel;
+    } else if (accel < -max_accel) {
+      accel = -max_accel;
+    }
+  } else {
+    // Acceleration that reaches v_goal with zero acceleration under the jerk limit.
+    float a_des = sqrtf(2.0f * max_jerk * fabs(error));
+    if (a_des > max_accel) {
+      a_des = max_accel;
+    }
+    if (error < 0.0f) {
+      a_des = -a_des;
+    }
+
+    float max_change = max_jerk * dt_s;
+    float change = a_des - accel;
+    if (change > max_change) {
+      change = max_change;
+    } else if (change < -max_change) {
+      change = -max_change;
+    }
+    accel += change;
+  }
+
+  float next = speed + accel * dt_s;
+
+  // Do not overshoot the goal because of the discrete step.
+  if ((error >= 0.0f && next > v_goal) || (error < 0.0f && next < v_goal)) {
+    next = v_goal;
+    accel = 0.0f;
+  }
+  speed = next > 0.0f ? next : 0.0f;
+
+  return speed;
+}
+
+float VelocityProfile::get_speed() {
+  return speed;
+}
+
+float VelocityProfile::get_acceleration() {
+  return accel;
+}
+
+float VelocityProfile::minimum_time(float distance, float cruise_speed, float start_speed, float end_speed) {
+  if (distance <= 0.0f || cruise_speed <= 0.0f) {
+    return 0.0f;
+  }
+
+  // Peak speed of a triangle profile, capped at the cruise speed.
+  float v_peak = sqrtf((2.0f * max_accel * distance + start_speed * start_speed + end_speed * end_speed) / 2.0f);
+  if (v_peak > cruise_speed) {
+    v_peak = cruise_speed;
+  }
+
+  float accel_distance = (v_peak * v_peak - start_speed * start_speed) / (2.0f * max_accel);
+  float decel_distance = (v_peak * v_peak - end_speed * end_speed) / (2.0f * max_accel);
+  float cruise_distance = distance - accel_distance - decel_distance;
+  if (cruise_distance < 0.0f) {
+    cruise_distance = 0.0f;
+  }
+
+  return fabs(v_peak - start_speed) / max_accel + fabs(v_peak - end_speed) / max_accel + cruise_distance / v_peak;
+}
+
+float VelocityProfile::get_cruise_speed() {
+  return cruise_speed;
+}
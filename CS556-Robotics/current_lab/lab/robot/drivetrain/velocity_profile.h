@@ -0,0 +1,127 @@
+#ifndef velocity_profile_h
+#define velocity_profile_h
+
+// ============================================================
+// VELOCITY PROFILE GENERATOR
+// ============================================================
+//
+// Purpose: Shape the speed of a motion so it ramps up and down smoothly
+//
+// Description:
+//   Stepping a wheel from 0 to full speed in one Motors::setSpeeds() call makes
+//   the tyres slip, and every slipped millimetre is an odometry error. The
+//   profile limits acceleration (trapezoidal) and optionally jerk (S-curve) and
+//   plans the deceleration so the motion arrives at its end speed exactly at
+//   the target distance.
+//
+// Online Formulation (one step() per control tick, constant time):
+//   - remaining  = distance - travelled
+//   - v_brake    = sqrt(v_end^2 + 2 * a_max * remaining')   highest speed that can still stop
+//       remaining' = remaining - v * a_max / j_max          for S-curve (time to build up decel)
+//   - v_goal     = min(v_cruise, v_brake)
+//   - TRAPEZOIDAL: a = clamp((v_goal - v) / dt, ±a_max)
+//   - S_CURVE:     a_des = sign(e) * min(a_max, sqrt(2 * j_max * |e|)),  e = v_goal - v
+//                  a moves towards a_des by at most j_max * dt
+//   - v += a * dt
+//
+// The profile works on a speed magnitude along the motion; DifferentialDrive
+// scales the nominal wheel speeds of the primitive by v / v_cruise. Because
+// 'travelled' can come from the encoders, the profile follows the real robot
+// rather than an idealised timeline.
+//
+// ============================================================
+
+enum class ProfileType {
+  STEP,         // No shaping: full cruise speed immediately (original behaviour)
+  TRAPEZOIDAL,  // Acceleration limited
+  S_CURVE       // Acceleration and jerk limited
+};
+
+const ProfileType DEFAULT_PROFILE_TYPE = ProfileType::S_CURVE;
+const float DEFAULT_PROFILE_ACCEL_MM_PER_S2 = 800.0f;   // Max acceleration [mm/s^2]
+const float DEFAULT_PROFILE_JERK_MM_PER_S3 = 8000.0f;   // Max jerk [mm/s^3] (S-curve only)
+const float PROFILE_CREEP_SPEED_MM_PER_S = 20.0f;       // Minimum speed while short of the target [mm/s]
+
+class VelocityProfile {
+  public:
+    // Purpose: Initialize an idle profile with default limits
+    // Args: None
+    // Return: void
+    VelocityProfile();
+
+    // ========== CONFIGURATION ==========
+
+    // Purpose: Select the profile shape
+    // Args: type - STEP, TRAPEZOIDAL or S_CURVE
+    // Return: void
+    void set_type(ProfileType type);
+
+    // Purpose: Get the profile shape
+    // Args: None
+    // Return: ProfileType
+    ProfileType get_type();
+
+    // Purpose: Set acceleration and jerk limits
+    // Args: max_accel - acceleration limit [mm/s^2] (positive)
+    //       max_jerk - jerk limit [mm/s^3] (positive, S-curve only)
+    // Return: void
+    void set_limits(float max_accel, float max_jerk);
+
+    // Purpose: Get the acceleration limit
+    // Args: None
+    // Return: float - [mm/s^2]
+    float get_max_acceleration();
+
+    // ========== PROFILE ==========
+
+    // Purpose: Plan a new motion
+    // Args: distance - path length to cover [mm] (positive)
+    //       cruise_speed - speed to hold between the ramps [mm/s] (positive)
+    //       start_speed - speed at the start of the motion [mm/s]
+    //       end_speed - speed to arrive with at the target [mm/s]
+    // Return: void
+    void start(float distance, float cruise_speed, float start_speed = 0.0f, float end_speed = 0.0f);
+
+    // Purpose: Advance the profile by one control tick
+    // Description: Constant time; one sqrt per call
+    // Args: dt_s - time since the previous step [s]
+    //       travelled - distance covered so far [mm] (encoders or integrated command)
+    // Return: float - commanded speed [mm/s], >= 0
+    float step(float dt_s, float travelled);
+
+    // Purpose: Get the commanded speed of the last step
+    // Args: None
+    // Return: float - [mm/s]
+    float get_speed();
+
+    // Purpose: Get the commanded acceleration of the last step
+    // Args: None
+    // Return: float - [mm/s^2]
+    float get_acceleration();
+
+    // Purpose: Shortest time to cover a distance under the acceleration limit
+    // Description: Trapezoidal bound used to judge how close a run came to
+    //   optimal; the S-curve takes slightly longer because of the jerk limit
+    // Args: distance - path length [mm]
+    //       cruise_speed - speed limit [mm/s]
+    //       start_speed, end_speed - boundary speeds [mm/s]
+    // Return: float - time [s]
+    float minimum_time(float distance, float cruise_speed, float start_speed, float end_speed);
+
+    // Purpose: Get the planned cruise speed
+    // Args: None
+    // Return: float - [mm/s]
+    float get_cruise_speed();
+
+  private:
+    ProfileType type;       // Profile shape
+    float max_accel;        // [mm/s^2]
+    float max_jerk;         // [mm/s^3]
+    float distance;         // Planned path length [mm]
+    float cruise_speed;     // [mm/s]
+    float end_speed;        // [mm/s]
+    float speed;            // Current commanded speed [mm/s]
+    float accel;            // Current commanded acceleration [mm/s^2]
+};
+
+#endif
@@ -1,10 +1,9 @@
 #include "navigator.h"
 
 #include <Arduino.h>
+#include <math.h>
 #include <stdio.h>
 
-#include <Pololu3piPlus32U4IMU.h>
-
 #include "../utils/logger.h"
 
 #undef CLASS_NAME
@@ -15,32 +14,65 @@ Navigator::Navigator()
   : odometry() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Initialized");
 
-  //Encoders::init();
-  encoder = Encoders();
-  encoder.init();
-
   totalLeftCounts = 0;
   totalRightCounts = 0;
+  EncoderService::snapshot(lastSample);
 
   x=0.0f;
   y=0.0f;
   theta=0.0f;
 }
 
+void Navigator::configure() {
+  EncoderService::begin();
+
+  OdometryCalibration calibration;
+  if (calibration.load()) {
+    setGeometry(calibration.get_geometry());
+    calibration.log_calibration();
+  }
+
+  if (!headingEstimator.is_ready() && !headingEstimator.begin()) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "IMU unavailable, heading from encoders only");
+  }
+}
+
 void Navigator::update() {
-  Logger::log_info(CLASS_NAME, __FUNCTION__, "Updating position");
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, "Updating position");
 
-  int16_t encoderLeft =  encoder.getCountsAndResetLeft();
-  int16_t encoderRight = encoder.getCountsAndResetRight();
+  // The service keeps 32-bit totals; DifferentialDrive's velocity loop reads the raw counters.
+  EncoderSnapshot sample;
+  EncoderService::snapshot(sample);
+  if (sample.sequence == lastSample.sequence) {
+    return;
+  }
+  int32_t encoderLeft = sample.left - lastSample.left;
+  int32_t encoderRight = sample.right - lastSample.right;
+  lastSample = sample;
 
   totalLeftCounts += encoderLeft;
   totalRightCounts += encoderRight;
 
-  odometry.update_odom(totalLeftCounts,
-                       totalRightCounts,
-                       x,
-                       y,
-                       theta);
+  // Runs in every mode so the gyro bias keeps being learned.
+  headingEstimator.update(encoderLeft, encoderRight);
+
+  if (headingSource == HeadingSource::IMU_FUSED) {
+    odometry.update_odom_heading(totalLeftCounts,
+                                 totalRightCounts,
+                                 headingEstimator.get_heading(),
+                                 x,
+                                 y,
+                                 theta);
+  } else {
+    odometry.update_odom(totalLeftCounts,
+                         totalRightCounts,
+                         x,
+                         y,
+                         theta);
+  }
+
+  // Stamped with the sample time, not now: that is when the robot was there.
+  poseHistory.add(lastSample.stamp_us, x, y, theta);
   
 }
 
@@ -48,9 +80,102 @@ float Navigator::getX() const { return x; }
 float Navigator::getY() const { return y; }
 float Navigator::getTheta() const { return theta; }
 
-int Navigator::getTotalLeftEncoderCount() const {
+int32_t Navigator::getTotalLeftEncoderCount() const {
   return totalLeftCounts;
 }
-int Navigator::getTotalRightEncoderCount() const {
+int32_t Navigator::getTotalRightEncoderCount() const {
   return totalRightCounts;
 }
+unsigned long Navigator::getLastSampleUs() const {
+  return lastSample.stamp_us;
+}
+
+float Navigator::getLeftVelocity() const {
+  const float cm_per_count = 3.14159265f * odometry.get_geometry().diameter_left_cm / (N_L * GEAR_RATIO);
+  return lastSample.left_velocity * (cm_per_count / (1 << VELOCITY_FRACTION_BITS));
+}
+
+float Navigator::getRightVelocity() const {
+  const float cm_per_count = 3.14159265f * odometry.get_geometry().diameter_right_cm / (N_R * GEAR_RATIO);
+  return lastSample.right_velocity * (cm_per_count / (1 << VELOCITY_FRACTION_BITS));
+}
+
+PoseLookup Navigator::getPoseAt(unsigned long t_us, PoseStamp& pose) const {
+  return poseHistory.lookup(t_us, pose);
+}
+
+
+void Navigator::setOdometryMode(OdometryMode mode) {
+  odometry.set_mode(mode, x, y, theta);
+}
+
+OdometryMode Navigator::getOdometryMode() const {
+  return odometry.get_mode();
+}
+
+void Navigator::setOdometryIntegration(OdometryIntegration integration) {
+  odometry.set_integration(integration);
+}
+
+OdometryIntegration Navigator::getOdometryIntegration() const {
+  return odometry.get_integration();
+}
+
+bool Navigator::setGeometry(const OdometryGeometry& geometry) {
+  if (!odometry.set_geometry(geometry)) {
+    return false;
+  }
+  headingEstimator.set_geometry(geometry);
+  return true;
+}
+
+const OdometryGeometry& Navigator::getGeometry() const {
+  return odometry.get_geometry();
+}
+
+bool Navigator::setHeadingSource(HeadingSource source) {
+  if (source == HeadingSource::IMU_FUSED) {
+    if (!headingEstimator.is_ready() && !headingEstimator.begin()) {
+      Logger::log_error(CLASS_NAME, __FUNCTION__, "IMU unavailable, keeping encoder heading");
+      return false;
+    }
+    if (!headingEstimator.is_bias_valid()) {
+      Logger::log_warning(CLASS_NAME, __FUNCTION__, "Gyro bias not learned yet, encoders only until the robot stands still");
+    }
+    headingEstimator.reset(theta);
+  }
+
+  // Reseed the odometry kernel so it continues from the current pose.
+  odometry.set_mode(odometry.get_mode(), x, y, theta);
+  headingSource = source;
+  return true;
+}
+
+HeadingSource Navigator::getHeadingSource() const {
+  return headingSource;
+}
+
+const HeadingEstimator& Navigator::getHeadingEstimator() const {
+  return headingEstimator;
+}
+
+void Navigator::setCovarianceEnabled(bool enabled) {
+  odometry.set_covariance_enabled(enabled);
+}
+
+const PoseCovariance& Navigator::getCovariance() const {
+  return odometry.get_covariance();
+}
+
+float Navigator::getPositionStdDev() const {
+  const PoseCovariance& p = odometry.get_covariance();
+  return sqrtf(p.xx + p.yy);
+}
+
+float Navigator::getHeadingStdDev() const {
+  return sqrtf(odometry.get_covariance().thetatheta);
+}
+
+void Navigator::resetCovariance() {
+  odometry.reset_covariance();
+}
@@ -3,32 +3,95 @@
 
 #include <Pololu3piPlus32U4.h>
 #include <stdint.h>
+#include "../configurable.h"
+#include "../odometer/heading_estimator.h"
 #include "../odometer/odometry.h"
+#include "../odometer/odometry_calibration.h"
+#include "../sensors/encoder_service.h"
+#include "pose_history.h"
 
 using namespace Pololu3piPlus32U4;
 
-class Navigator{
+// Where the pose heading comes from
+//   ENCODERS:  wheel differential only (dead reckoning)
+//   IMU_FUSED: gyro + encoders through HeadingEstimator
+enum class HeadingSource {
+  ENCODERS,
+  IMU_FUSED
+};
+constexpr HeadingSource DEFAULT_HEADING_SOURCE = HeadingSource::ENCODERS;
+
+class Navigator : public Configurable {
 public:
   Navigator();
 
+  // Start the IMU and the encoder service and load the odometry calibration
+  // (call from setup(), not at static initialisation); the gyro bias is then
+  // learned in the background whenever the wheels stand still.
+  void configure() override;
+
+  // Integrate the encoder counts sampled since the last call; does nothing
+  // if EncoderService has no new sample yet.
   void update();
 
   float getX() const;
   float getY() const;
   float getTheta() const;
-  int getTotalLeftEncoderCount() const;
-  int getTotalRightEncoderCount() const;
+  int32_t getTotalLeftEncoderCount() const;
+  int32_t getTotalRightEncoderCount() const;
+  // micros() at which the counts of the last update() were sampled
+  unsigned long getLastSampleUs() const;
+  // Wheel speeds of the last update() [cm/s], hybrid count/period estimate
+  // (see WheelVelocity); zero once a wheel has stood still for a while
+  float getLeftVelocity() const;
+  float getRightVelocity() const;
+
+  // Pose at a recent time (e.g. halfway through a sonar ping), interpolated
+  // from the poses of the last updates; see PoseHistory for the span covered
+  PoseLookup getPoseAt(unsigned long t_us, PoseStamp& pose) const;
+
+  // Switch between the float and fixed-point odometry kernels, keeping the current pose
+  void setOdometryMode(OdometryMode mode);
+  OdometryMode getOdometryMode() const;
+
+  // Select the odometry integration scheme (EULER, MIDPOINT, EXACT_ARC)
+  void setOdometryIntegration(OdometryIntegration integration);
+  OdometryIntegration getOdometryIntegration() const;
+
+  // Wheel diameters and wheelbase for the odometry and the encoder heading;
+  // nominal until configure() loads a calibration or setGeometry() replaces it
+  bool setGeometry(const OdometryGeometry& geometry);
+  const OdometryGeometry& getGeometry() const;
+
+  // Select the heading source; IMU_FUSED starts the IMU if configure() did not.
+  // Returns false, keeping the current source, if the IMU does not respond.
+  bool setHeadingSource(HeadingSource source);
+  HeadingSource getHeadingSource() const;
+  const HeadingEstimator& getHeadingEstimator() const;
+
+  // Pose uncertainty from the odometry error model; grows with distance driven.
+  // Off by default (float math on every update); enable it before driving.
+  // Call resetCovariance() after correcting the pose from an external reference.
+  void setCovarianceEnabled(bool enabled);
+  const PoseCovariance& getCovariance() const;
+  float getPositionStdDev() const;   // sqrt(var x + var y) [cm]
+  float getHeadingStdDev() const;    // [rad]
+  void resetCovariance();
 
 private:
   Odometry odometry;
-  Encoders encoder;
+  HeadingEstimator headingEstimator;
+  HeadingSource headingSource = DEFAULT_HEADING_SOURCE;
 
   float x = 0.0f;
   float y = 0.0f;
   float theta = 0.0f;
 
-  int totalLeftCounts = 0;
-  int totalRightCounts = 0;
+  int32_t totalLeftCounts = 0;
+  int32_t totalRightCounts = 0;
+
+  EncoderSnapshot lastSample;
+  PoseHistory poseHistory;
 };
 
 #endif
@@ -6,6 +6,8 @@
 #include <stdint.h>
 
 #include "../robot.h"
+#include "../sensors/encoder_service.h"
+#include "../utils/control_timer.h"
 #include "../utils/logger.h"
 
 #undef CLASS_NAME
@@ -32,8 +34,8 @@ static void print_odom_serial(float x, float y, float theta) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, msg);
 }
 
-static void print_encoder_serial(int64_t left, int64_t right) {
-  // AVR printf does not reliably support %lld; downcast to long for logging.
+static void print_encoder_serial(int32_t left, int32_t right) {
+  // int32_t is long on AVR; the cast keeps %ld correct on other targets.
   constexpr size_t buf_sz = 64;
   char msg[buf_sz];
   snprintf(msg, buf_sz, "encoders: left=%ld, right=%ld", (long)left, (long)right);
@@ -42,8 +44,8 @@ static void print_encoder_serial(int64_t left, int64_t right) {
 
 void print_nav_odom_and_encoders() {
 
-  int64_t leftEnc = robot.navigator->getTotalLeftEncoderCount();
-  int64_t rightEnc = robot.navigator->getTotalRightEncoderCount();
+  int32_t leftEnc = robot.navigator->getTotalLeftEncoderCount();
+  int32_t rightEnc = robot.navigator->getTotalRightEncoderCount();
   
   float x = robot.navigator->getX();
   float y = robot.navigator->getY();
@@ -59,8 +61,8 @@ void print_nav_odom_and_encoders() {
 
 void print_nav_encoders() {
 
-  int64_t leftEnc = robot.navigator->getTotalLeftEncoderCount();
-  int64_t rightEnc = robot.navigator->getTotalRightEncoderCount();
+  int32_t leftEnc = robot.navigator->getTotalLeftEncoderCount();
+  int32_t rightEnc = robot.navigator->getTotalRightEncoderCount();
 
   print_encoder_serial(leftEnc, rightEnc);
 
@@ -68,11 +70,27 @@ void print_nav_encoders() {
 
 }
 
-void drive_forward_with_updates(float distance_m, float speed_m_per_s, bool encoder_only = false) {
-  Logger::log_info(CLASS_NAME, __FUNCTION__, "moving forward");
+static void print_motion_tick_stats(unsigned long nav_updates) {
+  const MotionTickStats& stats = robot.drive->get_tick_stats();
+
+  unsigned long avg_us = stats.ticks > 0 ? stats.total_us / stats.ticks : 0;
+  unsigned long busy_pct = stats.motion_us > 0 ? (stats.total_us * 100UL) / stats.motion_us : 0;
+
+  constexpr size_t buf_sz = 128;
+  char msg[buf_sz];
+  snprintf(msg, buf_sz, "motion: ticks=%lu, avg=%lu us, max=%lu us, engine cpu=%lu%%, nav updates=%lu",
+           stats.ticks, avg_us, stats.max_us, busy_pct, nav_updates);
+  Logger::log_info(CLASS_NAME, __FUNCTION__, msg);
+}
 
-  robot.drive->move_forward(distance_m, speed_m_per_s);
+// Service the motion started by the caller, updating odometry on every tick.
+static void run_motion_with_updates(bool encoder_only) {
+  unsigned long nav_updates = 0;
 
+  while (robot.drive->poll()) {
+    robot.navigator->update();
+    nav_updates++;
+  }
   robot.navigator->update();
 
   if (!encoder_only) {
@@ -81,20 +99,30 @@ void drive_forward_with_updates(float distance_m, float speed_m_per_s, bool enco
     print_nav_encoders();
   }
 
+  print_motion_tick_stats(nav_updates);
+
+  String progress = "encoder progress=" + String(robot.drive->get_motion_progress_mm()) + " mm";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, progress.c_str());
+}
+
+void drive_forward_with_updates(float distance_m, float speed_m_per_s, bool encoder_only = false) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "moving forward");
+
+  robot.drive->reset_tick_stats();
+  if (robot.drive->start_move_forward(distance_m, speed_m_per_s)) {
+    run_motion_with_updates(encoder_only);
+    delay(POST_MOVE_SETTLE_MS);
+  }
+
   robot.drive->halt();
 }
 
 void drive_backward_with_updates(float distance_m, float speed_m_per_s, bool encoder_only = false) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "moving backward");
-  
-  robot.drive->move_backward(distance_m, speed_m_per_s);
 
-  robot.navigator->update();
-
-  if (!encoder_only) {
-    print_nav_odom_and_encoders();
-  } else {
-    print_nav_encoders();
+  robot.drive->reset_tick_stats();
+  if (robot.drive->start_move_backward(distance_m, speed_m_per_s)) {
+    run_motion_with_updates(encoder_only);
   }
 
   robot.drive->halt();
@@ -102,15 +130,10 @@ void drive_backward_with_updates(float distance_m, float speed_m_per_s, bool enc
 
 void turn_right_with_updates(float theta_rad, float speed_m_per_s, bool encoder_only = false) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "rotating right");
-  
-  robot.drive->turn_right(theta_rad, speed_m_per_s, TurnMode::ANGLE);
-
-  robot.navigator->update();
 
-  if (!encoder_only) {
-    print_nav_odom_and_encoders();
-  } else {
-    print_nav_encoders();
+  robot.drive->reset_tick_stats();
+  if (robot.drive->start_turn_right(theta_rad, speed_m_per_s, TurnMode::ANGLE)) {
+    run_motion_with_updates(encoder_only);
   }
 
   robot.drive->halt();
@@ -118,27 +141,121 @@ void turn_right_with_updates(float theta_rad, float speed_m_per_s, bool encoder_
 
 void turn_left_with_updates(float theta_rad, float speed_m_per_s, bool encoder_only = false) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "rotating left");
-  
-  robot.drive->turn_left(theta_rad, speed_m_per_s, TurnMode::ANGLE);
 
-  robot.navigator->update();
+  robot.drive->reset_tick_stats();
+  if (robot.drive->start_turn_left(theta_rad, speed_m_per_s, TurnMode::ANGLE)) {
+    run_motion_with_updates(encoder_only);
+  }
 
-  if (!encoder_only) {
-    print_nav_odom_and_encoders();
-  } else {
-    print_nav_encoders();
+  robot.drive->halt();
+}
+
+// Run a square as one queued course and compare the lap time to the minimum.
+static void drive_square_queued(float turn_sign, float speed_m_per_s, float side_m = 1.0f) {
+  robot.drive->clear_queue();
+  for (int i = 0; i < 4; ++i) {
+    robot.drive->queue_line(side_m, speed_m_per_s);
+    robot.drive->queue_turn(turn_sign * degrees_to_radians(90.0f), speed_m_per_s);
   }
 
+  float minimum_s = robot.drive->estimate_queue_time_s();
+
+  robot.drive->reset_tick_stats();
+  unsigned long start_ms = millis();
+  if (robot.drive->start_queue()) {
+    run_motion_with_updates(false);
+  }
+  unsigned long lap_ms = millis() - start_ms;
+
+  String lap = "lap time=" + String(lap_ms / 1000.0f) + " s, minimum=" + String(minimum_s) + " s";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, lap.c_str());
+
   robot.drive->halt();
 }
 
+// Odometry on the fixed-rate tick: the pose is sampled every period whatever loop() is doing.
+static void update_navigator_on_tick() {
+  robot.navigator->update();
+}
+
+// Encoder trace for the odometry benchmark: 10 ms steps of a robot driving lines,
+// arcs and spins at up to 0.2 m/s, with +-1 count of quantisation noise. The totals
+// pass 65,000 counts, so they are 32-bit like EncoderService's.
+static const uint16_t ODOM_BENCHMARK_STEPS = 4000;
+
+static void odom_benchmark_trace(uint16_t step, int32_t &left, int32_t &right, uint16_t &seed) {
+  static const int8_t pattern[4][2] = {{18, 18}, {12, 24}, {-9, 9}, {24, 15}};
+  const int8_t *delta = pattern[(step / 250) % 4];
+
+  seed = seed * 25173 + 13849;
+  int noise = (int)(seed >> 14) % 3 - 1;  // -1, 0 or +1 count
+  left += delta[0] + noise;
+  right += delta[1] - noise;
+}
+
+// Replay the trace through one kernel and return the elapsed time [us].
+static unsigned long run_odom_benchmark(Odometry *odometry, float &x, float &y, float &theta) {
+  int32_t left = 0;
+  int32_t right = 0;
+  uint16_t seed = 1;
+  unsigned long start_us = micros();
+  for (uint16_t step = 0; step < ODOM_BENCHMARK_STEPS; step++) {
+    odom_benchmark_trace(step, left, right, seed);
+    if (odometry != nullptr) {
+      odometry->update_odom(left, right, x, y, theta);
+    }
+  }
+  return micros() - start_us;
+}
+
+// Longest wait for the gyro bias before the IMU heading test drives anyway
+static const unsigned long HEADING_BIAS_WAIT_MS = 2000;
+
+// UMBmark: time to put the robot back on the start mark, and to type a measurement
+static const unsigned long UMBMARK_REPOSITION_MS = 10000;
+static const unsigned long UMBMARK_ENTRY_TIMEOUT_MS = 120000;
+
+// Read "x y" [cm] from the serial monitor; false if nothing arrives in time.
+static bool read_serial_position(float &x, float &y) {
+  while (Serial.available()) {
+    Serial.read();
+  }
+  unsigned long start_ms = millis();
+  while (!Serial.available()) {
+    if (millis() - start_ms > UMBMARK_ENTRY_TIMEOUT_MS) {
+      return false;
+    }
+  }
+  x = Serial.parseFloat();
+  y = Serial.parseFloat();
+  return true;
+}
+
+// Drive one UMBmark square; returns the odometry end position in the start frame [cm].
+static void run_umbmark_square(UmbmarkDirection direction, float side_m, float &odom_x, float &odom_y) {
+  robot.navigator->update();
+  float start_x = robot.navigator->getX();
+  float start_y = robot.navigator->getY();
+  float start_theta = robot.navigator->getTheta();
+
+  drive_square_queued(direction == UmbmarkDirection::CLOCKWISE ? -1.0f : 1.0f, 0.2f, side_m);
+  delay(POST_MOVE_SETTLE_MS);
+  robot.navigator->update();
+
+  float dx = robot.navigator->getX() - start_x;
+  float dy = robot.navigator->getY() - start_y;
+  float c = cosf(start_theta);
+  float s = sinf(start_theta);
+  odom_x = c * dx + s * dy;
+  odom_y = -s * dx + c * dy;
+}
 
 // ========== TEST TASKS ==========
 void test_2_1_test_encoders_still() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 2.1: encoders while still");
 
-  int left = (int)robot.navigator->getTotalLeftEncoderCount();
-  int right = (int)robot.navigator->getTotalRightEncoderCount();
+  int32_t left = robot.navigator->getTotalLeftEncoderCount();
+  int32_t right = robot.navigator->getTotalRightEncoderCount();
 
   print_encoder_serial(left, right);
   robot.display->print_encoder(left, right);
@@ -188,3 +305,607 @@ void test_3_2e_square_counter_clockwise() {
     turn_left_with_updates(rad, 0.2f, false);
   }
 }
+
+void test_3_2b_square_clockwise_queued() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 3.2b: square clockwise (queued)");
+
+  drive_square_queued(-1.0f, 0.2f);
+}
+
+void test_3_2e_square_counter_clockwise_queued() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 3.2e: square counterclockwise (queued)");
+
+  drive_square_queued(1.0f, 0.2f);
+}
+
+void test_4_1_pure_pursuit_square() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.1: 1 m square, pure pursuit");
+
+  // Square counterclockwise from the current pose, ending where it started.
+  float x0 = robot.navigator->getX();
+  float y0 = robot.navigator->getY();
+  robot.follower->clear_path();
+  robot.follower->add_waypoint(x0 + 100.0f, y0);
+  robot.follower->add_waypoint(x0 + 100.0f, y0 + 100.0f);
+  robot.follower->add_waypoint(x0, y0 + 100.0f);
+  robot.follower->add_waypoint(x0, y0);
+
+  unsigned long start_ms = millis();
+  if (robot.follower->start()) {
+    while (robot.follower->update()) {
+    }
+  }
+  unsigned long lap_ms = millis() - start_ms;
+
+  print_nav_odom_and_encoders();
+
+  float dx = robot.navigator->getX() - x0;
+  float dy = robot.navigator->getY() - y0;
+  String result = "lap time=" + String(lap_ms / 1000.0f) + " s, end error=" + String(sqrtf(dx * dx + dy * dy)) +
+                  " cm, max cross-track=" + String(robot.follower->get_max_cross_track_error_cm()) + " cm";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, result.c_str());
+}
+
+void test_4_2_control_tick_jitter() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.2: 1 m forward, odometry on the 200 Hz control tick");
+
+  ControlTimer::add_callback(update_navigator_on_tick);
+  if (!ControlTimer::begin(DEFAULT_CONTROL_TICK_HZ)) {
+    ControlTimer::remove_callback(update_navigator_on_tick);
+    return;
+  }
+
+  // loop() keeps logging while the tick runs, so the jitter reflects real load.
+  robot.drive->reset_tick_stats();
+  if (robot.drive->start_move_forward(1.0f, 0.2f)) {
+    unsigned long last_log_ms = millis();
+    while (robot.drive->poll()) {
+      if (millis() - last_log_ms >= 250) {
+        last_log_ms = millis();
+        Logger::log_info(CLASS_NAME, __FUNCTION__, "driving");
+      }
+    }
+  }
+  robot.drive->halt();
+  delay(100);
+
+  ControlTimer::stop();
+  ControlTimer::remove_callback(update_navigator_on_tick);
+
+  print_nav_odom_and_encoders();
+  print_motion_tick_stats(0);
+  ControlTimer::print_stats();
+}
+
+void test_4_3a_odometry_kernel_benchmark() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.3a: float vs fixed-point odometry kernel");
+
+  Odometry reference;
+  Odometry fixed;
+  fixed.set_mode(OdometryMode::FIXED, 0.0f, 0.0f, 0.0f);
+
+  // Timing: the trace generator alone is the baseline subtracted from each kernel.
+  float x = 0.0f, y = 0.0f, theta = 0.0f;
+  unsigned long baseline_us = run_odom_benchmark(nullptr, x, y, theta);
+  float float_x = 0.0f, float_y = 0.0f, float_theta = 0.0f;
+  unsigned long float_us = run_odom_benchmark(&reference, float_x, float_y, float_theta) - baseline_us;
+  float fixed_x = 0.0f, fixed_y = 0.0f, fixed_theta = 0.0f;
+  unsigned long fixed_us = run_odom_benchmark(&fixed, fixed_x, fixed_y, fixed_theta) - baseline_us;
+
+  // The same kernels with the covariance propagated on every update.
+  Odometry covariance_reference;
+  Odometry covariance_fixed;
+  covariance_reference.set_covariance_enabled(true);
+  covariance_fixed.set_covariance_enabled(true);
+  covariance_fixed.set_mode(OdometryMode::FIXED, 0.0f, 0.0f, 0.0f);
+  x = y = theta = 0.0f;
+  unsigned long float_covariance_us = run_odom_benchmark(&covariance_reference, x, y, theta) - baseline_us;
+  x = y = theta = 0.0f;
+  unsigned long fixed_covariance_us = run_odom_benchmark(&covariance_fixed, x, y, theta) - baseline_us;
+
+  // Drift: both kernels in lockstep from a fresh start.
+  Odometry lockstep_reference;
+  Odometry lockstep_fixed;
+  lockstep_fixed.set_mode(OdometryMode::FIXED, 0.0f, 0.0f, 0.0f);
+  float rx = 0.0f, ry = 0.0f, rtheta = 0.0f;
+  float qx = 0.0f, qy = 0.0f, qtheta = 0.0f;
+  float max_error_cm = 0.0f;
+  int32_t left = 0;
+  int32_t right = 0;
+  uint16_t seed = 1;
+  for (uint16_t step = 0; step < ODOM_BENCHMARK_STEPS; step++) {
+    odom_benchmark_trace(step, left, right, seed);
+    lockstep_reference.update_odom(left, right, rx, ry, rtheta);
+    lockstep_fixed.update_odom(left, right, qx, qy, qtheta);
+    float error = sqrtf((qx - rx) * (qx - rx) + (qy - ry) * (qy - ry));
+    if (error > max_error_cm) {
+      max_error_cm = error;
+    }
+  }
+
+  unsigned long cycles_per_us = F_CPU / 1000000UL;
+  String timing = "per update: float=" + String(float_us * cycles_per_us / ODOM_BENCHMARK_STEPS) + " cycles, fixed=" +
+                  String(fixed_us * cycles_per_us / ODOM_BENCHMARK_STEPS) + " cycles (" + String(ODOM_BENCHMARK_STEPS) + " updates)";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, timing.c_str());
+  String covariance = "with covariance: float=" + String(float_covariance_us * cycles_per_us / ODOM_BENCHMARK_STEPS) +
+                      " cycles, fixed=" + String(fixed_covariance_us * cycles_per_us / ODOM_BENCHMARK_STEPS) + " cycles";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, covariance.c_str());
+
+  print_odom_serial(rx, ry, rtheta);
+  print_odom_serial(qx, qy, qtheta);
+  String drift = "fixed vs float: max position error=" + String(max_error_cm, 4) + " cm, heading error=" +
+                 String(radians_to_degrees(qtheta - rtheta), 4) + " deg";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, drift.c_str());
+
+  // One update per motion: a whole spin in a single step must end on the same heading.
+  static const float spins_deg[] = {180.0f, 360.0f};
+  const OdometryGeometry& geometry = NOMINAL_ODOMETRY_GEOMETRY;
+  float counts_per_rad = 0.5f * geometry.wheelbase_cm * N_R * GEAR_RATIO / (3.14159265f * geometry.diameter_right_cm);
+  for (uint8_t i = 0; i < sizeof(spins_deg) / sizeof(spins_deg[0]); i++) {
+    Odometry spin_reference;
+    Odometry spin_fixed;
+    spin_fixed.set_mode(OdometryMode::FIXED, 0.0f, 0.0f, 0.0f);
+    int32_t counts = (int32_t)(degrees_to_radians(spins_deg[i]) * counts_per_rad + 0.5f);
+    float sx = 0.0f, sy = 0.0f, stheta = 0.0f;
+    float fx = 0.0f, fy = 0.0f, ftheta = 0.0f;
+    spin_reference.update_odom(-counts, counts, sx, sy, stheta);
+    spin_fixed.update_odom(-counts, counts, fx, fy, ftheta);
+
+    float heading_error_deg = radians_to_degrees(ftheta - stheta);
+    String spin = String(spins_deg[i], 0) + " deg spin in one update: heading float=" +
+                  String(radians_to_degrees(stheta), 2) + " deg, fixed=" + String(radians_to_degrees(ftheta), 2) +
+                  " deg, position error=" + String(sqrtf((fx - sx) * (fx - sx) + (fy - sy) * (fy - sy)), 4) + " cm";
+    if (fabs(heading_error_deg) > 0.1f) {
+      Logger::log_error(CLASS_NAME, __FUNCTION__, spin.c_str());
+    } else {
+      Logger::log_info(CLASS_NAME, __FUNCTION__, spin.c_str());
+    }
+  }
+}
+
+void test_4_3b_odometry_kernel_drift_square() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.3b: fixed-point odometry on a queued 1 m square");
+
+  // Shadow kernel fed the same encoder totals as the Navigator, starting from its pose.
+  robot.navigator->update();
+  Odometry shadow;
+  shadow.set_mode(OdometryMode::FIXED, robot.navigator->getX(), robot.navigator->getY(), robot.navigator->getTheta());
+  float qx = 0.0f, qy = 0.0f, qtheta = 0.0f;
+  shadow.update_odom(robot.navigator->getTotalLeftEncoderCount(), robot.navigator->getTotalRightEncoderCount(), qx, qy, qtheta);
+
+  robot.drive->clear_queue();
+  for (int i = 0; i < 4; ++i) {
+    robot.drive->queue_line(1.0f, 0.2f);
+    robot.drive->queue_turn(degrees_to_radians(90.0f), 0.2f);
+  }
+
+  float max_error_cm = 0.0f;
+  if (robot.drive->start_queue()) {
+    while (robot.drive->poll()) {
+      robot.navigator->update();
+      shadow.update_odom(robot.navigator->getTotalLeftEncoderCount(), robot.navigator->getTotalRightEncoderCount(), qx, qy, qtheta);
+      float dx = qx - robot.navigator->getX();
+      float dy = qy - robot.navigator->getY();
+      float error = sqrtf(dx * dx + dy * dy);
+      if (error > max_error_cm) {
+        max_error_cm = error;
+      }
+    }
+  }
+  robot.drive->halt();
+
+  print_nav_odom_and_encoders();
+  print_odom_serial(qx, qy, qtheta);
+  String drift = "fixed vs float: max position error=" + String(max_error_cm, 4) + " cm, heading error=" +
+                 String(radians_to_degrees(qtheta - robot.navigator->getTheta()), 4) + " deg";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, drift.c_str());
+}
+
+void test_4_4_imu_heading_square() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.4: queued 1 m square, IMU-fused heading");
+
+  if (!robot.navigator->setHeadingSource(HeadingSource::IMU_FUSED)) {
+    return;
+  }
+
+  // The bias is learned in the background; standing still briefly is enough.
+  unsigned long start_ms = millis();
+  while (!robot.navigator->getHeadingEstimator().is_bias_valid() && millis() - start_ms < HEADING_BIAS_WAIT_MS) {
+    robot.navigator->update();
+  }
+  String bias = "gyro bias=" + String(robot.navigator->getHeadingEstimator().get_gyro_bias_dps(), 3) + " deg/s after " +
+                String(millis() - start_ms) + " ms";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, bias.c_str());
+
+  drive_square_queued(1.0f, 0.2f);
+
+  // After a full lap both should read 360 deg; the difference is what the gyro corrected.
+  const HeadingEstimator& heading = robot.navigator->getHeadingEstimator();
+  String result = "heading: fused=" + String(radians_to_degrees(heading.get_heading())) + " deg, encoders=" +
+                  String(radians_to_degrees(heading.get_encoder_heading())) + " deg";
+  Logger::log_info(CLASS_NAME, __FUNCTION__, result.c_str());
+}
+
+void test_4_5_pose_covariance_square() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.5: pose uncertainty after each side of a square");
+
+  robot.navigator->update();
+  robot.navigator->setCovarianceEnabled(true);
+  robot.navigator->resetCovariance();
+
+  for (int i = 0; i < 4; ++i) {
+    drive_forward_with_updates(1.0f, 0.2f, false);
+    turn_left_with_updates(degrees_to_radians(90.0f), 0.2f, false);
+
+    const PoseCovariance& p = robot.navigator->getCovariance();
+    String sigma = "side " + String(i + 1) + ": sigma pos=" + String(robot.navigator->getPositionStdDev()) + " cm (x=" +
+                   String(sqrtf(p.xx)) + ", y=" + String(sqrtf(p.yy)) + "), heading=" +
+                   String(radians_to_degrees(robot.navigator->getHeadingStdDev())) + " deg";
+    Logger::log_info(CLASS_NAME, __FUNCTION__, sigma.c_str());
+  }
+  robot.navigator->setCovarianceEnabled(false);
+}
+
+void test_4_6_encoder_service_sampling() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.6: 1 m forward, encoders sampled on the control tick");
+
+  if (!ControlTimer::begin(DEFAULT_CONTROL_TICK_HZ)) {
+    return;
+  }
+
+  // Watch the sample stamps from loop(): the spacing should stay at the tick period.
+  EncoderSnapshot previous;
+  EncoderService::snapshot(previous);
+  unsigned long min_spacing_us = 0xFFFFFFFFUL;
+  unsigned long max_spacing_us = 0;
+  unsigned long samples = 0;
+  unsigned long missed = 0;
+
+  if (robot.drive->start_move_forward(1.0f, 0.2f)) {
+    while (robot.drive->poll()) {
+      robot.navigator->update();
+
+      EncoderSnapshot sample;
+      EncoderService::snapshot(sample);
+      if (sample.sequence == previous.sequence) {
+        continue;
+      }
+      unsigned long spacing_us = (sample.stamp_us - previous.stamp_us) / (sample.sequence - previous.sequence);
+      missed += sample.sequence - previous.sequence - 1;
+      if (spacing_us < min_spacing_us) {
+        min_spacing_us = spacing_us;
+      }
+      if (spacing_us > max_spacing_us) {
+        max_spacing_us = spacing_us;
+      }
+      samples++;
+      previous = sample;
+    }
+  }
+  robot.drive->halt();
+  delay(100);
+  robot.navigator->update();
+
+  ControlTimer::stop();
+
+  print_nav_odom_and_encoders();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("samples=" + String(samples) + ", spacing min=" + String(min_spacing_us) +
+                                              " us, max=" + String(max_spacing_us) + " us, skipped=" +
+                                              String(missed)).c_str());
+}
+
+void test_4_7_umbmark_calibration() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.7: UMBmark odometry calibration");
+
+  OdometryCalibration calibration;
+  const UmbmarkDirection directions[2] = {UmbmarkDirection::CLOCKWISE, UmbmarkDirection::COUNTER_CLOCKWISE};
+
+  for (uint8_t run = 0; run < UMBMARK_RUNS; run++) {
+    for (uint8_t i = 0; i < 2; i++) {
+      bool clockwise = directions[i] == UmbmarkDirection::CLOCKWISE;
+      Logger::log_info(CLASS_NAME, __FUNCTION__, ("Run " + String(run + 1) + (clockwise ? " CW" : " CCW") +
+                                                  ": place the robot on the start mark").c_str());
+      delay(UMBMARK_REPOSITION_MS);
+
+      float odom_x, odom_y;
+      run_umbmark_square(directions[i], UMBMARK_SIDE_M, odom_x, odom_y);
+      Logger::log_info(CLASS_NAME, __FUNCTION__, ("odometry end x=" + String(odom_x) + ", y=" + String(odom_y) +
+                                                  " cm; send measured 'x y' cm").c_str());
+
+      float measured_x, measured_y;
+      if (!read_serial_position(measured_x, measured_y)) {
+        Logger::log_error(CLASS_NAME, __FUNCTION__, "No measurement entered, calibration aborted");
+        return;
+      }
+      calibration.add_run(directions[i], measured_x - odom_x, measured_y - odom_y);
+    }
+  }
+
+  if (!calibration.solve(robot.navigator->getGeometry(), UMBMARK_SIDE_M * 100.0f)) {
+    return;
+  }
+  calibration.log_calibration();
+  calibration.save();
+  robot.navigator->setGeometry(calibration.get_geometry());
+}
+
+void test_4_8_pose_history_sonar() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.8: drive at a wall, place each echo with the pose history");
+
+  ControlTimer::add_callback(update_navigator_on_tick);
+  if (!ControlTimer::begin(DEFAULT_CONTROL_TICK_HZ)) {
+    ControlTimer::remove_callback(update_navigator_on_tick);
+    return;
+  }
+
+  // Wall position = robot x + range. It should not move; pairing each range
+  // with the latest pose instead of the pose at the echo smears it out.
+  float history_min = 1.0e6f, history_max = -1.0e6f;
+  float latest_min = 1.0e6f, latest_max = -1.0e6f;
+  uint16_t pings = 0;
+
+  if (robot.drive->start_move_forward(0.5f, 0.3f)) {
+    while (robot.drive->poll()) {
+      unsigned long start_us = micros();
+      float range = robot.sonar->read_distance_cm();
+      unsigned long end_us = micros();
+      if (range <= 0.0f) {
+        continue;
+      }
+
+      PoseStamp pose;
+      if (robot.navigator->getPoseAt(start_us + (end_us - start_us) / 2, pose) != PoseLookup::INTERPOLATED) {
+        continue;
+      }
+      float wall_history = pose.x + range;
+      float wall_latest = robot.navigator->getX() + range;
+      history_min = fmin(history_min, wall_history);
+      history_max = fmax(history_max, wall_history);
+      latest_min = fmin(latest_min, wall_latest);
+      latest_max = fmax(latest_max, wall_latest);
+      pings++;
+    }
+  }
+  robot.drive->halt();
+
+  ControlTimer::stop();
+  ControlTimer::remove_callback(update_navigator_on_tick);
+
+  if (pings == 0) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "No echoes");
+    return;
+  }
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("pings=" + String(pings) + ", wall spread: history=" +
+                                              String(history_max - history_min) + " cm, latest pose=" +
+                                              String(latest_max - latest_min) + " cm").c_str());
+}
+
+// Replay log: one "replay:" line per sample, read by tools/odometry_replay.
+static const unsigned long REPLAY_LOG_PERIOD_US = 10000;
+
+static void log_replay_sample() {
+  EncoderSnapshot sample;
+  EncoderService::snapshot(sample);
+  constexpr size_t buf_sz = 48;
+  char msg[buf_sz];
+  snprintf(msg, buf_sz, "replay: %lu,%ld,%ld,%d", sample.stamp_us, (long)sample.left, (long)sample.right,
+           robot.navigator->getHeadingEstimator().get_gyro_rate_lsb());
+  Logger::log_info(CLASS_NAME, __FUNCTION__, msg);
+}
+
+void test_4_9_record_replay_log() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.9: record a queued square for host replay");
+
+  const OdometryGeometry& geometry = robot.navigator->getGeometry();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("replay: # geometry " + String(geometry.diameter_left_cm, 4) + " " +
+                                              String(geometry.diameter_right_cm, 4) + " " +
+                                              String(geometry.wheelbase_cm, 4)).c_str());
+
+  // Still samples first, so the replayed HeadingEstimator can learn the gyro bias.
+  unsigned long last_log_us = micros();
+  unsigned long still_until_ms = millis() + HEADING_BIAS_WAIT_MS;
+  while ((long)(millis() - still_until_ms) < 0) {
+    robot.navigator->update();
+    if (micros() - last_log_us >= REPLAY_LOG_PERIOD_US) {
+      last_log_us += REPLAY_LOG_PERIOD_US;
+      log_replay_sample();
+    }
+  }
+
+  robot.drive->clear_queue();
+  for (int i = 0; i < 4; ++i) {
+    robot.drive->queue_line(1.0f, 0.2f);
+    robot.drive->queue_turn(degrees_to_radians(90.0f), 0.2f);
+  }
+  if (robot.drive->start_queue()) {
+    while (robot.drive->poll()) {
+      robot.navigator->update();
+      if (micros() - last_log_us >= REPLAY_LOG_PERIOD_US) {
+        last_log_us += REPLAY_LOG_PERIOD_US;
+        log_replay_sample();
+      }
+    }
+  }
+  robot.drive->halt();
+  delay(POST_MOVE_SETTLE_MS);
+  robot.navigator->update();
+  log_replay_sample();
+
+  // Add "replay: # truth x y" by hand after measuring the real end position.
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("replay: # robot " + String(robot.navigator->getX(), 2) + " " +
+                                              String(robot.navigator->getY(), 2) + " " +
+                                              String(robot.navigator->getTheta(), 4)).c_str());
+}
+
+static const float VELOCITY_TEST_SPEEDS_MPS[3] = {0.02f, 0.05f, 0.2f};
+static const float VELOCITY_TEST_DISTANCE_M = 0.2f;
+
+void test_4_10_wheel_velocity_estimator() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.10: hybrid wheel velocity at crawl and cruise speeds");
+
+  if (!ControlTimer::begin(DEFAULT_CONTROL_TICK_HZ)) {
+    return;
+  }
+
+  // Compare against the naive counts-per-tick estimate over the same samples.
+  const float cm_per_count = 3.14159265f * robot.navigator->getGeometry().diameter_left_cm / (N_L * GEAR_RATIO);
+  for (uint8_t i = 0; i < 3; i++) {
+    float speed_cm_s = VELOCITY_TEST_SPEEDS_MPS[i] * 100.0f;
+    float sum = 0.0f;
+    float sum_sq = 0.0f;
+    float naive_sum_sq = 0.0f;
+    unsigned long samples = 0;
+    unsigned long period_samples = 0;
+
+    EncoderSnapshot previous;
+    EncoderService::snapshot(previous);
+    if (robot.drive->start_move_forward(VELOCITY_TEST_DISTANCE_M, VELOCITY_TEST_SPEEDS_MPS[i])) {
+      while (robot.drive->poll()) {
+        robot.navigator->update();
+
+        EncoderSnapshot sample;
+        EncoderService::snapshot(sample);
+        if (sample.sequence == previous.sequence) {
+          continue;
+        }
+        // Skip the ramps: only samples at the commanded speed count.
+        float progress = robot.drive->get_motion_progress_mm() * 0.1f;
+        if (progress > 0.25f * VELOCITY_TEST_DISTANCE_M * 100.0f && progress < 0.75f * VELOCITY_TEST_DISTANCE_M * 100.0f) {
+          float velocity = robot.navigator->getLeftVelocity();
+          float naive = (sample.left - previous.left) * cm_per_count * 1.0e6f / (sample.stamp_us - previous.stamp_us);
+          sum += velocity;
+          sum_sq += (velocity - speed_cm_s) * (velocity - speed_cm_s);
+          naive_sum_sq += (naive - speed_cm_s) * (naive - speed_cm_s);
+          samples++;
+          if (sample.left_method == VelocityMethod::PERIOD) {
+            period_samples++;
+          }
+        }
+        previous = sample;
+      }
+    }
+    robot.drive->halt();
+    delay(POST_MOVE_SETTLE_MS);
+
+    if (samples == 0) {
+      Logger::log_warning(CLASS_NAME, __FUNCTION__, "No samples at speed");
+      continue;
+    }
+    Logger::log_info(CLASS_NAME, __FUNCTION__, ("v=" + String(speed_cm_s, 1) + " cm/s: mean=" + String(sum / samples, 2) +
+                                                ", rms err=" + String(sqrt(sum_sq / samples), 2) + ", naive rms err=" +
+                                                String(sqrt(naive_sum_sq / samples), 2) + ", period " +
+                                                String(100 * period_samples / samples) + " %").c_str());
+  }
+
+  robot.navigator->update();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("stopped: v_l=" + String(robot.navigator->getLeftVelocity(), 2) +
+                                              " cm/s, v_r=" + String(robot.navigator->getRightVelocity(), 2) +
+                                              " cm/s").c_str());
+  ControlTimer::stop();
+}
+
+static const unsigned long ASYNC_PING_PERIOD_MS = 60;   // Let the previous ping's echoes die out
+
+static float async_wall_min = 1.0e6f;
+static float async_wall_max = -1.0e6f;
+static uint16_t async_echoes = 0;
+
+static void place_async_echo(const SonarEcho &echo) {
+  if (echo.distance_cm <= 0.0f) {
+    return;
+  }
+  // The echo pin is high from the burst to the echo; the reflection is halfway.
+  PoseStamp pose;
+  if (robot.navigator->getPoseAt(echo.rise_us + echo.duration_us / 2, pose) == PoseLookup::TOO_OLD) {
+    return;
+  }
+  async_wall_min = fmin(async_wall_min, pose.x + echo.distance_cm);
+  async_wall_max = fmax(async_wall_max, pose.x + echo.distance_cm);
+  async_echoes++;
+}
+
+void test_4_11_async_sonar_while_driving() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.11: asynchronous pings while driving at a wall");
+
+  if (!robot.sonar->is_async()) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "Sonar pin has no interrupt, pings will block the loop");
+  }
+
+  async_wall_min = 1.0e6f;
+  async_wall_max = -1.0e6f;
+  async_echoes = 0;
+  robot.sonar->set_echo_callback(place_async_echo);
+
+  // loop() keeps polling drive and odometry while each ping is in flight;
+  // the longest gap between two passes shows how much a ping blocks.
+  uint16_t pings = 0;
+  unsigned long passes = 0;
+  unsigned long max_gap_us = 0;
+  unsigned long last_ping_ms = millis() - ASYNC_PING_PERIOD_MS;
+
+  if (robot.drive->start_move_forward(0.5f, 0.3f)) {
+    unsigned long last_pass_us = micros();
+    while (robot.drive->poll()) {
+      robot.navigator->update();
+      robot.sonar->poll_ping();
+      if (millis() - last_ping_ms >= ASYNC_PING_PERIOD_MS && robot.sonar->start_ping()) {
+        last_ping_ms = millis();
+        pings++;
+      }
+
+      unsigned long now_us = micros();
+      if (now_us - last_pass_us > max_gap_us) {
+        max_gap_us = now_us - last_pass_us;
+      }
+      last_pass_us = now_us;
+      passes++;
+    }
+  }
+  robot.drive->halt();
+  while (robot.sonar->poll_ping() == SonarPingState::WAITING) {
+  }
+  robot.sonar->set_echo_callback(nullptr);
+
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("pings=" + String(pings) + ", echoes=" + String(async_echoes) +
+                                              ", loop passes=" + String(passes) + ", max gap=" +
+                                              String(max_gap_us) + " us").c_str());
+  if (async_echoes > 0) {
+    Logger::log_info(CLASS_NAME, __FUNCTION__, ("wall spread=" + String(async_wall_max - async_wall_min) +
+                                                " cm").c_str());
+  }
+}
+
+void test_4_12_adaptive_sonar_schedule() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Task 4.12: sonar ping rate, full range vs 50 cm window");
+
+  // Same drive twice: listening for the full 5 m, then only for the next 50 cm
+  // with the interval following the wheel speeds.
+  const float ranges_cm[2] = {MAX_VALID_DISTANCE_CM, DEFAULT_EXPECTED_RANGE_CM};
+  for (uint8_t i = 0; i < 2; i++) {
+    robot.sonar->set_expected_range_cm(ranges_cm[i]);
+    robot.sonar->set_speed_cm_s(0.0f);
+    robot.sonar->reset_ping_stats();
+    Logger::log_info(CLASS_NAME, __FUNCTION__, ("Expected range " + String(ranges_cm[i], 0) + " cm, timeout " +
+                                                String(robot.sonar->get_timeout()) + " us").c_str());
+
+    if (robot.drive->start_move_forward(0.3f, 0.2f)) {
+      while (robot.drive->poll()) {
+        robot.navigator->update();
+        if (i == 1) {
+          float speed = 0.5f * (robot.navigator->getLeftVelocity() + robot.navigator->getRightVelocity());
+          robot.sonar->set_speed_cm_s(speed);
+        }
+        robot.sonar->update();
+      }
+    }
+    robot.drive->halt();
+    robot.sonar->log_ping_stats();
+    delay(POST_MOVE_SETTLE_MS);
+
+    // Drive back to the start for the second run.
+    robot.drive->move_backward(0.3f, 0.2f);
+    delay(POST_MOVE_SETTLE_MS);
+  }
+
+  robot.sonar->set_timeout(DEFAULT_TIMEOUT_US);
+}
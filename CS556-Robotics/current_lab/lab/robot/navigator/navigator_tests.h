@@ -11,6 +11,22 @@ void test_2_2c_turn_left_90();
 void test_3_2a_straight_line_15m();
 void test_3_2b_square_clockwise();
 void test_3_2e_square_counter_clockwise();
+void test_3_2b_square_clockwise_queued();
+void test_3_2e_square_counter_clockwise_queued();
+
+void test_4_1_pure_pursuit_square();
+void test_4_2_control_tick_jitter();
+void test_4_3a_odometry_kernel_benchmark();
+void test_4_3b_odometry_kernel_drift_square();
+void test_4_4_imu_heading_square();
+void test_4_5_pose_covariance_square();
+void test_4_6_encoder_service_sampling();
+void test_4_7_umbmark_calibration();
+void test_4_8_pose_history_sonar();
+void test_4_9_record_replay_log();
+void test_4_10_wheel_velocity_estimator();
+void test_4_11_async_sonar_while_driving();
+void test_4_12_adaptive_sonar_schedule();
 
 
 #endif
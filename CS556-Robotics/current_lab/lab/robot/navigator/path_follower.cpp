@@ -0,0 +1,264 @@
+#include "path_follower.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "../utils/logger.h"
+#include "../utils/util.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "PathFollower"
+
+PathFollower::PathFollower(DifferentialDrive* drive, Navigator* navigator) {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Initialized");
+  this->drive = drive;
+  this->navigator = navigator;
+
+  point_count = 1;
+  segment = 0;
+  active = false;
+
+  speed_cm_per_s = DEFAULT_PURSUIT_SPEED_M_PER_S * 100.0f;
+  lookahead_min_cm = DEFAULT_LOOKAHEAD_MIN_CM;
+  lookahead_max_cm = DEFAULT_LOOKAHEAD_MAX_CM;
+  lookahead_gain_s = DEFAULT_LOOKAHEAD_GAIN_S;
+  goal_tolerance_cm = DEFAULT_GOAL_TOLERANCE_CM;
+
+  last_steer_us = 0;
+  cross_track_cm = 0.0f;
+  max_cross_track_cm = 0.0f;
+}
+
+// ========== PATH ==========
+
+bool PathFollower::add_waypoint(float x_cm, float y_cm) {
+  if (active) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Cannot change a running path");
+    return false;
+  }
+  if (point_count > PATH_MAX_WAYPOINTS) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Waypoint buffer full");
+    return false;
+  }
+
+  points[point_count].x_cm = x_cm;
+  points[point_count].y_cm = y_cm;
+  point_count++;
+  return true;
+}
+
+void PathFollower::clear_path() {
+  if (active) {
+    stop();
+  }
+  point_count = 1;
+  segment = 0;
+}
+
+uint8_t PathFollower::get_waypoint_count() {
+  return point_count - 1;
+}
+
+// ========== CONFIGURATION ==========
+
+void PathFollower::set_speed(float speed_m_per_s) {
+  if (validate_float(speed_m_per_s, 0.0f, 0.4f) && speed_m_per_s > 0.0f) {
+    speed_cm_per_s = speed_m_per_s * 100.0f;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid speed");
+  }
+}
+
+void PathFollower::set_lookahead(float min_cm, float max_cm, float gain_s) {
+  if (min_cm > 0.0f && max_cm >= min_cm && gain_s >= 0.0f) {
+    lookahead_min_cm = min_cm;
+    lookahead_max_cm = max_cm;
+    lookahead_gain_s = gain_s;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid look-ahead");
+  }
+}
+
+void PathFollower::set_goal_tolerance(float tolerance_cm) {
+  if (tolerance_cm > 0.0f) {
+    goal_tolerance_cm = tolerance_cm;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid goal tolerance");
+  }
+}
+
+// ========== EXECUTION ==========
+
+bool PathFollower::start() {
+  if (point_count < 2) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "No waypoints");
+    return false;
+  }
+
+  navigator->update();
+  points[0].x_cm = navigator->getX();
+  points[0].y_cm = navigator->getY();
+
+  // Path length left after each segment, so update() needs no per-tick loop over the path.
+  uint8_t last_segment = point_count - 2;
+  remaining_cm[last_segment] = 0.0f;
+  for (int i = (int)last_segment - 1; i >= 0; i--) {
+    remaining_cm[i] = remaining_cm[i + 1] + segment_length(i + 1);
+  }
+
+  segment = 0;
+  cross_track_cm = 0.0f;
+  max_cross_track_cm = 0.0f;
+  last_steer_us = micros() - PURSUIT_PERIOD_US;
+  active = true;
+
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Following " + String(point_count - 1) + " waypoints, path " +
+                                              String(remaining_cm[0] + segment_length(0)) + " cm").c_str());
+  return true;
+}
+
+bool PathFollower::update() {
+  if (!active) {
+    return false;
+  }
+
+  navigator->update();
+
+  unsigned long now_us = micros();
+  if ((unsigned long)(now_us - last_steer_us) >= PURSUIT_PERIOD_US) {
+    last_steer_us = now_us;
+    if (!steer()) {
+      Logger::log_info(CLASS_NAME, __FUNCTION__, "Goal reached");
+      stop();
+      return false;
+    }
+  }
+
+  drive->poll();
+  return true;
+}
+
+void PathFollower::stop() {
+  active = false;
+  drive->halt();
+}
+
+bool PathFollower::is_active() {
+  return active;
+}
+
+float PathFollower::get_cross_track_error_cm() {
+  return cross_track_cm;
+}
+
+float PathFollower::get_max_cross_track_error_cm() {
+  return max_cross_track_cm;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+bool PathFollower::steer() {
+  float x = navigator->getX();
+  float y = navigator->getY();
+  float theta = navigator->getTheta();
+  uint8_t last_segment = point_count - 2;
+
+  // Closest point: project onto the current segment, moving on once past its end.
+  float t;
+  float length;
+  while (true) {
+    const Waypoint &a = points[segment];
+    const Waypoint &b = points[segment + 1];
+    float sx = b.x_cm - a.x_cm;
+    float sy = b.y_cm - a.y_cm;
+    float length_sq = sx * sx + sy * sy;
+    length = sqrtf(length_sq);
+    t = length_sq > 0.0f ? ((x - a.x_cm) * sx + (y - a.y_cm) * sy) / length_sq : 1.0f;
+    if (t >= 1.0f && segment < last_segment) {
+      segment++;
+      continue;
+    }
+    break;
+  }
+  if (t < 0.0f) {
+    t = 0.0f;
+  }
+
+  const Waypoint &goal = points[point_count - 1];
+  float goal_dx = goal.x_cm - x;
+  float goal_dy = goal.y_cm - y;
+  float goal_distance = sqrtf(goal_dx * goal_dx + goal_dy * goal_dy);
+  if (segment == last_segment && (goal_distance <= goal_tolerance_cm || t >= 1.0f)) {
+    return false;
+  }
+
+  const Waypoint &a = points[segment];
+  const Waypoint &b = points[segment + 1];
+  float px = a.x_cm + t * (b.x_cm - a.x_cm);
+  float py = a.y_cm + t * (b.y_cm - a.y_cm);
+  cross_track_cm = sqrtf((x - px) * (x - px) + (y - py) * (y - py));
+  if (cross_track_cm > max_cross_track_cm) {
+    max_cross_track_cm = cross_track_cm;
+  }
+
+  // Adaptive look-ahead from the measured speed [mm/s -> cm/s].
+  float measured = fabs(drive->get_left_wheel_speed() + drive->get_right_wheel_speed()) / 20.0f;
+  float lookahead = lookahead_gain_s * measured;
+  if (lookahead < lookahead_min_cm) {
+    lookahead = lookahead_min_cm;
+  } else if (lookahead > lookahead_max_cm) {
+    lookahead = lookahead_max_cm;
+  }
+
+  // Walk the look-ahead distance along the path from the closest point.
+  uint8_t index = segment;
+  float along = t * length;
+  float needed = lookahead;
+  float index_length = length;
+  while (along + needed > index_length && index < last_segment) {
+    needed -= index_length - along;
+    along = 0.0f;
+    index++;
+    index_length = segment_length(index);
+  }
+  along += needed;
+  if (along > index_length) {
+    along = index_length;
+  }
+  float fraction = index_length > 0.0f ? along / index_length : 1.0f;
+  float tx = points[index].x_cm + fraction * (points[index + 1].x_cm - points[index].x_cm);
+  float ty = points[index].y_cm + fraction * (points[index + 1].y_cm - points[index].y_cm);
+
+  // Look-ahead point in the robot frame.
+  float dx = tx - x;
+  float dy = ty - y;
+  float c = cosf(theta);
+  float s = sinf(theta);
+  float local_x = c * dx + s * dy;
+  float local_y = -s * dx + c * dy;
+  float distance_sq = dx * dx + dy * dy;
+
+  if (local_x < 0.0f) {
+    // Target behind: turn towards it before driving.
+    drive->command_twist(0.0f, local_y >= 0.0f ? PURSUIT_TURN_RATE_RAD_PER_S : -PURSUIT_TURN_RATE_RAD_PER_S);
+    return true;
+  }
+
+  float remaining = (1.0f - t) * length + remaining_cm[segment];
+  float speed = sqrtf(2.0f * PURSUIT_DECEL_CM_PER_S2 * remaining);
+  if (speed > speed_cm_per_s) {
+    speed = speed_cm_per_s;
+  } else if (speed < PURSUIT_MIN_SPEED_CM_PER_S) {
+    speed = PURSUIT_MIN_SPEED_CM_PER_S;
+  }
+
+  float curvature = distance_sq > 0.0f ? 2.0f * local_y / distance_sq : 0.0f;
+  drive->command_twist(speed / 100.0f, speed * curvature);
+  return true;
+}
+
+float PathFollower::segment_length(uint8_t index) {
+  float dx = points[index + 1].x_cm - points[index].x_cm;
+  float dy = points[index + 1].y_cm - points[index].y_cm;
+  return sqrtf(dx * dx + dy * dy);
+}
@@ -0,0 +1,165 @@
+#ifndef path_follower_h
+#define path_follower_h
+
+#include <stdint.h>
+#include "navigator.h"
+#include "../drivetrain/differential_drive.h"
+
+// ============================================================
+// PURE-PURSUIT PATH FOLLOWER
+// ============================================================
+//
+// Purpose: Steer the robot along a polyline of waypoints using the Navigator pose
+//
+// Description:
+//   Every control period the follower reads Navigator::getX/getY/getTheta,
+//   picks a look-ahead point on the path and commands the arc that reaches it
+//   through DifferentialDrive::command_twist(). Because the pose is fed back
+//   every tick, drift and wheel slip are corrected while driving instead of
+//   accumulating over a scripted sequence of timed moves.
+//
+// Algorithm (one update() per control period):
+//   - Path: start pose (added by start()) followed by the waypoints
+//   - Closest point: projection of the robot onto the current segment; the
+//     segment index only moves forward, so crossings and loops are unambiguous
+//   - Look-ahead distance: L = clamp(gain * v, L_min, L_max) - short when slow
+//     (tight tracking), long when fast (smooth, no oscillation)
+//   - Look-ahead point: L further along the path from the closest point
+//     (the final waypoint if less than L remains)
+//   - Curvature: κ = 2 * y_r / d^2, with y_r the lateral offset of the look-ahead
+//     point in the robot frame and d its distance
+//   - Speed: cruise speed, limited to sqrt(2 * a * remaining) near the goal
+//   - Command: v, ω = v * κ; a look-ahead point behind the robot turns it in place
+//
+// Units: centimetres and radians, as Navigator reports them; speeds in m/s at
+// the public interface like the rest of the drivetrain.
+//
+// Memory: waypoints live in a fixed array of PATH_MAX_WAYPOINTS; no heap.
+//
+// ============================================================
+
+const uint8_t PATH_MAX_WAYPOINTS = 16;                    // Capacity of the waypoint buffer
+const float DEFAULT_PURSUIT_SPEED_M_PER_S = 0.2f;         // Cruise speed along the path
+const float DEFAULT_LOOKAHEAD_MIN_CM = 6.0f;              // Look-ahead at low speed
+const float DEFAULT_LOOKAHEAD_MAX_CM = 25.0f;             // Look-ahead at high speed
+const float DEFAULT_LOOKAHEAD_GAIN_S = 0.6f;              // Look-ahead per unit speed [cm per cm/s]
+const float DEFAULT_GOAL_TOLERANCE_CM = 1.5f;             // Stop within this distance of the last waypoint
+const float PURSUIT_DECEL_CM_PER_S2 = 40.0f;              // Slow-down rate approaching the goal
+const float PURSUIT_MIN_SPEED_CM_PER_S = 3.0f;            // Never crawl slower than this before the goal
+const float PURSUIT_TURN_RATE_RAD_PER_S = 2.0f;           // In-place turn when the target is behind
+const unsigned long PURSUIT_PERIOD_US = 10000;            // Steering update period (100 Hz)
+
+struct Waypoint {
+  float x_cm;
+  float y_cm;
+};
+
+class PathFollower {
+  public:
+    // Purpose: Initialize an idle follower
+    // Args: drive - drivetrain to command
+    //       navigator - pose source
+    // Return: void
+    PathFollower(DifferentialDrive* drive, Navigator* navigator);
+
+    // ========== PATH ==========
+
+    // Purpose: Append a waypoint to the path
+    // Args: x_cm, y_cm - position in the Navigator frame [cm]
+    // Return: bool - false if the buffer is full or the path is running
+    bool add_waypoint(float x_cm, float y_cm);
+
+    // Purpose: Remove all waypoints (stops a running path)
+    // Args: None
+    // Return: void
+    void clear_path();
+
+    // Purpose: Number of waypoints in the path
+    // Args: None
+    // Return: uint8_t
+    uint8_t get_waypoint_count();
+
+    // ========== CONFIGURATION ==========
+
+    // Purpose: Set the cruise speed along the path
+    // Args: speed_m_per_s - speed in m/s (0.0 to 0.4)
+    // Return: void
+    void set_speed(float speed_m_per_s);
+
+    // Purpose: Set the adaptive look-ahead
+    // Args: min_cm - look-ahead at standstill [cm]
+    //       max_cm - upper bound [cm]
+    //       gain_s - look-ahead per unit speed [s]
+    // Return: void
+    void set_lookahead(float min_cm, float max_cm, float gain_s);
+
+    // Purpose: Set how close to the last waypoint counts as arrived
+    // Args: tolerance_cm - distance [cm] (positive)
+    // Return: void
+    void set_goal_tolerance(float tolerance_cm);
+
+    // ========== EXECUTION ==========
+
+    // Purpose: Start following the path from the current pose
+    // Args: None
+    // Return: bool - false if there are no waypoints
+    bool start();
+
+    // Purpose: Run one pass of the follower
+    // Description: Updates the Navigator, steers every PURSUIT_PERIOD_US and
+    //   polls the drive; call it from the loop until it returns false
+    // Args: None
+    // Return: bool - true while the path is being followed
+    bool update();
+
+    // Purpose: Stop following and halt the motors
+    // Args: None
+    // Return: void
+    void stop();
+
+    // Purpose: Check whether a path is being followed
+    // Args: None
+    // Return: bool
+    bool is_active();
+
+    // Purpose: Distance from the robot to the path at the last steering update
+    // Args: None
+    // Return: float - cross-track error [cm]
+    float get_cross_track_error_cm();
+
+    // Purpose: Largest cross-track error since start()
+    // Args: None
+    // Return: float - [cm]
+    float get_max_cross_track_error_cm();
+
+  private:
+    // Purpose: Compute and command one steering step from the current pose
+    // Return: bool - false once the goal is reached
+    bool steer();
+
+    // Purpose: Length of a path segment
+    // Args: index - segment from points[index] to points[index + 1]
+    // Return: float - [cm]
+    float segment_length(uint8_t index);
+
+    DifferentialDrive* drive;
+    Navigator* navigator;
+
+    Waypoint points[PATH_MAX_WAYPOINTS + 1];  // Start pose (slot 0) followed by the waypoints
+    float remaining_cm[PATH_MAX_WAYPOINTS];   // Path length from the end of segment i to the goal
+    uint8_t point_count;                      // Entries used in points[], slot 0 included
+    uint8_t segment;                          // Segment the robot is on
+    bool active;                              // true between start() and arrival/stop()
+
+    float speed_cm_per_s;                     // Cruise speed
+    float lookahead_min_cm;
+    float lookahead_max_cm;
+    float lookahead_gain_s;
+    float goal_tolerance_cm;
+
+    unsigned long last_steer_us;              // micros() of the last steering update
+    float cross_track_cm;                     // Distance to the path at the last update
+    float max_cross_track_cm;                 // Worst distance since start()
+};
+
+#endif
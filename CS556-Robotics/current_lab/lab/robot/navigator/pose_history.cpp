@@ -0,0 +1,91 @@
+#include "pose_history.h"
+
+PoseHistory::PoseHistory() {
+  clear();
+}
+
+void PoseHistory::clear() {
+  head = 0;
+  count = 0;
+}
+
+void PoseHistory::add(unsigned long t_us, float x, float y, float theta) {
+  // The newest entry is provisional until it is a full interval after the one
+  // before it; until then it is moved forward instead of adding another.
+  uint8_t target = head;
+  if (count >= 2 && entries[slot(count - 1)].t_us - entries[slot(count - 2)].t_us < POSE_HISTORY_MIN_INTERVAL_US) {
+    target = slot(count - 1);
+  } else {
+    head = (head + 1) % POSE_HISTORY_SIZE;
+    if (count < POSE_HISTORY_SIZE) {
+      count++;
+    }
+  }
+
+  PoseStamp &entry = entries[target];
+  entry.t_us = t_us;
+  entry.x = x;
+  entry.y = y;
+  entry.theta = theta;
+}
+
+PoseLookup PoseHistory::lookup(unsigned long t_us, PoseStamp &pose) const {
+  noInterrupts();
+  if (count == 0) {
+    interrupts();
+    return PoseLookup::EMPTY;
+  }
+
+  unsigned long oldest_us = entries[slot(0)].t_us;
+  const PoseStamp &newest = entries[slot(count - 1)];
+  if ((long)(t_us - oldest_us) < 0) {
+    interrupts();
+    return PoseLookup::TOO_OLD;
+  }
+  if ((long)(t_us - newest.t_us) >= 0) {
+    pose = newest;
+    interrupts();
+    pose.t_us = t_us;
+    return PoseLookup::LATEST;
+  }
+
+  // Last entry at or before t: entries[low] <= t < entries[high].
+  unsigned long offset = t_us - oldest_us;
+  uint8_t low = 0;
+  uint8_t high = count - 1;
+  while (high - low > 1) {
+    uint8_t middle = (low + high) / 2;
+    if (entries[slot(middle)].t_us - oldest_us <= offset) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  PoseStamp before = entries[slot(low)];
+  PoseStamp after = entries[slot(high)];
+  interrupts();
+
+  float fraction = (float)(t_us - before.t_us) / (float)(after.t_us - before.t_us);
+  pose.t_us = t_us;
+  pose.x = before.x + fraction * (after.x - before.x);
+  pose.y = before.y + fraction * (after.y - before.y);
+  pose.theta = before.theta + fraction * (after.theta - before.theta);
+  return PoseLookup::INTERPOLATED;
+}
+
+uint8_t PoseHistory::get_count() const {
+  return count;
+}
+
+unsigned long PoseHistory::get_span_us() const {
+  noInterrupts();
+  unsigned long span_us = count > 0 ? entries[slot(count - 1)].t_us - entries[slot(0)].t_us : 0;
+  interrupts();
+  return span_us;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+uint8_t PoseHistory::slot(uint8_t index) const {
+  return (head + POSE_HISTORY_SIZE - count + index) % POSE_HISTORY_SIZE;
+}
@@ -0,0 +1,98 @@
+#ifndef pose_history_h
+#define pose_history_h
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// ============================================================
+// POSE HISTORY
+// ============================================================
+//
+// Purpose: Remember the recent poses with their timestamps, so a measurement
+//   taken between two odometry updates (sonar echo, IMU sample) can be placed
+//   where the robot really was when it was taken
+//
+// Description:
+//   A fixed ring of POSE_HISTORY_SIZE (t_us, x, y, theta) entries, oldest
+//   overwritten first. Entries are kept at least POSE_HISTORY_MIN_INTERVAL_US
+//   apart: while the newest entry is less than that after the one before it,
+//   updates replace it instead of adding another. The newest entry is always
+//   the latest pose and the buffer spans about (SIZE - 1) intervals (150 ms)
+//   whatever the update rate.
+//
+// Lookup (O(log n)):
+//   - Binary search, in time order, for the last entry at or before t
+//   - Linear interpolation to the next entry; theta is unwrapped by the
+//     odometry, so it interpolates without angle wrap handling
+//   - Times are compared as offsets from the oldest entry, so micros()
+//     rollover does not break the ordering
+//
+// Interrupts: add() may run in the ControlTimer tick; lookup() searches and
+//   copies the two entries it needs with interrupts disabled.
+//
+// ============================================================
+
+const uint8_t POSE_HISTORY_SIZE = 16;                       // Entries (16 bytes each)
+const unsigned long POSE_HISTORY_MIN_INTERVAL_US = 10000;   // Minimum spacing between kept entries
+
+// One timestamped pose
+struct PoseStamp {
+  unsigned long t_us;    // micros() the pose refers to
+  float x;               // [cm]
+  float y;               // [cm]
+  float theta;           // [rad], unwrapped
+};
+
+// Result of a lookup
+enum class PoseLookup {
+  INTERPOLATED,          // Between two entries
+  LATEST,                // Newer than the newest entry; the latest pose is returned
+  TOO_OLD,               // Older than the history covers; nothing returned
+  EMPTY                  // No pose recorded yet
+};
+
+class PoseHistory {
+  public:
+    // Purpose: Initialize an empty history
+    // Args: None
+    // Return: void
+    PoseHistory();
+
+    // Purpose: Forget every entry
+    // Args: None
+    // Return: void
+    void clear();
+
+    // Purpose: Record a pose
+    // Args: t_us - micros() the pose refers to (not older than the newest entry)
+    //       x, y - position [cm]
+    //       theta - heading [rad]
+    // Return: void
+    void add(unsigned long t_us, float x, float y, float theta);
+
+    // Purpose: Pose at a recent time
+    // Args: t_us - micros() of the measurement
+    //       pose - interpolated pose (t_us set to the requested time)
+    // Return: PoseLookup - INTERPOLATED or LATEST when pose was written
+    PoseLookup lookup(unsigned long t_us, PoseStamp &pose) const;
+
+    // Purpose: Number of entries held
+    // Args: None
+    // Return: uint8_t
+    uint8_t get_count() const;
+
+    // Purpose: Time span covered by the entries
+    // Args: None
+    // Return: unsigned long - newest minus oldest timestamp [us]
+    unsigned long get_span_us() const;
+
+  private:
+    // Purpose: Buffer slot of the i-th entry in time order (0 = oldest)
+    uint8_t slot(uint8_t index) const;
+
+    PoseStamp entries[POSE_HISTORY_SIZE];
+    volatile uint8_t head;     // Slot the next entry goes to
+    volatile uint8_t count;    // Entries in use
+};
+
+#endif
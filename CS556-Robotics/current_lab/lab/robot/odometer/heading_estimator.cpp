@@ -0,0 +1,152 @@
+#include "heading_estimator.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "../utils/logger.h"
+#include "../utils/util.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "HeadingEstimator"
+
+// Gyro LSB times microseconds to radians
+static const float GYRO_RAD_PER_LSB_US = GYRO_SENSITIVITY_DPS_PER_LSB * (M_PI / 180.0f) * 1.0e-6f;
+
+static const float GYRO_STILL_MAX_LSB = GYRO_STILL_MAX_DPS / GYRO_SENSITIVITY_DPS_PER_LSB;
+
+HeadingEstimator::HeadingEstimator() {
+  ready = false;
+  sample_heading = 0.0f;
+  encoder_since_sample = 0.0f;
+  encoder_heading = 0.0f;
+  gyro_bias_lsb = 0.0f;
+  bias_samples = 0;
+  still_samples = 0;
+  motion_counts = 0;
+  last_rate_lsb = 0;
+  inverse_time_constant = 1.0f / DEFAULT_HEADING_TIME_CONSTANT_S;
+  last_sample_us = 0;
+  set_geometry(NOMINAL_ODOMETRY_GEOMETRY);
+}
+
+bool HeadingEstimator::begin() {
+  Wire.begin();
+  Wire.setClock(IMU_I2C_CLOCK_HZ);
+  if (!imu.init()) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "IMU not found");
+    ready = false;
+    return false;
+  }
+  imu.enableDefault();
+
+  ready = true;
+  last_sample_us = micros();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "IMU ready, learning gyro bias while the wheels are still");
+  return true;
+}
+
+bool HeadingEstimator::is_ready() const {
+  return ready;
+}
+
+void HeadingEstimator::reset(float heading) {
+  sample_heading = heading;
+  encoder_since_sample = 0.0f;
+  encoder_heading = heading;
+  last_sample_us = micros();
+}
+
+void HeadingEstimator::set_time_constant(float time_constant_s) {
+  if (time_constant_s > 0.0f) {
+    inverse_time_constant = 1.0f / time_constant_s;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid time constant");
+  }
+}
+
+void HeadingEstimator::set_geometry(const OdometryGeometry &geometry) {
+  rad_per_count_l = M_PI * geometry.diameter_left_cm / (N_L * GEAR_RATIO) / geometry.wheelbase_cm;
+  rad_per_count_r = M_PI * geometry.diameter_right_cm / (N_R * GEAR_RATIO) / geometry.wheelbase_cm;
+}
+
+void HeadingEstimator::update(int32_t delta_left, int32_t delta_right) {
+  float encoder_step = delta_right * rad_per_count_r - delta_left * rad_per_count_l;
+  encoder_heading += encoder_step;
+  encoder_since_sample += encoder_step;
+  uint32_t moved = (uint32_t)(delta_left < 0 ? -delta_left : delta_left) +
+                   (uint32_t)(delta_right < 0 ? -delta_right : delta_right);
+  motion_counts = moved > 0xFFFFUL - motion_counts ? 0xFFFF : motion_counts + moved;
+
+  if (!ready) {
+    return;
+  }
+
+  unsigned long now_us = micros();
+  unsigned long dt_us = now_us - last_sample_us;
+  if (dt_us < HEADING_SAMPLE_PERIOD_US) {
+    return;
+  }
+  last_sample_us = now_us;
+
+  imu.readGyro();
+  int16_t rate_lsb = imu.g.z;
+  last_rate_lsb = rate_lsb;
+
+  if (motion_counts == 0) {
+    if (still_samples < GYRO_STILL_SAMPLES) {
+      still_samples++;
+    }
+  } else {
+    still_samples = 0;
+  }
+  motion_counts = 0;
+  bool still = still_samples >= GYRO_STILL_SAMPLES;
+
+  if (still && (!is_bias_valid() || fabs(rate_lsb - gyro_bias_lsb) < GYRO_STILL_MAX_LSB)) {
+    learn_bias(rate_lsb);
+  }
+
+  // Still wheels hold the heading; an untrusted bias or a long gap falls back to the encoders.
+  float predicted;
+  if (still || !is_bias_valid() || dt_us > HEADING_MAX_GAP_US) {
+    predicted = sample_heading + encoder_since_sample;
+  } else {
+    predicted = sample_heading + (rate_lsb - gyro_bias_lsb) * GYRO_RAD_PER_LSB_US * dt_us;
+  }
+  float gain = dt_us * 1.0e-6f * inverse_time_constant;
+  if (gain > 1.0f) {
+    gain = 1.0f;
+  }
+  sample_heading = predicted + gain * (encoder_heading - predicted);
+  encoder_since_sample = 0.0f;
+}
+
+float HeadingEstimator::get_heading() const {
+  return sample_heading + encoder_since_sample;
+}
+
+float HeadingEstimator::get_encoder_heading() const {
+  return encoder_heading;
+}
+
+bool HeadingEstimator::is_bias_valid() const {
+  return bias_samples >= GYRO_BIAS_MIN_SAMPLES;
+}
+
+int16_t HeadingEstimator::get_gyro_rate_lsb() const {
+  return last_rate_lsb;
+}
+
+float HeadingEstimator::get_gyro_bias_dps() const {
+  return gyro_bias_lsb * GYRO_SENSITIVITY_DPS_PER_LSB;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+void HeadingEstimator::learn_bias(int16_t rate_lsb) {
+  // Plain average while few samples are in, then a running average that tracks drift.
+  if (bias_samples < GYRO_BIAS_FILTER_SAMPLES) {
+    bias_samples++;
+  }
+  gyro_bias_lsb += (rate_lsb - gyro_bias_lsb) / bias_samples;
+}
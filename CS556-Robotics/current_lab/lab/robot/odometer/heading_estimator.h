@@ -0,0 +1,151 @@
+#ifndef heading_estimator_h
+#define heading_estimator_h
+
+#include <Pololu3piPlus32U4.h>
+#include <Pololu3piPlus32U4IMU.h>
+#include <stdint.h>
+#include "odometry.h"
+
+using namespace Pololu3piPlus32U4;
+
+// ============================================================
+// IMU-FUSED HEADING ESTIMATOR
+// ============================================================
+//
+// Purpose: Estimate the robot heading from the gyro and the encoders together
+//
+// Description:
+//   Encoder heading, (dr - dl) / W, is exact while the wheels grip but every
+//   slip or scrub during a turn becomes a permanent heading error. The gyro
+//   does not see the wheels at all, but its small bias integrates into a slow
+//   drift. A complementary filter takes the best of both: the gyro rate for
+//   everything faster than the crossover time constant, the encoder heading
+//   for everything slower.
+//
+// Filter (one gyro sample every HEADING_SAMPLE_PERIOD_US):
+//   - dt        = micros() between samples (real time, not an assumed rate)
+//   - ω         = (g.z - bias) * 35 mdps/LSB          (±1000 dps full scale)
+//   - predicted = θ + ω * dt
+//   - θ         = predicted + (dt / τ) * (θ_enc - predicted)
+//   Between samples the encoder increments carry the estimate forward, so the
+//   heading never lags the wheels by a whole sample period. After a gap longer
+//   than HEADING_MAX_GAP_US (update() not called, e.g. during a blocking move)
+//   the encoder increment is used for the gap instead of one stale gyro rate.
+//
+// Online Bias (zero-velocity detection, no blocking calibration):
+//   - The wheels count as still after GYRO_STILL_SAMPLES gyro samples in a row
+//     with no encoder count at all
+//   - While still, each gyro sample is bias: averaged over the first samples,
+//     then an exponential average over GYRO_BIAS_FILTER_SAMPLES, so the
+//     estimate follows thermal drift during long runs
+//   - A still-wheel rate far from the bias (robot lifted and turned by hand)
+//     is not learned
+//   - While still the heading holds; until GYRO_BIAS_MIN_SAMPLES have been
+//     learned the gyro is not trusted and the encoders alone drive the heading
+//
+// Cost: one 6-byte I2C read at 400 kHz and a handful of float operations per
+//   sample; the gyro and time scales are folded into one constant.
+//
+// Units: radians, counterclockwise positive, unwrapped (like Odometry).
+//
+// ============================================================
+
+const unsigned long HEADING_SAMPLE_PERIOD_US = 10000;        // Gyro sample period (100 Hz)
+const unsigned long HEADING_MAX_GAP_US = 50000;              // Longer gaps: one gyro sample cannot stand for them
+const float GYRO_SENSITIVITY_DPS_PER_LSB = 0.035f;           // LSM6 at ±1000 dps (IMU::enableDefault)
+const float DEFAULT_HEADING_TIME_CONSTANT_S = 20.0f;         // Gyro/encoder crossover
+const uint8_t GYRO_STILL_SAMPLES = 20;                       // Samples without encoder motion before the robot is still
+const uint16_t GYRO_BIAS_MIN_SAMPLES = 50;                   // Still samples before the bias is trusted
+const uint16_t GYRO_BIAS_FILTER_SAMPLES = 256;               // Length of the running bias average
+const float GYRO_STILL_MAX_DPS = 2.0f;                       // Larger still-wheel rates are real rotation, not bias
+const unsigned long IMU_I2C_CLOCK_HZ = 400000;               // Fast-mode I2C for the gyro reads
+
+class HeadingEstimator {
+  public:
+    // Purpose: Initialize an estimator that has not started the IMU yet
+    // Args: None
+    // Return: void
+    HeadingEstimator();
+
+    // Purpose: Start the IMU
+    // Description: Does not block; the gyro bias is learned whenever the wheels stand still
+    // Args: None
+    // Return: bool - false if the IMU does not respond
+    bool begin();
+
+    // Purpose: Check whether begin() succeeded
+    // Args: None
+    // Return: bool
+    bool is_ready() const;
+
+    // Purpose: Restart the estimate from a known heading
+    // Args: heading - heading to continue from [rad]
+    // Return: void
+    void reset(float heading);
+
+    // Purpose: Set the gyro/encoder crossover
+    // Args: time_constant_s - longer trusts the gyro for longer (positive)
+    // Return: void
+    void set_time_constant(float time_constant_s);
+
+    // Purpose: Set the wheel geometry the encoder heading is computed with
+    // Args: geometry - diameters and wheelbase, as given to Odometry::set_geometry()
+    // Return: void
+    void set_geometry(const OdometryGeometry &geometry);
+
+    // Purpose: Advance the estimate by one encoder step
+    // Description: Call on every odometry update; samples the gyro, learns the
+    //   bias and applies the filter once HEADING_SAMPLE_PERIOD_US has passed
+    // Args: delta_left, delta_right - encoder counts since the previous call
+    // Return: void
+    void update(int32_t delta_left, int32_t delta_right);
+
+    // Purpose: Get the fused heading
+    // Args: None
+    // Return: float - [rad]
+    float get_heading() const;
+
+    // Purpose: Get the encoder-only heading over the same period
+    // Args: None
+    // Return: float - [rad], for comparison with get_heading()
+    float get_encoder_heading() const;
+
+    // Purpose: Check whether enough still samples have been seen to trust the gyro
+    // Args: None
+    // Return: bool
+    bool is_bias_valid() const;
+
+    // Purpose: Get the current gyro bias estimate
+    // Args: None
+    // Return: float - [deg/s]
+    float get_gyro_bias_dps() const;
+
+    // Purpose: Get the raw gyro reading of the last sample (for logging)
+    // Args: None
+    // Return: int16_t - gyro z [LSB], bias not removed
+    int16_t get_gyro_rate_lsb() const;
+
+  private:
+    // Purpose: Fold one still-wheel gyro sample into the bias estimate
+    // Args: rate_lsb - raw gyro z [LSB]
+    // Return: void
+    void learn_bias(int16_t rate_lsb);
+
+    IMU imu;
+    bool ready;
+
+    float sample_heading;           // Fused heading at the last gyro sample
+    float encoder_since_sample;     // Encoder rotation since the last gyro sample
+    float encoder_heading;          // Encoder-only heading
+    float gyro_bias_lsb;            // Zero-rate output [LSB]
+    uint16_t bias_samples;          // Still samples learned (saturates at GYRO_BIAS_FILTER_SAMPLES)
+    uint8_t still_samples;          // Consecutive samples without encoder motion
+    uint16_t motion_counts;         // Encoder counts since the last gyro sample
+    int16_t last_rate_lsb;          // Raw gyro z of the last sample
+    float inverse_time_constant;    // 1 / τ [1/s]
+    float rad_per_count_l;          // Rotation per left encoder count [rad]
+    float rad_per_count_r;          // Rotation per right encoder count [rad]
+    unsigned long last_sample_us;   // micros() of the last gyro sample
+};
+
+#endif
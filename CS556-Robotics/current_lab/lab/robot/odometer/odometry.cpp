@@ -7,13 +7,10 @@
 #define CLASS_NAME "Odometry"
 
 Odometry::Odometry() {
-  _diaL = DIA_L;
-  _diaR = DIA_R;
-  _w = W;
   _nL = N_L;
   _nR = N_R;
   _gearRatio = GEAR_RATIO;
-  _deadreckoning = DEAD_RECKONING;
+  set_geometry(NOMINAL_ODOMETRY_GEOMETRY);
 
   _x = 0;
   _y = 0;
@@ -22,35 +19,47 @@ Odometry::Odometry() {
   _left_encoder_counts_prev = 0;
   _right_encoder_counts_prev = 0;
 
-  if(_deadreckoning){
-    Wire.begin();
-    _imu.init();
-    _imu.enableDefault();
-
-    int total = 0;
-    for (int i = 0; i < 100; i++)
-    {
-      _imu.readGyro();
-      total += _imu.g.z;
-      delay(1);
-    }
-    _IMUavg_error = total / 100;  
-  }
+  _mode = DEFAULT_ODOMETRY_MODE;
+  _integration = DEFAULT_ODOMETRY_INTEGRATION;
+  _x_fixed = 0;
+  _y_fixed = 0;
+  _heading = 0;
+  _turns = 0;
+
+  _wheel_variance_l = DEFAULT_WHEEL_VARIANCE_CM;
+  _wheel_variance_r = DEFAULT_WHEEL_VARIANCE_CM;
+  _covariance_enabled = DEFAULT_COVARIANCE_ENABLED;
+  reset_covariance();
+}
+
+// Heading [rad] to a binary angle for the covariance lookups
+static uint16_t covariance_angle(float heading) {
+  return (uint16_t)(int32_t)(heading * (32768.0f / 3.14159265f));
 }
 
-void Odometry::update_odom(int left_counts, int right_counts, float &x, float &y, float &theta) {
-  Logger::log_info(CLASS_NAME, __FUNCTION__, "Updating odometry");
+void Odometry::update_odom(int32_t left_counts, int32_t right_counts, float &x, float &y, float &theta) {
+  if (_mode == OdometryMode::FIXED) {
+    update_odom_fixed(left_counts, right_counts, x, y, theta);
+    return;
+  }
+
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, "Updating odometry");
 
   double pi = 3.14159265358979323846;
 
   double delta_l = (double) ((left_counts - _left_encoder_counts_prev) * pi * _diaL) / (_nL * _gearRatio);
   double delta_r = (double) ((right_counts - _right_encoder_counts_prev) * pi * _diaR) / (_nR * _gearRatio);
 
-  _theta += (delta_r - delta_l) / _w;
-  
-  _y = ((float) (float)(delta_l + delta_r)/2) * sin(_theta);
-  _x = ((float) (float)(delta_l + delta_r)/2) * cos(_theta);
-  
+  float rotation = (delta_r - delta_l) / _w;
+  float dx, dy;
+  integrate_pose_step(_integration, _theta, (float)(delta_l + delta_r) / 2, rotation, dx, dy);
+  if (_covariance_enabled) {
+    propagate_covariance(delta_l, delta_r, covariance_angle(_theta + 0.5f * rotation));
+  }
+  _theta += rotation;
+
+  _y = dy;
+  _x = dx;
 
   theta = _theta;
   y += _y;
@@ -62,21 +71,30 @@ void Odometry::update_odom(int left_counts, int right_counts, float &x, float &y
 
 }
 
-void Odometry::update_odom_imu(int left_counts, int right_counts, float &x, float &y, float &theta) {
-  Logger::log_info(CLASS_NAME, __FUNCTION__, "Updating odometry (IMU-assisted)");
+void Odometry::update_odom_heading(int32_t left_counts, int32_t right_counts, float heading, float &x, float &y, float &theta) {
+  if (_mode == OdometryMode::FIXED) {
+    update_odom_heading_fixed(left_counts, right_counts, heading, x, y, theta);
+    return;
+  }
+
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, "Updating odometry (external heading)");
 
   double pi = 3.14159265358979323846;
 
   double delta_l = (double) ((left_counts - _left_encoder_counts_prev) * pi * _diaL) / (_nL * _gearRatio);
   double delta_r = (double) ((right_counts - _right_encoder_counts_prev) * pi * _diaR) / (_nR * _gearRatio);
 
+  // The step turns from the previous heading to the new one; the scheme places the translation.
+  float rotation = heading - _theta;
+  float dx, dy;
+  integrate_pose_step(_integration, _theta, (float)(delta_l + delta_r) / 2, rotation, dx, dy);
+  if (_covariance_enabled) {
+    propagate_covariance(delta_l, delta_r, covariance_angle(_theta + 0.5f * rotation));
+  }
+  _theta = heading;
 
-  _imu.readGyro();
-  float angleRate = (_imu.g.z - _IMUavg_error);
-  _theta += angleRate * 0.0001;
-
-  _y = ((float) (float)(delta_l + delta_r) /2) * sin(_theta);
-  _x = ((float) (float)(delta_l + delta_r) /2) * cos(_theta);
+  _y = dy;
+  _x = dx;
 
   theta = _theta;
   y += _y;
@@ -85,3 +103,231 @@ void Odometry::update_odom_imu(int left_counts, int right_counts, float &x, floa
   _left_encoder_counts_prev = left_counts;
   _right_encoder_counts_prev = right_counts;
 }
+
+void Odometry::set_mode(OdometryMode mode, float x, float y, float theta) {
+  _mode = mode;
+  _theta = theta;
+
+  if (mode == OdometryMode::FIXED) {
+    _x_fixed = (int32_t)(x * 65536.0f);
+    _y_fixed = (int32_t)(y * 65536.0f);
+    set_fixed_heading(theta);
+  }
+}
+
+OdometryMode Odometry::get_mode() const {
+  return _mode;
+}
+
+void Odometry::set_integration(OdometryIntegration integration) {
+  _integration = integration;
+}
+
+OdometryIntegration Odometry::get_integration() const {
+  return _integration;
+}
+
+void Odometry::set_covariance_enabled(bool enabled) {
+  _covariance_enabled = enabled;
+}
+
+bool Odometry::is_covariance_enabled() const {
+  return _covariance_enabled;
+}
+
+const PoseCovariance& Odometry::get_covariance() const {
+  return _covariance;
+}
+
+void Odometry::reset_covariance() {
+  _covariance.xx = 0.0f;
+  _covariance.xy = 0.0f;
+  _covariance.xtheta = 0.0f;
+  _covariance.yy = 0.0f;
+  _covariance.ytheta = 0.0f;
+  _covariance.thetatheta = 0.0f;
+}
+
+void Odometry::set_wheel_variance(float left_cm, float right_cm) {
+  if (left_cm >= 0.0f && right_cm >= 0.0f) {
+    _wheel_variance_l = left_cm;
+    _wheel_variance_r = right_cm;
+  } else {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid wheel variance");
+  }
+}
+
+bool Odometry::set_geometry(const OdometryGeometry &geometry) {
+  if (!(geometry.diameter_left_cm > 0.0f && geometry.diameter_right_cm > 0.0f && geometry.wheelbase_cm > 0.0f)) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid wheel geometry");
+    return false;
+  }
+
+  _geometry = geometry;
+  _diaL = geometry.diameter_left_cm;
+  _diaR = geometry.diameter_right_cm;
+  _w = geometry.wheelbase_cm;
+
+  _cm_per_count_l = 3.14159265f * _diaL / (_nL * _gearRatio);
+  _cm_per_count_r = 3.14159265f * _diaR / (_nR * _gearRatio);
+  _half_travel_l = (int32_t)(_cm_per_count_l * 2097152.0f + 0.5f);
+  _half_travel_r = (int32_t)(_cm_per_count_r * 2097152.0f + 0.5f);
+  _heading_per_count_l = (uint32_t)(_cm_per_count_l / (2.0f * 3.14159265f * _w) * 4294967296.0f + 0.5f);
+  _heading_per_count_r = (uint32_t)(_cm_per_count_r / (2.0f * 3.14159265f * _w) * 4294967296.0f + 0.5f);
+  return true;
+}
+
+const OdometryGeometry& Odometry::get_geometry() const {
+  return _geometry;
+}
+
+// 1 - sin(h)/h in Q15 for half the step rotation h, from the series h^2/6 - h^4/120
+// (within 0.3 % of the exact chord up to a quarter turn per step).
+static int32_t chord_reduction_q15(int32_t step) {
+  // Half the step in Q12 radians: (step >> 16) * 2π / 65536 / 2 * 4096 = (step >> 16) * π / 16
+  int32_t half = multiply_q15(step >> 16, 6434);
+  int32_t half_sq = (half * half) >> 12;
+  int32_t half_4 = (half_sq * half_sq) >> 12;
+  return half_sq * 4 / 3 - half_4 / 15;
+}
+
+// Same model and integration schemes as update_odom(), with integer arithmetic only:
+// two table lookups and a handful of 32-bit multiplies.
+void Odometry::update_odom_fixed(int32_t left_counts, int32_t right_counts, float &x, float &y, float &theta) {
+  integrate_fixed(left_counts, right_counts, false, 0);
+  get_fixed_pose(x, y, theta);
+}
+
+// Integer kernel with the heading from outside: the step turns from the fixed heading
+// to the given one, like the float path, and the encoders only provide the distance.
+void Odometry::update_odom_heading_fixed(int32_t left_counts, int32_t right_counts, float heading, float &x, float &y, float &theta) {
+  float x_now, y_now, theta_now;
+  get_fixed_pose(x_now, y_now, theta_now);
+  int64_t rotation = (int64_t)((heading - theta_now) * (4294967296.0f / (2.0f * 3.14159265f)));
+  integrate_fixed(left_counts, right_counts, true, rotation);
+
+  // Take the heading itself, not the sum of rounded steps, so it does not drift from the source.
+  set_fixed_heading(heading);
+  get_fixed_pose(x, y, theta);
+}
+
+void Odometry::integrate_fixed(int32_t left_counts, int32_t right_counts, bool external_heading, int64_t rotation) {
+  int32_t delta_l = left_counts - _left_encoder_counts_prev;
+  int32_t delta_r = right_counts - _right_encoder_counts_prev;
+  _left_encoder_counts_prev = left_counts;
+  _right_encoder_counts_prev = right_counts;
+
+  // A long gap between updates (or one update per motion): split the step into
+  // equal parts along the same arc, each within int16 counts and a quarter turn,
+  // so neither the deltas nor the binary-angle step wrap.
+  int32_t size_l = delta_l < 0 ? -delta_l : delta_l;
+  int32_t size_r = delta_r < 0 ? -delta_r : delta_r;
+  int32_t parts = (size_l > size_r ? size_l : size_r) / 32768 + 1;
+  int64_t turn = external_heading ? rotation
+                                  : (int64_t)delta_r * _heading_per_count_r - (int64_t)delta_l * _heading_per_count_l;
+  int32_t turn_parts = (int32_t)((turn < 0 ? -turn : turn) >> 30) + 1;
+  if (turn_parts > parts) {
+    parts = turn_parts;
+  }
+  if (parts > 1) {
+    Logger::log_debug(CLASS_NAME, __FUNCTION__, "Large step, integrating in parts");
+  }
+  for (int32_t i = parts; i > 0; i--) {
+    int16_t part_l = (int16_t)(delta_l / i);
+    int16_t part_r = (int16_t)(delta_r / i);
+    delta_l -= part_l;
+    delta_r -= part_r;
+
+    // Heading: unsigned arithmetic wraps exactly like the angle does.
+    uint32_t step;
+    if (external_heading) {
+      int32_t part = (int32_t)(rotation / i);
+      rotation -= part;
+      step = (uint32_t)part;
+    } else {
+      step = (uint32_t)(int32_t)part_r * _heading_per_count_r - (uint32_t)(int32_t)part_l * _heading_per_count_l;
+    }
+    step_odom_fixed(part_l, part_r, step);
+  }
+}
+
+void Odometry::get_fixed_pose(float &x, float &y, float &theta) const {
+  x = _x_fixed * (1.0f / 65536.0f);
+  y = _y_fixed * (1.0f / 65536.0f);
+  theta = _turns * (2.0f * 3.14159265f) + (int32_t)_heading * (2.0f * 3.14159265f / 4294967296.0f);
+}
+
+void Odometry::set_fixed_heading(float theta) {
+  // Split theta into whole turns and a remainder in [-0.5, 0.5) turn.
+  const float two_pi = 2.0f * 3.14159265f;
+  float turns = floorf(theta / two_pi + 0.5f);
+  float fraction = theta / two_pi - turns;
+  _turns = (int16_t)turns;
+  _heading = (uint32_t)(int32_t)(fraction * 2147483648.0f) << 1;
+}
+
+void Odometry::step_odom_fixed(int16_t delta_l, int16_t delta_r, uint32_t step) {
+  uint32_t previous = _heading;
+  _heading += step;
+  if ((int32_t)step > 0 && (int32_t)_heading < (int32_t)previous) {
+    _turns++;
+  } else if ((int32_t)step < 0 && (int32_t)_heading > (int32_t)previous) {
+    _turns--;
+  }
+
+  int32_t distance = ((int32_t)delta_l * _half_travel_l + (int32_t)delta_r * _half_travel_r + 32) >> 6;
+
+  // Project along the new heading (EULER) or the mid-step heading; EXACT_ARC shortens to the chord.
+  uint32_t projection = _heading;
+  if (_integration != OdometryIntegration::EULER) {
+    projection = previous + (uint32_t)((int32_t)step / 2);
+  }
+  if (_integration == OdometryIntegration::EXACT_ARC) {
+    distance -= multiply_q15(distance, (int16_t)chord_reduction_q15((int32_t)step));
+  }
+  uint16_t angle = (uint16_t)((projection + 0x8000UL) >> 16);
+  _x_fixed += multiply_q15(distance, cos_q15(angle));
+  _y_fixed += multiply_q15(distance, sin_q15(angle));
+
+  if (_covariance_enabled) {
+    propagate_covariance(delta_l * _cm_per_count_l, delta_r * _cm_per_count_r,
+                         (uint16_t)((previous + (uint32_t)((int32_t)step / 2) + 0x8000UL) >> 16));
+  }
+}
+
+// Closed-form P' = Fx P Fx^T + Fu Q Fu^T for the midpoint model
+//   Fx = [1 0 a; 0 1 b; 0 0 1],  a = -d sin(phi), b = d cos(phi)
+//   Fu columns (d/d dl, d/d dr) = (c/2 + e s, s/2 - e c, -1/W), (c/2 - e s, s/2 + e c, 1/W),  e = d / (2W)
+void Odometry::propagate_covariance(float delta_l, float delta_r, uint16_t angle) {
+  float c = cos_q15(angle) * (1.0f / 32768.0f);
+  float s = sin_q15(angle) * (1.0f / 32768.0f);
+  float d = 0.5f * (delta_l + delta_r);
+  float a = -d * s;
+  float b = d * c;
+
+  PoseCovariance &p = _covariance;
+  float tt = p.thetatheta;
+  float xt = p.xtheta + a * tt;
+  float yt = p.ytheta + b * tt;
+  p.xx += a * (p.xtheta + xt);
+  p.xy += a * p.ytheta + b * xt;
+  p.yy += b * (p.ytheta + yt);
+  p.xtheta = xt;
+  p.ytheta = yt;
+
+  float e = d / (2.0f * _w);
+  float inverse_w = 1.0f / _w;
+  float ql = _wheel_variance_l * fabs(delta_l);
+  float qr = _wheel_variance_r * fabs(delta_r);
+  float lx = 0.5f * c + e * s;
+  float ly = 0.5f * s - e * c;
+  float rx = 0.5f * c - e * s;
+  float ry = 0.5f * s + e * c;
+
+  p.xx += ql * lx * lx + qr * rx * rx;
+  p.xy += ql * lx * ly + qr * rx * ry;
+  p.xtheta += (qr * rx - ql * lx) * inverse_w;
+  p.yy += ql * ly * ly + qr * ry * ry;
+  p.ytheta += (qr * ry - ql * ly) * inverse_w;
+  p.thetatheta += (ql + qr) * inverse_w * inverse_w;
+}
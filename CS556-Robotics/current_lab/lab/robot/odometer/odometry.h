@@ -2,7 +2,10 @@
 #define Odometry_h
 
 #include <Pololu3piPlus32U4.h>
-#include <Pololu3piPlus32U4IMU.h>
+#include <stdint.h>
+#include "pose_integration.h"
+
+using namespace Pololu3piPlus32U4;
 
 // Mechanical constants for odometry calculations
 constexpr float DIA_L = 3.2f;
@@ -11,30 +14,129 @@ constexpr int N_L = 12;
 constexpr int N_R = 12;
 constexpr float W = 9.6f;
 constexpr int GEAR_RATIO = 75;
-constexpr bool DEAD_RECKONING = false;
+
+// Arithmetic used by update_odom()
+//   FLOAT: float pose, libm sin/cos (reference)
+//   FIXED: Q16.16 pose in cm, binary-angle heading, table sin/cos - no float math per update
+//          unless covariance propagation is enabled
+enum class OdometryMode {
+  FLOAT,
+  FIXED
+};
+constexpr OdometryMode DEFAULT_ODOMETRY_MODE = OdometryMode::FLOAT;
+
+// Wheel geometry the odometry runs with: the nominal constants above until a
+// calibration (see odometry_calibration.h) replaces them at run time
+struct OdometryGeometry {
+  float diameter_left_cm;
+  float diameter_right_cm;
+  float wheelbase_cm;
+};
+constexpr OdometryGeometry NOMINAL_ODOMETRY_GEOMETRY = {DIA_L, DIA_R, W};
+
+// Pose uncertainty model (per-wheel, Chong & Kleeman style)
+//   Each wheel's travel error is zero-mean with variance k * |travel|, so it
+//   grows with distance driven, not with time or update count. Once enabled
+//   with set_covariance_enabled(), every update propagates the 3x3 covariance
+//   P through the motion Jacobians:
+//     P' = Fx P Fx^T + Fu diag(k_l |dl|, k_r |dr|) Fu^T
+//   P is symmetric, so only its six distinct entries are kept, and the update
+//   is written out in closed form: fixed cost, no matrix loops, table sin/cos.
+//   It is float math in both kernels, so it is off unless asked for.
+constexpr float DEFAULT_WHEEL_VARIANCE_CM = 0.0004f;  // k [cm^2 per cm of wheel travel] (~0.2 cm sigma per metre)
+constexpr bool DEFAULT_COVARIANCE_ENABLED = false;
+
+// Symmetric 3x3 pose covariance, x/y in cm, theta in rad
+struct PoseCovariance {
+  float xx;
+  float xy;
+  float xtheta;
+  float yy;
+  float ytheta;
+  float thetatheta;
+};
 
 class Odometry {
 public:
   Odometry();
 
-  void update_odom(int left_counts, int right_counts, float &x, float &y, float &theta);
-  void update_odom_imu(int left_counts, int right_counts, float &x, float &y, float &theta);
+  void update_odom(int32_t left_counts, int32_t right_counts, float &x, float &y, float &theta);
+  // Same as update_odom(), but the heading comes from outside (e.g. HeadingEstimator);
+  // the encoders only provide the distance. Runs on the kernel set_mode() selected.
+  void update_odom_heading(int32_t left_counts, int32_t right_counts, float heading, float &x, float &y, float &theta);
+
+  // Select the arithmetic of update_odom(); the pose to continue from seeds the new kernel
+  void set_mode(OdometryMode mode, float x, float y, float theta);
+  OdometryMode get_mode() const;
+
+  // Select how each step is projected onto the pose (both kernels)
+  void set_integration(OdometryIntegration integration);
+  OdometryIntegration get_integration() const;
+
+  // Pose covariance, propagated by every update (all kernels) while enabled;
+  // it holds its value while disabled
+  void set_covariance_enabled(bool enabled);
+  bool is_covariance_enabled() const;
+  const PoseCovariance& get_covariance() const;
+  void reset_covariance();
+  // Per-wheel error model: variance per cm of travel [cm]
+  void set_wheel_variance(float left_cm, float right_cm);
+
+  // Wheel diameters and wheelbase used by every kernel; returns false (keeping
+  // the current geometry) if a value is not positive
+  bool set_geometry(const OdometryGeometry &geometry);
+  const OdometryGeometry& get_geometry() const;
 
 private:
+  // One covariance step for wheel travels dl, dr [cm] at mid-step heading angle (65536 = one turn)
+  void propagate_covariance(float delta_l, float delta_r, uint16_t angle);
+
+  // Integer kernel: same model as the float path, pose kept in fixed point
+  void update_odom_fixed(int32_t left_counts, int32_t right_counts, float &x, float &y, float &theta);
+  void update_odom_heading_fixed(int32_t left_counts, int32_t right_counts, float heading, float &x, float &y, float &theta);
+  // Integrate the counts since the last update in parts of at most 16-bit counts and a
+  // quarter turn; rotation (binary angle, 2^32 = one turn) replaces the encoder heading
+  // if external_heading
+  void integrate_fixed(int32_t left_counts, int32_t right_counts, bool external_heading, int64_t rotation);
+  // One integer step turning by step (binary angle); the scale factors assume |delta| fits in 16 bits
+  void step_odom_fixed(int16_t delta_l, int16_t delta_r, uint32_t step);
+  void get_fixed_pose(float &x, float &y, float &theta) const;
+  void set_fixed_heading(float theta);
+
+  OdometryGeometry _geometry;
   float _diaL;
   float _diaR;
   float _w;
   int _nL;
   int _nR;
   int _gearRatio;
-  bool _deadreckoning;
   double _x;
   double _y;
   double _theta;
-  int _left_encoder_counts_prev;
-  int _right_encoder_counts_prev;
-  IMU _imu;
-  float _IMUavg_error;
+  int32_t _left_encoder_counts_prev;
+  int32_t _right_encoder_counts_prev;
+
+  OdometryMode _mode;
+  OdometryIntegration _integration;
+  int32_t _x_fixed;     // Q16.16 [cm]
+  int32_t _y_fixed;     // Q16.16 [cm]
+  uint32_t _heading;    // Binary angle, wraps every turn
+  int16_t _turns;       // Whole turns, so theta stays unwrapped like the float path
+
+  // Per-count scale factors, recomputed by set_geometry()
+  //   Distance: half the wheel travel, Q16.16 cm with 6 extra fraction bits (>> 6 after summing)
+  //   Heading:  rotation from one wheel, binary angle (2^32 = one turn)
+  int32_t _half_travel_l;
+  int32_t _half_travel_r;
+  uint32_t _heading_per_count_l;
+  uint32_t _heading_per_count_r;
+  float _cm_per_count_l;
+  float _cm_per_count_r;
+
+  PoseCovariance _covariance;
+  bool _covariance_enabled;
+  float _wheel_variance_l;
+  float _wheel_variance_r;
 
 };
 
@@ -0,0 +1,167 @@
+#include "odometry_calibration.h"
+#include <EEPROM.h>
+#include <math.h>
+#include <stddef.h>
+#include "../utils/eeprom_layout.h"
+#include "../utils/logger.h"
+#include "../utils/util.h"
+
+#undef CLASS_NAME
+#define CLASS_NAME "OdometryCalibration"
+
+OdometryCalibration::OdometryCalibration() {
+  record.magic = 0;
+  record.version = 0;
+  record.geometry = NOMINAL_ODOMETRY_GEOMETRY;
+  record.checksum = 0;
+  valid = false;
+  turn_error_rad = 0.0f;
+  leg_error_rad = 0.0f;
+  clear_runs();
+}
+
+// ========== RUNS ==========
+
+void OdometryCalibration::clear_runs() {
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    error_sum_x[dir] = 0.0f;
+    error_sum_y[dir] = 0.0f;
+    runs[dir] = 0;
+  }
+}
+
+void OdometryCalibration::add_run(UmbmarkDirection direction, float error_x_cm, float error_y_cm) {
+  uint8_t dir = (uint8_t)direction;
+  error_sum_x[dir] += error_x_cm;
+  error_sum_y[dir] += error_y_cm;
+  runs[dir]++;
+}
+
+uint8_t OdometryCalibration::get_run_count(UmbmarkDirection direction) const {
+  return runs[(uint8_t)direction];
+}
+
+// ========== SOLVE ==========
+
+bool OdometryCalibration::solve(const OdometryGeometry &current, float side_cm) {
+  uint8_t cw = (uint8_t)UmbmarkDirection::CLOCKWISE;
+  uint8_t ccw = (uint8_t)UmbmarkDirection::COUNTER_CLOCKWISE;
+  if (runs[cw] == 0 || runs[ccw] == 0 || side_cm <= 0.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Need runs in both directions");
+    return false;
+  }
+
+  // Centre of gravity of the closing errors in each direction.
+  float x_cw = error_sum_x[cw] / runs[cw];
+  float y_cw = error_sum_y[cw] / runs[cw];
+  float x_ccw = error_sum_x[ccw] / runs[ccw];
+  float y_ccw = error_sum_y[ccw] / runs[ccw];
+
+  float alpha = ((x_cw + x_ccw) + (y_cw - y_ccw)) / (8.0f * side_cm);
+  float beta = ((x_ccw - x_cw) - (y_cw + y_ccw)) / (8.0f * side_cm);
+  if (fabs(alpha) > UMBMARK_MAX_ANGLE_RAD || fabs(beta) > UMBMARK_MAX_ANGLE_RAD) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Closing errors too large, check the measurements");
+    return false;
+  }
+
+  const float half_pi = 0.5f * 3.14159265f;
+  float wheelbase = current.wheelbase_cm * half_pi / (half_pi + alpha);
+
+  // E_d = (R + W/2) / (R - W/2) with R = (L/2) / sin(β/2), rearranged to stay finite as β -> 0.
+  float s = sinf(0.5f * beta);
+  float half_track = 0.5f * wheelbase;
+  float diameter_ratio = (0.5f * side_cm + half_track * s) / (0.5f * side_cm - half_track * s);
+  diameter_ratio *= current.diameter_right_cm / current.diameter_left_cm;
+
+  if (fabs(wheelbase / NOMINAL_ODOMETRY_GEOMETRY.wheelbase_cm - 1.0f) > UMBMARK_MAX_CORRECTION ||
+      fabs(diameter_ratio - 1.0f) > UMBMARK_MAX_CORRECTION) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Correction out of range, keeping the old geometry");
+    return false;
+  }
+
+  // Keep the mean diameter: it sets the distance scale, which UMBmark does not measure.
+  float mean_diameter = 0.5f * (current.diameter_left_cm + current.diameter_right_cm);
+  record.geometry.diameter_left_cm = 2.0f * mean_diameter / (diameter_ratio + 1.0f);
+  record.geometry.diameter_right_cm = diameter_ratio * record.geometry.diameter_left_cm;
+  record.geometry.wheelbase_cm = wheelbase;
+  record.magic = ODOMETRY_CALIBRATION_MAGIC;
+  record.version = ODOMETRY_CALIBRATION_VERSION;
+  record.checksum = record_checksum(record);
+  valid = true;
+
+  turn_error_rad = alpha;
+  leg_error_rad = beta;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration solved");
+  return true;
+}
+
+float OdometryCalibration::get_turn_error_rad() const {
+  return turn_error_rad;
+}
+
+float OdometryCalibration::get_leg_error_rad() const {
+  return leg_error_rad;
+}
+
+// ========== STORAGE ==========
+
+bool OdometryCalibration::load() {
+  OdometryCalibrationRecord stored;
+  EEPROM.get(EEPROM_ODOMETRY_CALIBRATION_ADDR, stored);
+
+  if (stored.magic != ODOMETRY_CALIBRATION_MAGIC || stored.version != ODOMETRY_CALIBRATION_VERSION) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "No calibration stored, using nominal geometry");
+    return false;
+  }
+  if (stored.checksum != record_checksum(stored)) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Calibration checksum mismatch, ignoring stored geometry");
+    return false;
+  }
+
+  record = stored;
+  valid = true;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration loaded from EEPROM");
+  return true;
+}
+
+bool OdometryCalibration::save() {
+  if (!valid) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "No calibration to save");
+    return false;
+  }
+
+  EEPROM.put(EEPROM_ODOMETRY_CALIBRATION_ADDR, record);
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Calibration saved to EEPROM");
+  return true;
+}
+
+bool OdometryCalibration::is_valid() const {
+  return valid;
+}
+
+const OdometryGeometry& OdometryCalibration::get_geometry() const {
+  return record.geometry;
+}
+
+void OdometryCalibration::log_calibration() const {
+  if (!valid) {
+    Logger::log_info(CLASS_NAME, __FUNCTION__, "No calibration");
+    return;
+  }
+
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("D_L=" + String(record.geometry.diameter_left_cm, 4) + " cm, D_R=" +
+                                              String(record.geometry.diameter_right_cm, 4) + " cm, W=" +
+                                              String(record.geometry.wheelbase_cm, 3) + " cm").c_str());
+  if (runs[0] == 0 || runs[1] == 0) {
+    return;
+  }
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("alpha=" + String(radians_to_degrees(turn_error_rad), 3) +
+                                              " deg/turn, beta=" + String(radians_to_degrees(leg_error_rad), 3) +
+                                              " deg/leg").c_str());
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+uint16_t OdometryCalibration::record_checksum(const OdometryCalibrationRecord &record) {
+  return calculate_checksum((const uint8_t *)&record, offsetof(OdometryCalibrationRecord, checksum));
+}
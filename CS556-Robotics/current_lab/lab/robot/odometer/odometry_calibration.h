@@ -0,0 +1,150 @@
+#ifndef odometry_calibration_h
+#define odometry_calibration_h
+
+#include <stdint.h>
+#include "odometry.h"
+
+// ============================================================
+// UMBMARK ODOMETRY CALIBRATION
+// ============================================================
+//
+// Purpose: Correct the two dominant systematic odometry errors, unequal wheel
+//   diameters and the wrong effective wheelbase, from square test runs
+//
+// Description (Borenstein & Feng, UMBmark):
+//   The robot drives the same L x L square clockwise and counterclockwise and
+//   the closing error of each run is recorded: where the robot really stopped
+//   minus where the odometry says it stopped, in the start frame (x along the
+//   start heading, y to its left). The two error types add up differently in
+//   the two directions, so they can be told apart:
+//     - Wheelbase: every turn is off by α; the errors of both directions agree in x
+//     - Diameters: every straight leg curves by β; the x errors have opposite signs
+//   To first order, with run averages (x_cw, y_cw) and (x_ccw, y_ccw):
+//     α = ((x_cw + x_ccw) + (y_cw - y_ccw)) / 8L
+//     β = ((x_ccw - x_cw) - (y_cw + y_ccw)) / 8L
+//
+// Corrections (relative to the geometry the runs were made with):
+//   - Wheelbase: the robot really turned 90° + α while odometry saw 90°,
+//     so W' = W * (π/2) / (π/2 + α)
+//   - Diameter ratio: a leg curving by β is an arc of radius R = (L/2) / sin(β/2),
+//     so D_R / D_L grows by E_d = (R + W/2) / (R - W/2); the mean diameter (the
+//     distance scale) is kept
+//
+// Usage:
+//   1. Drive UMBMARK_RUNS squares each way; after each, add_run() with the
+//      measured closing error
+//   2. solve() with the geometry the runs used and the side length
+//   3. save() to EEPROM; Navigator::configure() loads it at boot
+//
+// Storage: EEPROM_ODOMETRY_CALIBRATION_ADDR, magic number, version and checksum
+//   like the motor calibration
+//
+// ============================================================
+
+enum class UmbmarkDirection {
+  CLOCKWISE,
+  COUNTER_CLOCKWISE
+};
+
+const uint8_t UMBMARK_RUNS = 5;                         // Recommended runs per direction
+const float UMBMARK_SIDE_M = 1.0f;                      // Default square side
+const float UMBMARK_MAX_ANGLE_RAD = 0.35f;              // Larger α or β (~20°) means a bad measurement
+const float UMBMARK_MAX_CORRECTION = 0.2f;              // Reject geometry changes beyond +-20 %
+const uint16_t ODOMETRY_CALIBRATION_MAGIC = 0x4F43;     // "OC"
+const uint8_t ODOMETRY_CALIBRATION_VERSION = 1;
+
+// Persistent form of the calibration, stored as-is in EEPROM
+struct OdometryCalibrationRecord {
+  uint16_t magic;
+  uint8_t version;
+  OdometryGeometry geometry;
+  uint16_t checksum;                                    // calculate_checksum() of everything above
+};
+
+class OdometryCalibration {
+  public:
+    // Purpose: Initialize an empty (invalid) calibration with no runs
+    // Args: None
+    // Return: void
+    OdometryCalibration();
+
+    // ========== RUNS ==========
+
+    // Purpose: Forget all recorded runs
+    // Args: None
+    // Return: void
+    void clear_runs();
+
+    // Purpose: Record the closing error of one square
+    // Args: direction - direction the square was driven
+    //       error_x_cm, error_y_cm - true end position minus odometry end position,
+    //                                in the start frame [cm]
+    // Return: void
+    void add_run(UmbmarkDirection direction, float error_x_cm, float error_y_cm);
+
+    // Purpose: Number of runs recorded in one direction
+    // Args: direction
+    // Return: uint8_t
+    uint8_t get_run_count(UmbmarkDirection direction) const;
+
+    // ========== SOLVE ==========
+
+    // Purpose: Compute the corrected geometry from the recorded runs
+    // Args: current - geometry the odometry used during the runs
+    //       side_cm - side length of the squares [cm]
+    // Return: bool - false (calibration unchanged) without runs in both
+    //         directions or if the errors are implausibly large
+    bool solve(const OdometryGeometry &current, float side_cm);
+
+    // Purpose: Turn error α of the last solve()
+    // Args: None
+    // Return: float - extra rotation per 90° turn [rad]
+    float get_turn_error_rad() const;
+
+    // Purpose: Straight-leg curvature error β of the last solve()
+    // Args: None
+    // Return: float - heading change per leg, counterclockwise positive [rad]
+    float get_leg_error_rad() const;
+
+    // ========== STORAGE ==========
+
+    // Purpose: Load the calibration from EEPROM
+    // Args: None
+    // Return: bool - false if no valid record is stored
+    bool load();
+
+    // Purpose: Save the calibration to EEPROM
+    // Args: None
+    // Return: bool - false if there is no valid calibration to save
+    bool save();
+
+    // Purpose: Check whether a calibration is loaded or solved
+    // Args: None
+    // Return: bool
+    bool is_valid() const;
+
+    // Purpose: Get the calibrated geometry
+    // Args: None
+    // Return: const OdometryGeometry& - nominal geometry while not valid
+    const OdometryGeometry& get_geometry() const;
+
+    // Purpose: Log the geometry and the errors it was solved from
+    // Args: None
+    // Return: void
+    void log_calibration() const;
+
+  private:
+    // Purpose: Checksum of a record, excluding the checksum field itself
+    static uint16_t record_checksum(const OdometryCalibrationRecord &record);
+
+    OdometryCalibrationRecord record;   // Geometry and header, identical to the EEPROM copy
+    bool valid;                         // true if record holds a calibration
+
+    float error_sum_x[2];               // Closing error sums per direction [cm]
+    float error_sum_y[2];
+    uint8_t runs[2];                    // Runs per direction
+    float turn_error_rad;               // α of the last solve()
+    float leg_error_rad;                // β of the last solve()
+};
+
+#endif
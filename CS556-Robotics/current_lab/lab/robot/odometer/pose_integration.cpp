@@ -0,0 +1,34 @@
+#include "pose_integration.h"
+
+#include <math.h>
+
+void integrate_pose_step(OdometryIntegration scheme, float theta, float distance, float rotation, float &dx, float &dy) {
+  float heading;
+  float length = distance;
+
+  switch (scheme) {
+    case OdometryIntegration::EULER:
+      heading = theta + rotation;
+      break;
+    case OdometryIntegration::MIDPOINT:
+      heading = theta + 0.5f * rotation;
+      break;
+    case OdometryIntegration::EXACT_ARC:
+    default:
+      heading = theta + 0.5f * rotation;
+      length = distance * arc_chord_factor(rotation);
+      break;
+  }
+
+  dx = length * cosf(heading);
+  dy = length * sinf(heading);
+}
+
+float arc_chord_factor(float rotation) {
+  float half = 0.5f * rotation;
+  if (fabsf(rotation) < POSE_ARC_MIN_ROTATION_RAD) {
+    // Series of sin(h)/h; the h^2 term keeps it continuous with the exact form.
+    return 1.0f - half * half / 6.0f;
+  }
+  return sinf(half) / half;
+}
@@ -0,0 +1,56 @@
+#ifndef pose_integration_h
+#define pose_integration_h
+
+// ============================================================
+// POSE INTEGRATION SCHEMES
+// ============================================================
+//
+// Purpose: Turn one pair of wheel travels into a pose increment
+//
+// Description:
+//   Between two odometry updates the robot moves distance d = (dl + dr) / 2
+//   while turning by dθ = (dr - dl) / W. With constant wheel speeds over the
+//   step the path is a circular arc; the schemes differ in how they project d:
+//
+//   - EULER:     heading after the step        dx = d cos(θ + dθ)
+//   - MIDPOINT:  heading halfway through       dx = d cos(θ + dθ/2)
+//   - EXACT_ARC: chord of the arc              dx = c cos(θ + dθ/2),
+//                c = d sin(dθ/2) / (dθ/2)      (c = d for a straight step)
+//
+//   EULER is first order: its error grows with the square of the step, so it
+//   needs frequent updates. MIDPOINT is second order. EXACT_ARC has no
+//   integration error at all for a constant-curvature step, so a whole arc can
+//   be integrated in one update; only changes of curvature within a step
+//   remain as error.
+//
+// Pure functions with no hardware dependencies, so the host comparison
+// harness (tools/odometry_harness) runs exactly the code the robot runs.
+//
+// ============================================================
+
+enum class OdometryIntegration {
+  EULER,
+  MIDPOINT,
+  EXACT_ARC
+};
+
+constexpr OdometryIntegration DEFAULT_ODOMETRY_INTEGRATION = OdometryIntegration::EXACT_ARC;
+
+// Below this step rotation [rad] the chord factor is 1 to float precision
+constexpr float POSE_ARC_MIN_ROTATION_RAD = 1.0e-3f;
+
+// Purpose: Position increment of one odometry step
+// Args: scheme - EULER, MIDPOINT or EXACT_ARC
+//       theta - heading at the start of the step [rad]
+//       distance - travel of the wheelbase centre (dl + dr) / 2 [any length unit]
+//       rotation - heading change over the step (dr - dl) / W [rad]
+//       dx, dy - outputs, in the unit of distance
+// Return: void (the caller adds rotation to theta)
+void integrate_pose_step(OdometryIntegration scheme, float theta, float distance, float rotation, float &dx, float &dy);
+
+// Purpose: Ratio of chord to arc length for an arc turning by rotation
+// Args: rotation - heading change along the arc [rad]
+// Return: float - sin(rotation / 2) / (rotation / 2), 1 for a straight line
+float arc_chord_factor(float rotation);
+
+#endif
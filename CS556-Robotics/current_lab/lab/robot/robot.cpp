@@ -12,6 +12,7 @@ Robot::Robot() {
 
   drive = new DifferentialDrive();
   navigator = new Navigator();
+  follower = new PathFollower(drive, navigator);
   sonar = new Sonar();
   servo = new ServoController();
   display = new Display();
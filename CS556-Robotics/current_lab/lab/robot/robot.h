@@ -5,6 +5,7 @@
 #include "actuators/servo_controller.h"
 #include "display/display.h"
 #include "navigator/navigator.h"
+#include "navigator/path_follower.h"
 #include "display/display.h"
 
 // ============================================================
@@ -16,9 +17,15 @@
 // Architecture:
 //   - DifferentialDrive (public 'drive' member): Complete motor and motion control
 //     - Low-level control: Direct wheel speed commands - set_wheel_speeds(left, right)
+//     - Velocity control: Per-wheel encoder PI loop tracking true mm/s targets
+//     - Motor calibration: Battery-compensated speed-to-PWM table in EEPROM
+//     - Velocity profiles: Trapezoidal / S-curve ramps on every motion primitive
 //     - Basic motion: Simple directional commands without distance/speed parameters
 //     - High-level motion: Distance-based movement with speed control
 //     - Curved motion: Combined forward/backward movement with simultaneous turning
+//     - Non-blocking motion: start_*() / poll() / cancel() with per-tick CPU stats
+//     - Twist interface: command_twist(v, omega) with curvature-preserving saturation
+//     - Segment queue: queue_line/arc/turn() + start_queue(), run without stopping
 //     - Configuration: Setup functions for motor flipping and turn speed ratios
 //     - Stop: halt()
 //   
@@ -33,12 +40,16 @@
 //     - Sweep functions: Automated scanning patterns
 //     - Configuration: Pin assignment, speed control
 //
+//   - PathFollower (public 'follower' member): Pure-pursuit waypoint following
+//     - Steers from the Navigator pose through drive->command_twist()
+//     - Fixed waypoint buffer, adaptive look-ahead, slows down for the goal
+//
 //   - Display (public 'display' member): OLED display helpers
 //     - Encoder printing
 //     - Pose (odometry) printing
 //   
 //   - Robot: Robot initialization with configuration
-//     - Constructors initialize all subsystems (drive, navigator, sonar, servo, display)
+//     - Constructors initialize all subsystems (drive, navigator, follower, sonar, servo, display)
 //     - Exposes public members for all subsystem access
 //
 // Usage:
@@ -62,6 +73,7 @@ class Robot {
     // Public subsystem abstractions
     DifferentialDrive* drive;   // Drivetrain control
     Navigator* navigator;        // Encoders + odometry pose tracking
+    PathFollower* follower;      // Waypoint following on top of drive + navigator
     Sonar* sonar;               // Distance sensor
     ServoController* servo;     // Servo actuator
     Display* display;           // OLED display helper
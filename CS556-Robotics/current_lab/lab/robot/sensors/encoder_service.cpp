@@ -0,0 +1,97 @@
+#include "encoder_service.h"
+
+#include <Pololu3piPlus32U4.h>
+
+#include "../utils/control_timer.h"
+#include "../utils/logger.h"
+
+using namespace Pololu3piPlus32U4;
+
+#undef CLASS_NAME
+#define CLASS_NAME "EncoderService"
+
+volatile bool EncoderService::registered = false;
+volatile bool EncoderService::has_baseline = false;
+volatile int16_t EncoderService::last_raw_left = 0;
+volatile int16_t EncoderService::last_raw_right = 0;
+EncoderSnapshot EncoderService::latest = {0, 0, 0, 0, 0, 0, VelocityMethod::STOPPED, VelocityMethod::STOPPED};
+WheelVelocity EncoderService::left_velocity;
+WheelVelocity EncoderService::right_velocity;
+
+// ========== CONTROL ==========
+
+bool EncoderService::begin() {
+  if (registered) {
+    return true;
+  }
+  Encoders::init();
+  if (!ControlTimer::add_callback(sample)) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "No tick slot, polling the encoders");
+    return false;
+  }
+  registered = true;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Sampling on the control tick");
+  return true;
+}
+
+void EncoderService::end() {
+  if (registered) {
+    ControlTimer::remove_callback(sample);
+    registered = false;
+  }
+}
+
+bool EncoderService::is_timed() {
+  return registered && ControlTimer::is_running();
+}
+
+// ========== SAMPLES ==========
+
+void EncoderService::snapshot(EncoderSnapshot &copy) {
+  if (!is_timed()) {
+    // The Pololu getters re-enable interrupts, so read before disabling them.
+    unsigned long now_us = micros();
+    int16_t raw_left = Encoders::getCountsLeft();
+    int16_t raw_right = Encoders::getCountsRight();
+    noInterrupts();
+    accumulate(raw_left, raw_right, now_us);
+    interrupts();
+  }
+
+  noInterrupts();
+  copy = latest;
+  interrupts();
+}
+
+void EncoderService::sample() {
+  int16_t raw_left;
+  int16_t raw_right;
+  unsigned long stamp_us;
+  ControlTimer::get_encoder_sample(raw_left, raw_right, stamp_us);
+
+  noInterrupts();
+  accumulate(raw_left, raw_right, stamp_us);
+  interrupts();
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+void EncoderService::accumulate(int16_t raw_left, int16_t raw_right, unsigned long stamp_us) {
+  if (has_baseline) {
+    // int16_t subtraction wraps correctly across counter rollover.
+    latest.left += (int16_t)(raw_left - last_raw_left);
+    latest.right += (int16_t)(raw_right - last_raw_right);
+  }
+  has_baseline = true;
+  last_raw_left = raw_left;
+  last_raw_right = raw_right;
+  latest.stamp_us = stamp_us;
+  latest.sequence++;
+
+  left_velocity.update(latest.left, stamp_us);
+  right_velocity.update(latest.right, stamp_us);
+  latest.left_velocity = left_velocity.get_velocity_q4();
+  latest.right_velocity = right_velocity.get_velocity_q4();
+  latest.left_method = left_velocity.get_method();
+  latest.right_method = right_velocity.get_method();
+}
@@ -0,0 +1,100 @@
+#ifndef encoder_service_h
+#define encoder_service_h
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "wheel_velocity.h"
+
+// ============================================================
+// WIDE ENCODER ACCUMULATION
+// ============================================================
+//
+// Purpose: Keep wheel positions that cannot overflow on a long run, each
+//   sample stamped with the time it was taken
+//
+// Description:
+//   The Pololu encoder counters are 16-bit and wrap after 32767 counts, about
+//   3.6 m of travel at ~9000 counts per metre, and int is 16-bit on AVR as well.
+//   The service keeps its own 32-bit totals (+-240 km) and adds the int16_t
+//   difference between consecutive raw readings, which is wrap-safe as long as
+//   fewer than 32768 counts pass between two samples.
+//
+// Sampling:
+//   - Timed: begin() registers sample() with ControlTimer, so while the tick
+//     runs every sample uses the counts and micros() the tick latched, at
+//     evenly spaced instants
+//   - Polled: while the tick is not running, snapshot() samples the counters
+//     itself, so callers work the same with or without ControlTimer
+//
+// Reading: snapshot() copies totals, stamp and sequence number with interrupts
+//   disabled, so a tick landing mid-read can never mix two samples. The
+//   sequence number changes with every sample; a caller that sees the same
+//   value twice has no new data.
+//
+// Velocity: every sample also feeds a WheelVelocity per wheel, so the
+//   snapshot carries wheel speeds estimated from every tick, not only from
+//   the samples a caller happens to read.
+//
+// Ordering: call begin() before registering callbacks that read the service,
+//   so the sample of a tick is taken before they run.
+//
+// ============================================================
+
+// One consistent encoder sample
+struct EncoderSnapshot {
+  int32_t left;              // Total left counts since the first sample
+  int32_t right;             // Total right counts since the first sample
+  unsigned long stamp_us;    // micros() when the counters were read
+  uint32_t sequence;         // Incremented by every sample
+  int32_t left_velocity;     // Left wheel speed [counts/s, Q4], see WheelVelocity
+  int32_t right_velocity;    // Right wheel speed [counts/s, Q4]
+  VelocityMethod left_method;
+  VelocityMethod right_method;
+};
+
+class EncoderService {
+  public:
+    // Purpose: Sample on the ControlTimer tick whenever it runs
+    // Args: None
+    // Return: bool - false if the callback could not be registered (polling still works)
+    static bool begin();
+
+    // Purpose: Stop sampling on the tick (snapshot() falls back to polling)
+    // Args: None
+    // Return: void
+    static void end();
+
+    // Purpose: Check whether samples currently come from the ControlTimer tick
+    // Args: None
+    // Return: bool
+    static bool is_timed();
+
+    // Purpose: Copy the latest sample; samples the counters first when not timed
+    // Args: snapshot - destination
+    // Return: void
+    static void snapshot(EncoderSnapshot &snapshot);
+
+    // Purpose: ControlTimer callback; folds the counts latched by the tick into the totals
+    // Args: None
+    // Return: void
+    static void sample();
+
+  private:
+    // Purpose: Add the difference from the previous raw reading to the totals
+    // Args: raw_left, raw_right - 16-bit counter values
+    //       stamp_us - micros() when they were read
+    // Return: void
+    // Note: call with interrupts disabled
+    static void accumulate(int16_t raw_left, int16_t raw_right, unsigned long stamp_us);
+
+    static volatile bool registered;
+    static volatile bool has_baseline;        // false until the first reading
+    static volatile int16_t last_raw_left;
+    static volatile int16_t last_raw_right;
+    static EncoderSnapshot latest;            // Only touched with interrupts disabled
+    static WheelVelocity left_velocity;
+    static WheelVelocity right_velocity;
+};
+
+#endif
@@ -5,11 +5,29 @@
 #undef CLASS_NAME
 #define CLASS_NAME "Sonar"
 
+Sonar* volatile Sonar::echo_owner = nullptr;
+volatile bool Sonar::echo_armed = false;
+volatile bool Sonar::echo_rising_seen = false;
+volatile bool Sonar::echo_complete = false;
+volatile uint16_t Sonar::echo_sequence = 0;
+volatile uint16_t Sonar::echo_rise_sequence = 0;
+volatile unsigned long Sonar::echo_rise_us = 0;
+volatile unsigned long Sonar::echo_fall_us = 0;
+
 Sonar::Sonar() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Initialized");
   pin = DEFAULT_SONAR_PIN;
   timeout_us = DEFAULT_TIMEOUT_US;
   num_samples = DEFAULT_NUM_SAMPLES;
+  ping_state = SonarPingState::IDLE;
+  last_echo = {0, 0, 0, -1.0f, 0, 0};
+  echo_callback = nullptr;
+  echo_attached = false;
+  ping_interval_us = SONAR_MAX_PING_INTERVAL_US;
+  ping_sequence = 0;
+  ping_held = false;
+  reset_ping_stats();
+  set_speed_of_sound_m_s(SOUND_SPEED_0C_M_S + SOUND_SPEED_PER_C_M_S * DEFAULT_TEMPERATURE_C);
 }
 
 // ========== CONFIGURATION ==========
@@ -26,12 +44,24 @@ void Sonar::configure() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Samples: " + String(DEFAULT_NUM_SAMPLES)).c_str());
   set_num_samples(DEFAULT_NUM_SAMPLES);
   
+  if (!is_async()) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "Pin has no external interrupt, start_ping() will block");
+  }
+  
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Configuration complete");
 }
 
 void Sonar::set_pin(int pin) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Setting pin to " + String(pin)).c_str());
   if (pin >= 0 && pin <= 31) {
+    if (echo_attached) {
+      // The echo interrupt belongs to the old pin.
+      echo_armed = false;
+      detachInterrupt(digitalPinToInterrupt(this->pin));
+      echo_attached = false;
+      echo_owner = nullptr;
+      ping_state = SonarPingState::IDLE;
+    }
     this->pin = pin;
   } else {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid pin number");
@@ -45,6 +75,9 @@ int Sonar::get_pin() {
 void Sonar::set_timeout(unsigned long timeout_us) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Setting timeout to " + String(timeout_us) + " us").c_str());
   this->timeout_us = timeout_us;
+  if (ping_interval_us < min_ping_interval_us()) {
+    ping_interval_us = min_ping_interval_us();
+  }
 }
 
 unsigned long Sonar::get_timeout() {
@@ -53,8 +86,9 @@ unsigned long Sonar::get_timeout() {
 
 void Sonar::set_num_samples(int num_samples) {
   Logger::log_info(CLASS_NAME, __FUNCTION__, ("Setting num_samples to " + String(num_samples)).c_str());
-  if (num_samples >= 1 && num_samples <= 10) {
+  if (num_samples >= 1 && num_samples <= SONAR_FILTER_MAX_WINDOW) {
     this->num_samples = num_samples;
+    filter.set_window(num_samples);
   } else {
     Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid num_samples (must be 1-10)");
   }
@@ -80,41 +114,335 @@ float Sonar::read_distance_cm() {
     return -1.0f;
   }
   
+  filter.add(distance);
   Logger::log_debug(CLASS_NAME, __FUNCTION__, ("Distance: " + String(distance) + " cm").c_str());
   return distance;
 }
 
-float Sonar::read_distance_averaged_cm() {
-  Logger::log_debug(CLASS_NAME, __FUNCTION__, "Reading averaged distance");
+uint16_t Sonar::read_distance_mm() {
+  trigger_measurement();
+  unsigned long duration = read_echo_duration();
   
-  float sum = 0.0f;
-  int valid_count = 0;
+  if (duration == 0) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "Timeout - no echo received");
+    return 0;
+  }
   
-  for (int i = 0; i < num_samples; i++) {
-    float distance = read_distance_cm();
-    if (distance > 0) {
-      sum += distance;
-      valid_count++;
-    }
-    delay(10); // Small delay between samples
+  uint16_t distance_mm = duration_to_distance_mm(duration);
+  if (distance_mm < MIN_VALID_DISTANCE_MM || distance_mm > MAX_VALID_DISTANCE_MM) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, ("Invalid reading: " + String(distance_mm) + " mm").c_str());
+    return 0;
+  }
+  return distance_mm;
+}
+
+uint16_t Sonar::duration_to_distance_mm(unsigned long duration_us) {
+  return (uint16_t)((duration_us * mm_per_us_q16 + 0x8000UL) >> 16);
+}
+
+void Sonar::set_temperature_c(float celsius) {
+  if (celsius < -40.0f || celsius > 60.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid temperature (must be -40 to 60 C)");
+    return;
+  }
+  set_speed_of_sound_m_s(SOUND_SPEED_0C_M_S + SOUND_SPEED_PER_C_M_S * celsius);
+}
+
+void Sonar::set_speed_of_sound_m_s(float speed_m_s) {
+  if (speed_m_s < 300.0f || speed_m_s > 400.0f) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid speed of sound (must be 300-400 m/s)");
+    return;
   }
+  speed_of_sound_m_s = speed_m_s;
+  // Half the round trip: m/s -> cm/us is 1e-4, m/s -> mm/us is 1e-3.
+  cm_per_us = speed_m_s * 0.5e-4f;
+  mm_per_us_q16 = (uint16_t)(speed_m_s * 0.5e-3f * 65536.0f + 0.5f);
+}
+
+float Sonar::get_speed_of_sound_m_s() {
+  return speed_of_sound_m_s;
+}
+
+float Sonar::read_distance_averaged_cm() {
+  Logger::log_debug(CLASS_NAME, __FUNCTION__, "Reading averaged distance");
+  
+  // One new ping; the filter already holds the previous ones.
+  read_distance_cm();
+  float filtered = filter.get_value();
   
-  if (valid_count == 0) {
-    Logger::log_warning(CLASS_NAME, __FUNCTION__, "All samples invalid");
+  if (filtered < 0.0f) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "No valid samples yet");
     return -1.0f;
   }
   
-  float average = sum / valid_count;
-  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Averaged distance: " + String(average) + " cm (from " + String(valid_count) + " samples)").c_str());
-  return average;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Averaged distance: " + String(filtered) + " cm (from " + String(filter.get_count()) + " samples)").c_str());
+  return filtered;
+}
+
+float Sonar::get_filtered_distance_cm() {
+  return filter.get_value();
+}
+
+SonarFilter& Sonar::get_filter() {
+  return filter;
 }
 
 bool Sonar::is_valid_reading(float distance_cm) {
   return (distance_cm >= MIN_VALID_DISTANCE_CM && distance_cm <= MAX_VALID_DISTANCE_CM);
 }
 
+// ========== ASYNCHRONOUS MEASUREMENT ==========
+
+bool Sonar::start_ping() {
+  if (poll_ping() == SonarPingState::WAITING) {
+    return false;
+  }
+  
+  // A sensor still sending the echo of an earlier ping ignores the trigger,
+  // and the end of that echo would be taken for ours.
+  pinMode(pin, INPUT);
+  if (digitalRead(pin) == HIGH) {
+    if (!ping_held) {
+      ping_stats.busy++;
+      ping_held = true;
+    }
+    return false;
+  }
+  ping_held = false;
+  
+  bool async = attach_echo_interrupt();
+  echo_armed = false;
+  unsigned long previous_trigger_us = last_echo.trigger_us;
+  trigger_measurement();
+  last_echo.trigger_us = micros();
+  pinMode(pin, INPUT);
+  ping_sequence++;
+  last_echo.sequence = ping_sequence;
+  
+  noInterrupts();
+  echo_rising_seen = false;
+  echo_complete = false;
+  echo_sequence = ping_sequence;
+  echo_armed = async;
+  interrupts();
+  ping_state = SonarPingState::WAITING;
+  
+  if (ping_stats.pings > 0) {
+    unsigned long interval_us = last_echo.trigger_us - previous_trigger_us;
+    if (interval_us < ping_stats.min_interval_us) {
+      ping_stats.min_interval_us = interval_us;
+    }
+    if (interval_us > ping_stats.max_interval_us) {
+      ping_stats.max_interval_us = interval_us;
+    }
+    ping_stats.elapsed_us += interval_us;
+  }
+  ping_stats.pings++;
+  
+  if (!async) {
+    // No interrupt on this pin: measure now and leave the result for poll_ping().
+    unsigned long duration = pulseInLong(pin, HIGH, timeout_us);
+    unsigned long fall_us = micros();
+    noInterrupts();
+    echo_rise_us = fall_us - duration;
+    echo_rise_sequence = ping_sequence;
+    echo_fall_us = fall_us;
+    echo_complete = duration > 0;
+    interrupts();
+  }
+  return true;
+}
+
+SonarPingState Sonar::poll_ping() {
+  if (ping_state != SonarPingState::WAITING) {
+    return ping_state;
+  }
+  
+  noInterrupts();
+  bool complete = echo_complete;
+  uint16_t sequence = echo_rise_sequence;
+  unsigned long rise_us = echo_rise_us;
+  unsigned long fall_us = echo_fall_us;
+  interrupts();
+  
+  // No echo can rise before the sensor has sent its burst; one that does
+  // was already on its way from an earlier ping.
+  if (complete && (sequence != ping_sequence ||
+                   (long)(rise_us - last_echo.trigger_us) < (long)SONAR_ECHO_START_US)) {
+    // Edges of another ping: drop them and keep listening for ours.
+    ping_stats.stale++;
+    if (echo_attached) {
+      noInterrupts();
+      echo_rising_seen = false;
+      echo_complete = false;
+      echo_sequence = ping_sequence;
+      echo_armed = true;
+      interrupts();
+    }
+    complete = false;
+  }
+  
+  if (complete) {
+    finish_ping(fall_us - rise_us, rise_us);
+  } else if (micros() - last_echo.trigger_us >= timeout_us) {
+    echo_armed = false;
+    finish_ping(0, 0);
+  }
+  return ping_state;
+}
+
+bool Sonar::get_echo(SonarEcho &echo) {
+  echo = last_echo;
+  return ping_state == SonarPingState::DONE && last_echo.distance_cm > 0.0f;
+}
+
+void Sonar::set_echo_callback(SonarEchoCallback callback) {
+  echo_callback = callback;
+}
+
+bool Sonar::is_async() {
+  return digitalPinToInterrupt(pin) != NOT_AN_INTERRUPT;
+}
+
+// ========== PING SCHEDULING ==========
+
+void Sonar::set_expected_range_cm(float range_cm) {
+  unsigned long timeout = range_cm > 0.0f ? (unsigned long)(range_cm * SONAR_US_PER_CM_ROUND_TRIP) + SONAR_ECHO_START_US
+                                          : DEFAULT_TIMEOUT_US;
+  timeout_us = constrain(timeout, SONAR_MIN_TIMEOUT_US, DEFAULT_TIMEOUT_US);
+  if (ping_interval_us < min_ping_interval_us()) {
+    ping_interval_us = min_ping_interval_us();
+  }
+}
+
+void Sonar::set_speed_cm_s(float speed_cm_s) {
+  float speed = fabs(speed_cm_s);
+  unsigned long interval_us = SONAR_MAX_PING_INTERVAL_US;
+  if (speed * SONAR_MAX_PING_INTERVAL_US > SONAR_TRAVEL_PER_PING_CM * 1.0e6f) {
+    interval_us = (unsigned long)(SONAR_TRAVEL_PER_PING_CM * 1.0e6f / speed);
+  }
+  ping_interval_us = constrain(interval_us, min_ping_interval_us(), SONAR_MAX_PING_INTERVAL_US);
+}
+
+unsigned long Sonar::get_ping_interval_us() {
+  return ping_interval_us;
+}
+
+bool Sonar::update() {
+  bool finished = false;
+  if (ping_state == SonarPingState::WAITING) {
+    finished = poll_ping() != SonarPingState::WAITING;
+  }
+  
+  if (ping_state != SonarPingState::WAITING && micros() - last_echo.trigger_us >= ping_interval_us) {
+    // Without an echo interrupt the ping completes inside start_ping().
+    if (start_ping() && !echo_attached) {
+      finished = poll_ping() != SonarPingState::WAITING;
+    }
+  }
+  return finished;
+}
+
+void Sonar::get_ping_stats(SonarPingStats &stats) {
+  stats = ping_stats;
+}
+
+void Sonar::reset_ping_stats() {
+  ping_stats.pings = 0;
+  ping_stats.echoes = 0;
+  ping_stats.timeouts = 0;
+  ping_stats.stale = 0;
+  ping_stats.busy = 0;
+  ping_stats.min_interval_us = 0xFFFFFFFFUL;
+  ping_stats.max_interval_us = 0;
+  ping_stats.elapsed_us = 0;
+}
+
+void Sonar::log_ping_stats() {
+  if (ping_stats.pings < 2 || ping_stats.elapsed_us == 0) {
+    Logger::log_info(CLASS_NAME, __FUNCTION__, ("Pings: " + String(ping_stats.pings)).c_str());
+    return;
+  }
+  
+  float rate_hz = (ping_stats.pings - 1) * 1.0e6f / ping_stats.elapsed_us;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Pings: " + String(ping_stats.pings) + " at " + String(rate_hz, 1) +
+                                              " Hz (interval " + String(ping_stats.min_interval_us) + "-" +
+                                              String(ping_stats.max_interval_us) + " us)").c_str());
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Echoes: " + String(ping_stats.echoes) + ", timeouts: " +
+                                              String(ping_stats.timeouts) + ", stale: " + String(ping_stats.stale) +
+                                              ", busy: " + String(ping_stats.busy)).c_str());
+}
+
 // ========== PRIVATE HELPER FUNCTIONS ==========
 
+void Sonar::echo_isr() {
+  Sonar *owner = echo_owner;
+  if (!echo_armed || owner == nullptr) {
+    return;
+  }
+  
+  unsigned long now_us = micros();
+  if (digitalRead(owner->pin) == HIGH) {
+    echo_rise_us = now_us;
+    echo_rise_sequence = echo_sequence;
+    echo_rising_seen = true;
+  } else if (echo_rising_seen) {
+    echo_fall_us = now_us;
+    echo_complete = true;
+    echo_armed = false;
+  }
+}
+
+bool Sonar::attach_echo_interrupt() {
+  if (echo_attached) {
+    return true;
+  }
+  if (!is_async()) {
+    return false;
+  }
+  
+  Sonar *previous = echo_owner;
+  if (previous != nullptr && previous != this) {
+    Logger::log_warning(CLASS_NAME, __FUNCTION__, "Taking over the echo interrupt from another sonar");
+    echo_armed = false;
+    detachInterrupt(digitalPinToInterrupt(previous->pin));
+    previous->echo_attached = false;
+  }
+  echo_owner = this;
+  attachInterrupt(digitalPinToInterrupt(pin), echo_isr, CHANGE);
+  echo_attached = true;
+  return true;
+}
+
+unsigned long Sonar::min_ping_interval_us() {
+  return timeout_us + SONAR_ECHO_DECAY_US;
+}
+
+void Sonar::finish_ping(unsigned long duration_us, unsigned long rise_us) {
+  last_echo.duration_us = duration_us;
+  last_echo.rise_us = rise_us;
+  
+  if (duration_us == 0) {
+    last_echo.distance_cm = -1.0f;
+    last_echo.distance_mm = 0;
+    ping_state = SonarPingState::TIMEOUT;
+    ping_stats.timeouts++;
+  } else {
+    float distance = duration_to_distance(duration_us);
+    last_echo.distance_cm = is_valid_reading(distance) ? distance : -1.0f;
+    last_echo.distance_mm = last_echo.distance_cm > 0.0f ? duration_to_distance_mm(duration_us) : 0;
+    ping_state = SonarPingState::DONE;
+    filter.add(last_echo.distance_cm);
+    if (last_echo.distance_cm > 0.0f) {
+      ping_stats.echoes++;
+    }
+  }
+  
+  if (echo_callback != nullptr) {
+    echo_callback(last_echo);
+  }
+}
+
 void Sonar::trigger_measurement() {
   Logger::log_debug(CLASS_NAME, __FUNCTION__, "Triggering measurement");
   
@@ -132,14 +460,14 @@ unsigned long Sonar::read_echo_duration() {
   
   // Set pin to input and measure pulse duration
   pinMode(pin, INPUT);
-  unsigned long duration = pulseIn(pin, HIGH, timeout_us);
+  unsigned long duration = pulseInLong(pin, HIGH, timeout_us);
   
   return duration;
 }
 
 float Sonar::duration_to_distance(unsigned long duration_us) {
-  // Speed of sound: ~343 m/s = 0.0343 cm/μs
-  // Distance = (duration / 2) / 29.0 (where 29 ≈ 1/0.0343)
-  float distance_cm = duration_us / 29.0f / 2.0f;
+  // Speed of sound: ~343 m/s = 0.0343 cm/μs (see set_speed_of_sound_m_s())
+  // Distance = duration * (speed / 2)
+  float distance_cm = duration_us * cm_per_us;
   return distance_cm;
 }
@@ -3,6 +3,7 @@
 
 #include <Pololu3piPlus32U4.h>
 #include "../configurable.h"
+#include "sonar_filter.h"
 #include "../utils/logger.h"
 using namespace Pololu3piPlus32U4;
 
@@ -36,6 +37,16 @@ using namespace Pololu3piPlus32U4;
 //   - Round-trip time t = 2 * distance / speed
 //   - Distance (cm) = t / 58 or t / 29 / 2
 //
+// Speed of Sound:
+//   - c = 331.3 + 0.606 * T m/s (T in °C): 337 m/s at 10°C, 349 m/s at 30°C,
+//     so a fixed value is off by ~1.8 % (7 cm at 4 m) across room temperatures
+//   - set_temperature_c() or set_speed_of_sound_m_s() updates the conversion
+//     factor once; both distance paths use it (default 20°C)
+//   - Integer path: distance_mm = (t * k + 2^15) >> 16 with k = c / 2 in mm/μs,
+//     Q16 (~11250); no float and no division per ping. t <= 30 ms keeps the
+//     product in 32 bits.
+//   - Float path: distance_cm = t * (c / 2 in cm/μs), one multiply
+//
 // Accuracy:
 //   - Best accuracy: 10cm to 200cm range
 //   - Resolution: ~0.3cm
@@ -44,6 +55,49 @@ using namespace Pololu3piPlus32U4;
 // This class provides a clean interface to read distance measurements
 // with proper configuration and error handling.
 //
+// Asynchronous Measurement:
+//   read_distance_cm() waits in pulseInLong() for up to the timeout (30 ms).
+//   pulseInLong() times the echo with micros(), so control-tick interrupts
+//   during the wait do not shorten it the way they do pulseIn()'s loop count.
+//   start_ping() instead triggers and returns at once; an interrupt on the
+//   echo pin timestamps both edges of the echo with micros(), and
+//   poll_ping() (called from loop()) reports the result, runs the echo
+//   callback and handles the timeout. The robot keeps driving and
+//   integrating odometry while the sound is in flight.
+//
+//   This needs a pin with an external interrupt (attachInterrupt): on the
+//   32U4 pins 0 and 1 (INT2/INT3, Serial1). Pins 2/3 carry the IMU's I2C,
+//   pin 7 and the PCINT0 vector belong to the encoders, and the default
+//   pin 4 (PD4) has neither INT nor PCINT; its input capture (ICP1) belongs
+//   to Timer1, which drives the motor PWM with ICR1 as TOP. On such pins
+//   start_ping() falls back to a blocking measurement and the echo is ready
+//   when it returns.
+//
+//   Only one Sonar can measure asynchronously at a time (one shared ISR).
+//
+// Filtering:
+//   Every valid range, blocking or asynchronous, also goes through a
+//   SonarFilter (median / Hampel / EMA over the last num_samples pings).
+//   get_filtered_distance_cm() reads its output without pinging, and
+//   read_distance_averaged_cm() is one ping plus that output.
+//
+// Ping Scheduling:
+//   update() keeps pinging in the background. The listening window is sized
+//   for the range of interest, not the sensor's 4 m: 50 cm is ~3.4 ms
+//   instead of 30 ms. The ping interval follows the robot speed so a new
+//   range arrives every SONAR_TRAVEL_PER_PING_CM of travel; the interval
+//   never drops below the listening window plus SONAR_ECHO_DECAY_US, which
+//   lets late echoes from far walls die out, and never exceeds
+//   SONAR_MAX_PING_INTERVAL_US.
+//
+//   Stale echoes: every ping has a sequence number, which the ISR latches on
+//   the rising edge. An echo completes a ping only if it rose while that
+//   ping was armed and no sooner after the trigger than the sensor's burst
+//   (SONAR_ECHO_START_US); an earlier rise is a leftover of another ping,
+//   is counted as stale and the ping keeps listening. A sensor still
+//   holding its echo line high from an earlier ping (its own timeout is
+//   longer than ours) is busy; no trigger is sent until the line is low.
+//
 // ============================================================
 
 // Default configuration constants
@@ -51,7 +105,54 @@ const int DEFAULT_SONAR_PIN = 4;              // GPIO pin for sonar sensor
 const unsigned long DEFAULT_TIMEOUT_US = 30000; // 30ms timeout (~5 meters max range)
 const float MIN_VALID_DISTANCE_CM = 2.0f;     // Minimum measurable distance
 const float MAX_VALID_DISTANCE_CM = 400.0f;   // Maximum measurable distance
-const int DEFAULT_NUM_SAMPLES = 3;            // Number of samples for averaging
+const uint16_t MIN_VALID_DISTANCE_MM = 20;    // Same limits for the integer path
+const uint16_t MAX_VALID_DISTANCE_MM = 4000;
+const float SOUND_SPEED_0C_M_S = 331.3f;      // Speed of sound in dry air at 0°C
+const float SOUND_SPEED_PER_C_M_S = 0.606f;   // Increase per °C
+const float DEFAULT_TEMPERATURE_C = 20.0f;    // Assumed until set_temperature_c()
+const int DEFAULT_NUM_SAMPLES = DEFAULT_SONAR_FILTER_WINDOW;  // Recent pings the filter looks at
+
+// Ping scheduling constants
+const unsigned long SONAR_US_PER_CM_ROUND_TRIP = 58;     // Echo time per cm of range (2 x 29 us)
+const unsigned long SONAR_ECHO_START_US = 500;           // Trigger to echo rise (40 kHz burst)
+const unsigned long SONAR_MIN_TIMEOUT_US = 1000;         // Shortest listening window
+const unsigned long SONAR_ECHO_DECAY_US = 10000;         // Quiet time after listening before the next trigger
+const unsigned long SONAR_MAX_PING_INTERVAL_US = 100000; // Ping at least 10 times per second
+const float SONAR_TRAVEL_PER_PING_CM = 1.0f;             // Target travel between range updates
+const float DEFAULT_EXPECTED_RANGE_CM = 50.0f;           // Range of interest while manoeuvring
+
+// Progress of an asynchronous ping
+enum class SonarPingState : uint8_t {
+  IDLE,                  // No ping started yet
+  WAITING,               // Triggered, echo not complete
+  DONE,                  // Echo measured (see SonarEcho)
+  TIMEOUT                // No complete echo within the timeout
+};
+
+// Result of one asynchronous ping
+struct SonarEcho {
+  unsigned long trigger_us;     // micros() of the trigger pulse
+  unsigned long rise_us;        // micros() of the echo's rising edge
+  unsigned long duration_us;    // Echo pulse length, 0 on timeout
+  float distance_cm;            // Distance, or -1.0 on timeout/invalid reading
+  uint16_t distance_mm;         // Distance from the integer path, 0 on timeout/invalid reading
+  uint16_t sequence;            // Number of the ping this echo belongs to
+};
+
+// Ping rate statistics since the last reset_ping_stats()
+struct SonarPingStats {
+  unsigned long pings;              // Triggers sent
+  unsigned long echoes;             // Pings that returned a valid range
+  unsigned long timeouts;           // Pings without an echo in the listening window
+  unsigned long stale;              // Echoes rejected as leftovers of another ping
+  unsigned long busy;               // Due pings held back while the sensor was still busy
+  unsigned long min_interval_us;    // Shortest trigger-to-trigger interval
+  unsigned long max_interval_us;    // Longest trigger-to-trigger interval
+  unsigned long elapsed_us;         // First to last trigger
+};
+
+// Called from poll_ping() (loop context) when a ping finishes
+typedef void (*SonarEchoCallback)(const SonarEcho &echo);
 
 class Sonar : public Configurable {
   public:
@@ -94,8 +195,9 @@ class Sonar : public Configurable {
     unsigned long get_timeout();
     
     // Purpose: Set number of samples for averaging
-    // Description: More samples = smoother but slower readings
-    // Args: num_samples - number of samples to average (1-10)
+    // Description: Window of the range filter; more samples = smoother but
+    //   slower to follow a change (resets the filter)
+    // Args: num_samples - number of recent pings to filter (1-10)
     // Return: void
     void set_num_samples(int num_samples);
     
@@ -107,23 +209,179 @@ class Sonar : public Configurable {
     // Return: float - distance in centimeters, or -1.0 if error/timeout
     float read_distance_cm();
     
+    // Purpose: Read distance in millimetres without float math
+    // Description: One measurement through the integer conversion; nothing is
+    //   logged unless it fails, and the range filter is not fed
+    // Args: None
+    // Return: uint16_t - distance in millimetres, or 0 if error/timeout
+    uint16_t read_distance_mm();
+    
+    // Purpose: Convert an echo duration to millimetres (integer path)
+    // Description: Multiply by the Q16 speed-of-sound factor and shift
+    // Args: duration_us - echo duration in microseconds (<= DEFAULT_TIMEOUT_US)
+    // Return: uint16_t - distance in millimetres (not range checked)
+    uint16_t duration_to_distance_mm(unsigned long duration_us);
+    
+    // Purpose: Set the speed of sound from the air temperature
+    // Description: c = SOUND_SPEED_0C_M_S + SOUND_SPEED_PER_C_M_S * T
+    // Args: celsius - air temperature (-40 to 60)
+    // Return: void
+    void set_temperature_c(float celsius);
+    
+    // Purpose: Set the speed of sound directly
+    // Description: Updates the factors of both the float and integer paths
+    // Args: speed_m_s - speed of sound (300 to 400 m/s)
+    // Return: void
+    void set_speed_of_sound_m_s(float speed_m_s);
+    
+    // Purpose: Get the speed of sound in use
+    // Args: None
+    // Return: float - [m/s]
+    float get_speed_of_sound_m_s();
+    
     // Purpose: Read distance with averaging (multiple samples)
-    // Description: Takes multiple measurements and returns the average
-    //   Filters out invalid readings automatically
+    // Description: Takes one measurement and returns the filter output over
+    //   it and the previous pings (see SonarFilter); invalid readings are
+    //   left out of the filter
     // Args: None
-    // Return: float - averaged distance in centimeters, or -1.0 if all samples invalid
+    // Return: float - filtered distance in centimeters, or -1.0 if no valid reading yet
     float read_distance_averaged_cm();
     
+    // Purpose: Get the filtered distance without pinging
+    // Description: Output of the range filter after the last valid reading
+    // Args: None
+    // Return: float - filtered distance in centimeters, or -1.0 if no valid reading yet
+    float get_filtered_distance_cm();
+    
+    // Purpose: Access the range filter to change its mode or parameters
+    // Args: None
+    // Return: SonarFilter& - the filter fed by every reading
+    SonarFilter& get_filter();
+    
     // Purpose: Check if a distance reading is within valid range
     // Description: Validates if reading is between min and max measurable distance
     // Args: distance_cm - distance value to validate
     // Return: bool - true if valid, false if out of range
     bool is_valid_reading(float distance_cm);
     
+    // ========== ASYNCHRONOUS MEASUREMENT ==========
+    
+    // Purpose: Trigger a ping without waiting for its echo
+    // Description: The echo edges are timestamped by the pin interrupt; on
+    //   pins without one the echo is measured before returning (see above)
+    // Args: None
+    // Return: bool - false if the previous ping is still waiting for its echo
+    bool start_ping();
+    
+    // Purpose: Check on the current ping
+    // Description: Finishes the ping when the echo is complete or the timeout
+    //   has passed, and then runs the echo callback once
+    // Args: None
+    // Return: SonarPingState - state after the check
+    SonarPingState poll_ping();
+    
+    // Purpose: Get the result of the last finished ping
+    // Args: echo - destination
+    // Return: bool - true if the last ping returned a valid echo
+    bool get_echo(SonarEcho &echo);
+    
+    // Purpose: Set the function run by poll_ping() when a ping finishes
+    // Args: callback - function, or nullptr for none
+    // Return: void
+    void set_echo_callback(SonarEchoCallback callback);
+    
+    // Purpose: Check whether pings on the current pin are interrupt-driven
+    // Args: None
+    // Return: bool - false if start_ping() blocks on this pin
+    bool is_async();
+    
+    // ========== PING SCHEDULING ==========
+    
+    // Purpose: Size the listening window for the ranges that matter
+    // Description: Sets the timeout to the round trip of range_cm (clamped
+    //   to SONAR_MIN_TIMEOUT_US .. DEFAULT_TIMEOUT_US); echoes from further
+    //   away read as timeouts
+    // Args: range_cm - farthest range of interest [cm]
+    // Return: void
+    void set_expected_range_cm(float range_cm);
+    
+    // Purpose: Adapt the ping interval to the robot speed
+    // Description: Interval = SONAR_TRAVEL_PER_PING_CM / |speed|, within
+    //   timeout + SONAR_ECHO_DECAY_US .. SONAR_MAX_PING_INTERVAL_US
+    // Args: speed_cm_s - current robot speed [cm/s], sign ignored
+    // Return: void
+    void set_speed_cm_s(float speed_cm_s);
+    
+    // Purpose: Get the current ping interval
+    // Args: None
+    // Return: unsigned long - [us]
+    unsigned long get_ping_interval_us();
+    
+    // Purpose: Run the ping schedule; call every pass of loop()
+    // Description: Polls the ping in flight and starts the next one when
+    //   the interval has passed and the sensor is free
+    // Args: None
+    // Return: bool - true if a ping finished during this call (see get_echo())
+    bool update();
+    
+    // Purpose: Get the ping rate statistics
+    // Args: stats - destination
+    // Return: void
+    void get_ping_stats(SonarPingStats &stats);
+    
+    // Purpose: Clear the ping rate statistics
+    // Args: None
+    // Return: void
+    void reset_ping_stats();
+    
+    // Purpose: Log the ping rate statistics
+    // Args: None
+    // Return: void
+    void log_ping_stats();
+    
   private:
     int pin;                      // GPIO pin for sonar sensor
     unsigned long timeout_us;     // Timeout for pulse measurement
     int num_samples;              // Number of samples for averaging
+    SonarFilter filter;           // Fed by every valid reading
+    float speed_of_sound_m_s;     // Used by both conversions
+    float cm_per_us;              // Range per μs of echo, float path (c / 2)
+    uint16_t mm_per_us_q16;       // Range per μs of echo, integer path (c / 2, Q16)
+    SonarPingState ping_state;    // State of the current/last asynchronous ping
+    SonarEcho last_echo;          // Result of the last finished ping
+    SonarEchoCallback echo_callback;
+    bool echo_attached;           // true while the echo interrupt is attached to pin
+    unsigned long ping_interval_us;   // Scheduled trigger-to-trigger interval
+    uint16_t ping_sequence;       // Number of the current/last ping
+    bool ping_held;               // A due ping is waiting for the sensor to be free
+    SonarPingStats ping_stats;
+    
+    // Shared with the echo ISR (one asynchronous Sonar at a time)
+    static Sonar* volatile echo_owner;
+    static volatile bool echo_armed;        // Edges are recorded only while armed
+    static volatile bool echo_rising_seen;
+    static volatile bool echo_complete;
+    static volatile uint16_t echo_sequence;   // Ping the ISR is armed for
+    static volatile uint16_t echo_rise_sequence;  // echo_sequence latched on the rising edge
+    static volatile unsigned long echo_rise_us;
+    static volatile unsigned long echo_fall_us;
+    
+    // Purpose: Echo pin interrupt; timestamps the rising and falling edge
+    static void echo_isr();
+    
+    // Purpose: Attach the echo interrupt to the current pin if it has one
+    // Return: bool - true if attached
+    bool attach_echo_interrupt();
+    
+    // Purpose: Shortest ping interval the current timeout allows
+    // Return: unsigned long - [us]
+    unsigned long min_ping_interval_us();
+    
+    // Purpose: Record the result of the current ping and run the callback
+    // Args: duration_us - echo length, 0 if none
+    //       rise_us - micros() of the rising edge
+    // Return: void
+    void finish_ping(unsigned long duration_us, unsigned long rise_us);
     
     // Purpose: Send trigger pulse to initiate measurement
     // Description: Sends 5μs HIGH pulse on the pin
@@ -0,0 +1,184 @@
+#include "sonar_filter.h"
+#include <math.h>
+
+SonarFilter::SonarFilter() {
+  window = DEFAULT_SONAR_FILTER_WINDOW;
+  mode = DEFAULT_SONAR_FILTER_MODE;
+  ema_alpha = DEFAULT_SONAR_EMA_ALPHA;
+  hampel_threshold = DEFAULT_HAMPEL_THRESHOLD;
+  reset();
+}
+
+void SonarFilter::reset() {
+  head = 0;
+  count = 0;
+  ema = 0.0f;
+  output = -1.0f;
+  outliers = 0;
+}
+
+// ========== CONFIGURATION ==========
+
+bool SonarFilter::set_window(uint8_t window) {
+  if (window < 1 || window > SONAR_FILTER_MAX_WINDOW) {
+    return false;
+  }
+  this->window = window;
+  reset();
+  return true;
+}
+
+uint8_t SonarFilter::get_window() const {
+  return window;
+}
+
+void SonarFilter::set_mode(SonarFilterMode mode) {
+  this->mode = mode;
+}
+
+SonarFilterMode SonarFilter::get_mode() const {
+  return mode;
+}
+
+bool SonarFilter::set_ema_alpha(float alpha) {
+  if (!(alpha > 0.0f && alpha <= 1.0f)) {
+    return false;
+  }
+  ema_alpha = alpha;
+  return true;
+}
+
+bool SonarFilter::set_hampel_threshold(float threshold) {
+  if (!(threshold > 0.0f)) {
+    return false;
+  }
+  hampel_threshold = threshold;
+  return true;
+}
+
+// ========== FILTERING ==========
+
+float SonarFilter::add(float distance_cm) {
+  if (!(distance_cm > 0.0f)) {
+    return output;
+  }
+
+  // Judge the new range against the window before it joins it.
+  float cleaned = distance_cm;
+  if ((mode == SonarFilterMode::HAMPEL || mode == SonarFilterMode::HAMPEL_EMA) && count >= HAMPEL_MIN_SAMPLES) {
+    float median = get_median();
+    float limit = hampel_threshold * 1.4826f * median_abs_deviation(median);
+    if (limit < HAMPEL_MIN_DEVIATION_CM) {
+      limit = HAMPEL_MIN_DEVIATION_CM;
+    }
+    if (fabs(distance_cm - median) > limit) {
+      cleaned = median;
+      outliers++;
+    }
+  }
+
+  // The window always takes the raw range, so real steps get through.
+  if (count == window) {
+    remove_sorted(ring[head]);
+    count--;
+  }
+  ring[head] = distance_cm;
+  head = (head + 1) % window;
+  insert_sorted(distance_cm);
+  count++;
+
+  ema = output > 0.0f ? ema + ema_alpha * (cleaned - ema) : cleaned;
+
+  switch (mode) {
+    case SonarFilterMode::MEDIAN:
+      output = get_median();
+      break;
+    case SonarFilterMode::HAMPEL:
+      output = cleaned;
+      break;
+    case SonarFilterMode::EMA:
+    case SonarFilterMode::HAMPEL_EMA:
+      output = ema;
+      break;
+  }
+  return output;
+}
+
+float SonarFilter::get_value() const {
+  return output;
+}
+
+float SonarFilter::get_median() const {
+  if (count == 0) {
+    return -1.0f;
+  }
+  return 0.5f * (sorted[(count - 1) / 2] + sorted[count / 2]);
+}
+
+uint8_t SonarFilter::get_count() const {
+  return count;
+}
+
+uint16_t SonarFilter::get_outliers() const {
+  return outliers;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+float SonarFilter::median_abs_deviation(float median) const {
+  // Deviations grow outwards from the middle of the sorted array on both
+  // sides, so merging the two sides yields them in ascending order.
+  int8_t low = (count - 1) / 2;
+  int8_t high = low + 1;
+  float lower_middle = 0.0f;
+  for (uint8_t k = 0; k <= count / 2; k++) {
+    float deviation;
+    if (high >= count || (low >= 0 && median - sorted[low] <= sorted[high] - median)) {
+      deviation = median - sorted[low--];
+    } else {
+      deviation = sorted[high++] - median;
+    }
+    if (k == (count - 1) / 2) {
+      lower_middle = deviation;
+    }
+    if (k == count / 2) {
+      return 0.5f * (lower_middle + deviation);
+    }
+  }
+  return lower_middle;
+}
+
+void SonarFilter::insert_sorted(float value) {
+  // Binary search for the first element greater than value.
+  uint8_t low = 0;
+  uint8_t high = count;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (sorted[middle] <= value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (uint8_t i = count; i > low; i--) {
+    sorted[i] = sorted[i - 1];
+  }
+  sorted[low] = value;
+}
+
+void SonarFilter::remove_sorted(float value) {
+  // Binary search for the first element not less than value; it is value itself.
+  uint8_t low = 0;
+  uint8_t high = count;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (sorted[middle] < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (uint8_t i = low; i + 1 < count; i++) {
+    sorted[i] = sorted[i + 1];
+  }
+}
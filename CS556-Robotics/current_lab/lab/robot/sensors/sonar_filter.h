@@ -0,0 +1,145 @@
+#ifndef sonar_filter_h
+#define sonar_filter_h
+
+#include <stdint.h>
+
+// ============================================================
+// STREAMING SONAR FILTER
+// ============================================================
+//
+// Purpose: Smooth sonar ranges and reject multipath spikes using the pings
+//   already taken, instead of taking a burst of extra pings per reading
+//
+// Description:
+//   The last `window` valid ranges are kept twice: in a ring (arrival order,
+//   to know which one leaves) and in a sorted array (for the median). Each
+//   add() removes the oldest and inserts the newest by binary search, so the
+//   median is a direct read. Invalid ranges (<= 0, the Sonar's -1.0) are not
+//   added; the filter holds its last output.
+//
+// Modes:
+//   - MEDIAN: median of the window; a spike has no effect until it is the
+//     majority of the window
+//   - HAMPEL: the new range, unless it lies more than threshold * 1.4826 * MAD
+//     from the window median (MAD = median absolute deviation, 1.4826 makes
+//     it a standard deviation for Gaussian noise); then the median replaces it
+//   - EMA: exponential moving average y += alpha * (x - y)
+//   - HAMPEL_EMA: the EMA of the Hampel-cleaned ranges
+//   The window keeps the raw ranges in every mode, so a real step (a new
+//   obstacle) is accepted once it fills half the window.
+//
+// Cost per add() with window n <= SONAR_FILTER_MAX_WINDOW:
+//   - Sorted update: O(log n) search plus a shift of at most n floats
+//   - MAD: O(n / 2), merging outwards from the median of the sorted array
+//   - EMA: O(1)
+//
+// ============================================================
+
+enum class SonarFilterMode : uint8_t {
+  MEDIAN,
+  HAMPEL,
+  EMA,
+  HAMPEL_EMA
+};
+
+const uint8_t SONAR_FILTER_MAX_WINDOW = 10;               // Ring capacity (two float arrays)
+const uint8_t DEFAULT_SONAR_FILTER_WINDOW = 5;
+const SonarFilterMode DEFAULT_SONAR_FILTER_MODE = SonarFilterMode::HAMPEL_EMA;
+const float DEFAULT_SONAR_EMA_ALPHA = 0.4f;               // Weight of the newest range
+const float DEFAULT_HAMPEL_THRESHOLD = 3.0f;              // Outlier limit in robust standard deviations
+const float HAMPEL_MIN_DEVIATION_CM = 1.0f;               // Limit floor, so a flat window does not reject noise
+const uint8_t HAMPEL_MIN_SAMPLES = 3;                     // Fewer ranges than this are not judged
+
+class SonarFilter {
+  public:
+    // Purpose: Initialize an empty filter with the default window and mode
+    // Args: None
+    // Return: void
+    SonarFilter();
+
+    // Purpose: Forget all ranges and the filter output
+    // Args: None
+    // Return: void
+    void reset();
+
+    // ========== CONFIGURATION ==========
+
+    // Purpose: Set the number of recent ranges the filter looks at (resets it)
+    // Args: window - 1 to SONAR_FILTER_MAX_WINDOW
+    // Return: bool - false (unchanged) if out of range
+    bool set_window(uint8_t window);
+
+    // Purpose: Get the window length
+    // Args: None
+    // Return: uint8_t
+    uint8_t get_window() const;
+
+    // Purpose: Select what get_value() returns (the window is kept)
+    // Args: mode
+    // Return: void
+    void set_mode(SonarFilterMode mode);
+
+    // Purpose: Get the filter mode
+    // Args: None
+    // Return: SonarFilterMode
+    SonarFilterMode get_mode() const;
+
+    // Purpose: Set the EMA weight of the newest range
+    // Args: alpha - 0 < alpha <= 1 (1 = no smoothing)
+    // Return: bool - false (unchanged) if out of range
+    bool set_ema_alpha(float alpha);
+
+    // Purpose: Set the Hampel outlier limit
+    // Args: threshold - robust standard deviations, > 0
+    // Return: bool - false (unchanged) if not positive
+    bool set_hampel_threshold(float threshold);
+
+    // ========== FILTERING ==========
+
+    // Purpose: Add one range and update the output
+    // Args: distance_cm - new range; <= 0 (invalid) is ignored
+    // Return: float - filtered range [cm], -1.0 until the first valid range
+    float add(float distance_cm);
+
+    // Purpose: Get the filtered range
+    // Args: None
+    // Return: float - [cm], -1.0 until the first valid range
+    float get_value() const;
+
+    // Purpose: Get the median of the window
+    // Args: None
+    // Return: float - [cm], -1.0 if empty
+    float get_median() const;
+
+    // Purpose: Number of valid ranges in the window
+    // Args: None
+    // Return: uint8_t
+    uint8_t get_count() const;
+
+    // Purpose: Number of ranges the Hampel stage replaced since reset()
+    // Args: None
+    // Return: uint16_t
+    uint16_t get_outliers() const;
+
+  private:
+    // Purpose: Median absolute deviation of the window around median
+    float median_abs_deviation(float median) const;
+
+    // Purpose: Insert into / remove from the sorted array (count is updated by the caller)
+    void insert_sorted(float value);
+    void remove_sorted(float value);
+
+    float ring[SONAR_FILTER_MAX_WINDOW];      // Ranges in arrival order
+    float sorted[SONAR_FILTER_MAX_WINDOW];    // The same ranges, ascending
+    uint8_t head;                             // Ring slot of the next range
+    uint8_t count;                            // Ranges in the window
+    uint8_t window;
+    SonarFilterMode mode;
+    float ema_alpha;
+    float hampel_threshold;
+    float ema;                                // EMA state (valid once count > 0)
+    float output;
+    uint16_t outliers;
+};
+
+#endif
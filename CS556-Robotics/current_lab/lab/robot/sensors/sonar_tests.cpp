@@ -73,6 +73,77 @@ void test_configuration_changes() {
   delay(1000);
 }
 
+void test_filter_modes() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Test: Filter modes on the same pings");
+  
+  // Feed every raw reading to one filter per mode; wave a hand through the
+  // beam now and then to see how each handles the spikes.
+  const SonarFilterMode modes[4] = {SonarFilterMode::MEDIAN, SonarFilterMode::HAMPEL, SonarFilterMode::EMA,
+                                    SonarFilterMode::HAMPEL_EMA};
+  SonarFilter filters[4];
+  for (int m = 0; m < 4; m++) {
+    filters[m].set_mode(modes[m]);
+  }
+  
+  for (int i = 0; i < TEST_FILTER_PINGS; i++) {
+    float distance = robot.sonar->read_distance_cm();
+    String msg = "raw=" + String(distance) + " cm, median/hampel/ema/hampel+ema:";
+    for (int m = 0; m < 4; m++) {
+      msg += " " + String(filters[m].add(distance));
+    }
+    Logger::log_info(CLASS_NAME, __FUNCTION__, msg.c_str());
+    delay(TEST_FILTER_PERIOD_MS);
+  }
+  
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Hampel outliers replaced: " + String(filters[1].get_outliers())).c_str());
+}
+
+void test_integer_conversion() {
+  Logger::log_info(CLASS_NAME, __FUNCTION__, "Test: Integer mm conversion and temperature compensation");
+  
+  // Agreement with the float path over the whole range (no pings needed).
+  float max_error_mm = 0.0f;
+  for (unsigned long duration = 100; duration <= DEFAULT_TIMEOUT_US; duration += 97) {
+    float reference_mm = duration * robot.sonar->get_speed_of_sound_m_s() * 0.5e-3f;
+    float error_mm = fabs(robot.sonar->duration_to_distance_mm(duration) - reference_mm);
+    if (error_mm > max_error_mm) {
+      max_error_mm = error_mm;
+    }
+  }
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Max error vs float: " + String(max_error_mm, 3) + " mm").c_str());
+  
+  // Cost per conversion; volatile keeps the loops from being optimized away.
+  volatile uint16_t sink_mm = 0;
+  volatile float sink_cm = 0.0f;
+  unsigned long start_us = micros();
+  for (int i = 0; i < TEST_CONVERSIONS; i++) {
+    sink_mm = robot.sonar->duration_to_distance_mm(1000 + i);
+  }
+  unsigned long integer_us = micros() - start_us;
+  start_us = micros();
+  for (int i = 0; i < TEST_CONVERSIONS; i++) {
+    sink_cm = (1000 + i) / 29.0f / 2.0f;
+  }
+  unsigned long float_us = micros() - start_us;
+  (void)sink_mm;
+  (void)sink_cm;
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Per conversion: integer " + String(integer_us / (float)TEST_CONVERSIONS, 2) +
+                                              " us, old float " + String(float_us / (float)TEST_CONVERSIONS, 2) +
+                                              " us").c_str());
+  
+  // The same 20 ms echo (~3.4 m) at different air temperatures.
+  const float temperatures_c[3] = {10.0f, 20.0f, 30.0f};
+  for (int i = 0; i < 3; i++) {
+    robot.sonar->set_temperature_c(temperatures_c[i]);
+    Logger::log_info(CLASS_NAME, __FUNCTION__, (String(temperatures_c[i], 0) + " C: 20000 us = " +
+                                                String(robot.sonar->duration_to_distance_mm(20000)) + " mm").c_str());
+  }
+  robot.sonar->set_temperature_c(DEFAULT_TEMPERATURE_C);
+  
+  uint16_t distance_mm = robot.sonar->read_distance_mm();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Distance: " + String(distance_mm) + " mm").c_str());
+}
+
 void run_all_sonar_tests() {
   Logger::log_info(CLASS_NAME, __FUNCTION__, "Starting all sonar tests");
   
@@ -80,6 +151,8 @@ void run_all_sonar_tests() {
   test_averaged_measurement();
   test_multiple_readings();
   test_configuration_changes();
+  test_filter_modes();
+  test_integer_conversion();
   
   Logger::log_info(CLASS_NAME, __FUNCTION__, "All sonar tests complete");
 }
@@ -4,12 +4,17 @@
 // Test parameters for sonar
 const int TEST_MEASUREMENTS = 5;        // Number of measurements to take
 const int TEST_DELAY_MS = 500;          // Delay between measurements
+const int TEST_FILTER_PINGS = 40;       // Pings compared across the filter modes
+const int TEST_FILTER_PERIOD_MS = 60;   // Delay between those pings
+const int TEST_CONVERSIONS = 1000;      // Conversions timed per distance path
 
 // Test functions for sonar sensor
 void test_single_measurement();
 void test_averaged_measurement();
 void test_multiple_readings();
 void test_configuration_changes();
+void test_filter_modes();
+void test_integer_conversion();
 
 // Run all sonar tests in sequence
 void run_all_sonar_tests();
@@ -0,0 +1,92 @@
+#include "wheel_velocity.h"
+
+// 1 count per 4 us in Q4 counts per second; micros() has 4 us resolution anyway.
+const int32_t VELOCITY_Q4_PER_COUNT_TICK = (1000000L / 4) << VELOCITY_FRACTION_BITS;
+const int32_t VELOCITY_MAX_WINDOW_COUNTS = 536;    // 536 * 4e6 < 2^31
+
+WheelVelocity::WheelVelocity() {
+  reset(0, 0);
+  has_reference = false;
+}
+
+void WheelVelocity::reset(int32_t count, unsigned long t_us) {
+  reference_count = count;
+  reference_us = t_us;
+  last_count = count;
+  last_edge_us = t_us;
+  edge_samples = 0;
+  timing = false;
+  has_reference = true;
+  velocity_q4 = 0;
+  method = VelocityMethod::STOPPED;
+}
+
+void WheelVelocity::update(int32_t count, unsigned long t_us) {
+  if (!has_reference) {
+    reset(count, t_us);
+    return;
+  }
+
+  if (count != last_count) {
+    last_count = count;
+    last_edge_us = t_us;
+    if (!timing) {
+      // First edge after a standstill: the window starts here.
+      timing = true;
+      reference_count = count;
+      reference_us = t_us;
+      edge_samples = 0;
+      return;
+    }
+
+    edge_samples++;
+    unsigned long window_us = t_us - reference_us;
+    if (window_us >= VELOCITY_MIN_WINDOW_US) {
+      velocity_q4 = rate_q4(count - reference_count, window_us);
+      method = edge_samples > 1 ? VelocityMethod::COUNT : VelocityMethod::PERIOD;
+      reference_count = count;
+      reference_us = t_us;
+      edge_samples = 0;
+    }
+    return;
+  }
+
+  unsigned long quiet_us = t_us - last_edge_us;
+  if (quiet_us >= VELOCITY_STOP_TIMEOUT_US) {
+    velocity_q4 = 0;
+    method = VelocityMethod::STOPPED;
+    timing = false;
+    return;
+  }
+
+  // No edge for quiet_us: the wheel turns at most one count per quiet_us.
+  if (velocity_q4 != 0 && quiet_us > 0) {
+    int32_t limit_q4 = rate_q4(1, quiet_us);
+    if (velocity_q4 > limit_q4) {
+      velocity_q4 = limit_q4;
+    } else if (velocity_q4 < -limit_q4) {
+      velocity_q4 = -limit_q4;
+    }
+  }
+}
+
+int32_t WheelVelocity::get_velocity_q4() const {
+  return velocity_q4;
+}
+
+VelocityMethod WheelVelocity::get_method() const {
+  return method;
+}
+
+int32_t WheelVelocity::rate_q4(int32_t counts, unsigned long dt_us) {
+  unsigned long ticks = dt_us >> 2;
+  // Halve both sides until the product fits; only windows spanning very slow polling get here.
+  while (counts > VELOCITY_MAX_WINDOW_COUNTS || counts < -VELOCITY_MAX_WINDOW_COUNTS) {
+    counts /= 2;
+    ticks >>= 1;
+  }
+  if (ticks == 0) {
+    ticks = 1;
+  }
+  return counts * VELOCITY_Q4_PER_COUNT_TICK / (int32_t)ticks;
+}
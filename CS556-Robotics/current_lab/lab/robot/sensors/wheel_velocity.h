@@ -0,0 +1,101 @@
+#ifndef wheel_velocity_h
+#define wheel_velocity_h
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// ============================================================
+// HYBRID WHEEL VELOCITY ESTIMATION (M/T METHOD)
+// ============================================================
+//
+// Purpose: Wheel speed that stays clean from a crawl to full speed, from the
+//   encoder samples the control tick already takes
+//
+// Description:
+//   A fixed 5 ms window sees 0-2 counts below ~4 cm/s, so counts per window
+//   is mostly quantization noise there. Instead every estimate is taken over
+//   a window that starts and ends on a sample in which the count changed
+//   (an "edge sample") and lasts at least VELOCITY_MIN_WINDOW_US:
+//     - High speed (COUNT): every sample has edges, the window closes after
+//       VELOCITY_MIN_WINDOW_US and the estimate is the counts in it
+//     - Low speed (PERIOD): edges are further apart than the minimum window,
+//       so the window runs from one edge to the next and the estimate is one
+//       count over the time between them
+//   Both cases are the same division, counts / elapsed time, done once per
+//   window in 32-bit fixed point (see rate_q4()); no float, and no division
+//   at all on samples that neither close a window nor lie between slow edges.
+//
+// Edge timing: the Pololu library owns the encoder interrupts, so an edge is
+//   timed by the sample that first sees it, with up to one sample period of
+//   latency at each end of the window (one ControlTimer tick when timed).
+//
+// Slowing down: while no edge arrives the wheel is at most one count per
+//   quiet time fast, so the estimate is capped at that and decays towards
+//   zero. After VELOCITY_STOP_TIMEOUT_US without an edge it is zero; the next
+//   edge only restarts the timing, so a standstill never counts as a window.
+//
+// Units: counts per second in Q4 (1/16 count/s resolution). |counts| <= 536
+//   per window keeps the product in 32 bits; larger windows (very slow
+//   polling) are halved down to fit.
+//
+// ============================================================
+
+const unsigned long VELOCITY_MIN_WINDOW_US = 20000;     // Shortest window (4 ticks at 200 Hz)
+const unsigned long VELOCITY_STOP_TIMEOUT_US = 250000;  // No edge for this long means stopped (< 4 counts/s)
+const uint8_t VELOCITY_FRACTION_BITS = 4;               // Q4 counts per second
+
+// How the current estimate was obtained
+enum class VelocityMethod : uint8_t {
+  STOPPED,               // No edge within VELOCITY_STOP_TIMEOUT_US (or no window yet)
+  COUNT,                 // Several edge samples in the window: counts per window
+  PERIOD                 // One edge-to-edge interval longer than the minimum window
+};
+
+class WheelVelocity {
+  public:
+    // Purpose: Initialize a stopped estimator with no reference
+    // Args: None
+    // Return: void
+    WheelVelocity();
+
+    // Purpose: Restart the estimate from a known count, as stopped
+    // Args: count - total counts
+    //       t_us - micros() of the count
+    // Return: void
+    void reset(int32_t count, unsigned long t_us);
+
+    // Purpose: Feed one encoder sample
+    // Args: count - total counts (32-bit, see EncoderService)
+    //       t_us - micros() when the count was sampled
+    // Return: void
+    void update(int32_t count, unsigned long t_us);
+
+    // Purpose: Get the current estimate
+    // Args: None
+    // Return: int32_t - counts per second, Q4
+    int32_t get_velocity_q4() const;
+
+    // Purpose: Get the method behind the current estimate
+    // Args: None
+    // Return: VelocityMethod
+    VelocityMethod get_method() const;
+
+    // Purpose: Fixed-point rate of a count change over a time
+    // Args: counts - count change (sign kept)
+    //       dt_us - elapsed time [us], > 0
+    // Return: int32_t - counts per second, Q4
+    static int32_t rate_q4(int32_t counts, unsigned long dt_us);
+
+  private:
+    int32_t reference_count;          // Count at the start of the window (an edge sample)
+    unsigned long reference_us;
+    int32_t last_count;               // Count of the previous sample
+    unsigned long last_edge_us;       // Time of the last edge sample
+    uint8_t edge_samples;             // Edge samples since the window started
+    bool timing;                      // false until an edge starts a window
+    bool has_reference;               // false until the first sample
+    int32_t velocity_q4;
+    VelocityMethod method;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "control_timer.h"
+
+#include <Pololu3piPlus32U4.h>
+#if defined(__AVR_ATmega32U4__)
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif
+
+#include "logger.h"
+
+using namespace Pololu3piPlus32U4;
+
+#undef CLASS_NAME
+#define CLASS_NAME "ControlTimer"
+
+static const uint16_t CONTROL_TIMER_PRESCALER = 64;
+
+ControlCallback ControlTimer::callbacks[CONTROL_TIMER_MAX_CALLBACKS];
+volatile uint8_t ControlTimer::callback_count = 0;
+volatile bool ControlTimer::running = false;
+volatile bool ControlTimer::in_tick = false;
+unsigned long ControlTimer::period_us = 1000000UL / DEFAULT_CONTROL_TICK_HZ;
+
+volatile int16_t ControlTimer::sample_left = 0;
+volatile int16_t ControlTimer::sample_right = 0;
+volatile unsigned long ControlTimer::sample_us = 0;
+
+volatile unsigned long ControlTimer::last_tick_us = 0;
+volatile bool ControlTimer::have_last_tick = false;
+ControlTimerStats ControlTimer::stats;
+
+#if defined(__AVR_ATmega32U4__)
+ISR(TIMER3_COMPA_vect) {
+  ControlTimer::handle_tick();
+}
+#endif
+
+// ========== CONTROL ==========
+
+bool ControlTimer::begin(uint16_t frequency_hz) {
+  if (frequency_hz < CONTROL_TICK_MIN_HZ || frequency_hz > CONTROL_TICK_MAX_HZ) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Invalid tick rate");
+    return false;
+  }
+
+#if defined(__AVR_ATmega32U4__)
+  uint16_t top = (uint16_t)(F_CPU / CONTROL_TIMER_PRESCALER / frequency_hz - 1);
+
+  noInterrupts();
+  period_us = 1000000UL / frequency_hz;
+  TCCR3A = 0;
+  TCCR3B = 0;
+  TCNT3 = 0;
+  OCR3A = top;
+  TCCR3B = (1 << WGM32) | (1 << CS31) | (1 << CS30);  // CTC on OCR3A, clk/64
+  TIFR3 = (1 << OCF3A);
+  TIMSK3 |= (1 << OCIE3A);
+  running = true;
+  interrupts();
+
+  reset_stats();
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("Tick running at " + String(frequency_hz) + " Hz").c_str());
+  return true;
+#else
+  Logger::log_error(CLASS_NAME, __FUNCTION__, "Timer3 not available on this target");
+  return false;
+#endif
+}
+
+void ControlTimer::stop() {
+#if defined(__AVR_ATmega32U4__)
+  noInterrupts();
+  TIMSK3 &= ~(1 << OCIE3A);
+  TCCR3B = 0;
+  interrupts();
+#endif
+  running = false;
+}
+
+bool ControlTimer::is_running() {
+  return running;
+}
+
+unsigned long ControlTimer::get_period_us() {
+  return period_us;
+}
+
+// ========== CALLBACKS ==========
+
+bool ControlTimer::add_callback(ControlCallback callback) {
+  if (callback == nullptr) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Null callback");
+    return false;
+  }
+
+  bool added = false;
+  noInterrupts();
+  bool duplicate = false;
+  for (uint8_t i = 0; i < callback_count; i++) {
+    if (callbacks[i] == callback) {
+      duplicate = true;
+    }
+  }
+  if (!duplicate && callback_count < CONTROL_TIMER_MAX_CALLBACKS) {
+    callbacks[callback_count] = callback;
+    callback_count++;
+    added = true;
+  }
+  interrupts();
+
+  if (!added) {
+    Logger::log_error(CLASS_NAME, __FUNCTION__, "Callback already registered or no free slot");
+  }
+  return added;
+}
+
+bool ControlTimer::remove_callback(ControlCallback callback) {
+  bool removed = false;
+  noInterrupts();
+  for (uint8_t i = 0; i < callback_count; i++) {
+    if (callbacks[i] == callback) {
+      // Keep the remaining callbacks in registration order.
+      for (uint8_t j = i + 1; j < callback_count; j++) {
+        callbacks[j - 1] = callbacks[j];
+      }
+      callback_count--;
+      removed = true;
+      break;
+    }
+  }
+  interrupts();
+  return removed;
+}
+
+// ========== ENCODER SAMPLES ==========
+
+void ControlTimer::get_encoder_sample(int16_t &left, int16_t &right, unsigned long &stamp_us) {
+  noInterrupts();
+  left = sample_left;
+  right = sample_right;
+  stamp_us = sample_us;
+  interrupts();
+}
+
+// ========== STATISTICS ==========
+
+void ControlTimer::get_stats(ControlTimerStats &copy) {
+  noInterrupts();
+  copy = stats;
+  interrupts();
+}
+
+void ControlTimer::reset_stats() {
+  noInterrupts();
+  stats.ticks = 0;
+  stats.overruns = 0;
+  stats.min_period_us = 0xFFFFFFFFUL;
+  stats.max_period_us = 0;
+  stats.max_busy_us = 0;
+  for (uint8_t i = 0; i < CONTROL_TIMER_HISTOGRAM_BINS; i++) {
+    stats.histogram[i] = 0;
+  }
+  have_last_tick = false;
+  interrupts();
+}
+
+void ControlTimer::print_stats() {
+  ControlTimerStats copy;
+  get_stats(copy);
+
+  if (copy.ticks == 0) {
+    Logger::log_info(CLASS_NAME, __FUNCTION__, "No ticks measured");
+    return;
+  }
+
+  Logger::log_info(CLASS_NAME, __FUNCTION__, ("ticks=" + String(copy.ticks) + ", period=" + String(period_us) +
+                                              " us, min=" + String(copy.min_period_us) + " us, max=" +
+                                              String(copy.max_period_us) + " us, overruns=" + String(copy.overruns) +
+                                              ", max busy=" + String(copy.max_busy_us) + " us").c_str());
+
+  String histogram = "|jitter| us: 0-3:" + String(copy.histogram[0]);
+  unsigned long low = 4;
+  for (uint8_t i = 1; i < CONTROL_TIMER_HISTOGRAM_BINS - 1; i++) {
+    histogram += " " + String(low) + "-" + String(2 * low - 1) + ":" + String(copy.histogram[i]);
+    low *= 2;
+  }
+  histogram += " >=" + String(low) + ":" + String(copy.histogram[CONTROL_TIMER_HISTOGRAM_BINS - 1]);
+  Logger::log_info(CLASS_NAME, __FUNCTION__, histogram.c_str());
+}
+
+// ========== TICK ==========
+
+void ControlTimer::handle_tick() {
+  unsigned long now_us = micros();
+
+  if (have_last_tick) {
+    unsigned long period = now_us - last_tick_us;
+    unsigned long deviation = period > period_us ? period - period_us : period_us - period;
+    if (period < stats.min_period_us) {
+      stats.min_period_us = period;
+    }
+    if (period > stats.max_period_us) {
+      stats.max_period_us = period;
+    }
+    stats.histogram[jitter_bin(deviation)]++;
+    stats.ticks++;
+  }
+  last_tick_us = now_us;
+  have_last_tick = true;
+
+  // The Pololu encoder getters re-enable interrupts; the timestamps above are already taken.
+  sample_left = Encoders::getCountsLeft();
+  sample_right = Encoders::getCountsRight();
+  sample_us = now_us;
+
+  if (in_tick) {
+    stats.overruns++;
+    return;
+  }
+  in_tick = true;
+
+  // Let the encoder and millis() interrupts in while the callbacks run.
+  interrupts();
+  uint8_t count = callback_count;
+  for (uint8_t i = 0; i < count; i++) {
+    callbacks[i]();
+  }
+  unsigned long busy_us = micros() - now_us;
+  noInterrupts();
+
+  if (busy_us > stats.max_busy_us) {
+    stats.max_busy_us = busy_us;
+  }
+  in_tick = false;
+}
+
+// ========== PRIVATE HELPER FUNCTIONS ==========
+
+uint8_t ControlTimer::jitter_bin(unsigned long deviation_us) {
+  // Bin 0 below 4 us, then one bin per power of two.
+  uint8_t bin = 0;
+  deviation_us >>= 2;
+  while (deviation_us > 0 && bin < CONTROL_TIMER_HISTOGRAM_BINS - 1) {
+    deviation_us >>= 1;
+    bin++;
+  }
+  return bin;
+}
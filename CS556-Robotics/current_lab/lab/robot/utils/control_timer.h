@@ -0,0 +1,145 @@
+#ifndef control_timer_h
+#define control_timer_h
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// ============================================================
+// FIXED-RATE CONTROL TICK
+// ============================================================
+//
+// Purpose: Run control callbacks at a fixed period from a hardware timer
+//   instead of whenever loop() and its delay() calls get around to it
+//
+// Description:
+//   Timer3 (16-bit, unused by the motor driver, buzzer and Servo library on the
+//   32U4) runs in CTC mode and fires TIMER3_COMPA at the tick rate. Each tick:
+//     1. Timestamps itself and updates the jitter statistics
+//     2. Samples both encoder counters, so every consumer sees counts taken
+//        at the same, evenly spaced instants
+//     3. Re-enables interrupts and runs the registered callbacks in order
+//
+// Timing:
+//   - Prescaler 64: 4 us per timer count, OCR3A = F_CPU / 64 / rate - 1
+//   - Period jitter is measured with micros() (4 us resolution on 16 MHz)
+//   - Histogram bins hold |period - nominal|: 0-3, 4-7, 8-15, 16-31, 32-63,
+//     64-127, 128-255 and >= 256 us
+//
+// Overruns:
+//   - Callbacks run with interrupts enabled, so the encoder and millis()
+//     interrupts keep working while they execute
+//   - A tick that arrives while the previous callbacks are still running is
+//     counted as an overrun; it still samples the encoders but skips the
+//     callbacks rather than nesting them
+//
+// Callback rules: callbacks run in interrupt context. Keep them short, do not
+//   block (delay(), pulseIn()) and do not print to Serial. Data shared with
+//   loop() must be read with interrupts disabled.
+//
+// ============================================================
+
+const uint16_t DEFAULT_CONTROL_TICK_HZ = 200;          // Default tick rate (5 ms period)
+const uint16_t CONTROL_TICK_MIN_HZ = 10;               // Slowest rate the prescaler supports comfortably
+const uint16_t CONTROL_TICK_MAX_HZ = 1000;             // Fastest rate that leaves time for loop()
+const uint8_t CONTROL_TIMER_MAX_CALLBACKS = 4;         // Callback slots
+const uint8_t CONTROL_TIMER_HISTOGRAM_BINS = 8;        // Jitter histogram bins (see above)
+
+typedef void (*ControlCallback)();
+
+// Snapshot of the tick timing since the last reset_stats()
+struct ControlTimerStats {
+  unsigned long ticks;                                  // Ticks measured
+  unsigned long overruns;                               // Ticks whose callbacks were skipped
+  unsigned long min_period_us;                          // Shortest tick-to-tick interval
+  unsigned long max_period_us;                          // Longest tick-to-tick interval
+  unsigned long max_busy_us;                            // Longest callback run
+  unsigned long histogram[CONTROL_TIMER_HISTOGRAM_BINS];  // Ticks per |jitter| bin
+};
+
+class ControlTimer {
+  public:
+    // ========== CONTROL ==========
+
+    // Purpose: Start the periodic tick
+    // Args: frequency_hz - tick rate (CONTROL_TICK_MIN_HZ to CONTROL_TICK_MAX_HZ)
+    // Return: bool - false if the rate is invalid or the target has no Timer3
+    static bool begin(uint16_t frequency_hz = DEFAULT_CONTROL_TICK_HZ);
+
+    // Purpose: Stop the tick (callbacks stay registered)
+    // Args: None
+    // Return: void
+    static void stop();
+
+    // Purpose: Check whether the tick is running
+    // Args: None
+    // Return: bool
+    static bool is_running();
+
+    // Purpose: Get the nominal tick period
+    // Args: None
+    // Return: unsigned long - [us]
+    static unsigned long get_period_us();
+
+    // ========== CALLBACKS ==========
+
+    // Purpose: Register a function to run on every tick
+    // Args: callback - function to call (runs in interrupt context)
+    // Return: bool - false if all slots are used or it is already registered
+    static bool add_callback(ControlCallback callback);
+
+    // Purpose: Unregister a callback
+    // Args: callback - function passed to add_callback()
+    // Return: bool - false if it was not registered
+    static bool remove_callback(ControlCallback callback);
+
+    // ========== ENCODER SAMPLES ==========
+
+    // Purpose: Get the encoder counts sampled by the latest tick
+    // Args: left, right - raw counter values (wrap like Encoders::getCounts*)
+    //       stamp_us - micros() at the tick
+    // Return: void
+    static void get_encoder_sample(int16_t &left, int16_t &right, unsigned long &stamp_us);
+
+    // ========== STATISTICS ==========
+
+    // Purpose: Copy the timing statistics
+    // Args: stats - destination
+    // Return: void
+    static void get_stats(ControlTimerStats &stats);
+
+    // Purpose: Clear the timing statistics
+    // Args: None
+    // Return: void
+    static void reset_stats();
+
+    // Purpose: Log the timing statistics and jitter histogram
+    // Args: None
+    // Return: void
+    static void print_stats();
+
+    // Purpose: Tick body, called from the Timer3 compare interrupt only
+    // Args: None
+    // Return: void
+    static void handle_tick();
+
+  private:
+    // Purpose: Histogram bin for a deviation from the nominal period
+    // Return: uint8_t - bin index
+    static uint8_t jitter_bin(unsigned long deviation_us);
+
+    static ControlCallback callbacks[CONTROL_TIMER_MAX_CALLBACKS];
+    static volatile uint8_t callback_count;
+    static volatile bool running;
+    static volatile bool in_tick;              // Callbacks of the previous tick still running
+    static unsigned long period_us;
+
+    static volatile int16_t sample_left;
+    static volatile int16_t sample_right;
+    static volatile unsigned long sample_us;
+
+    static volatile unsigned long last_tick_us;
+    static volatile bool have_last_tick;       // false until the first tick after begin()/reset_stats()
+    static ControlTimerStats stats;
+};
+
+#endif
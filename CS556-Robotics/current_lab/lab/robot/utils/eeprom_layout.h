@@ -0,0 +1,28 @@
+#ifndef eeprom_layout_h
+#define eeprom_layout_h
+
+#include <stdint.h>
+
+// ============================================================
+// EEPROM LAYOUT
+// ============================================================
+//
+// Purpose: Assign every persistent record a fixed region of the EEPROM
+//
+// Description:
+//   The ATmega32U4 has 1 KB of EEPROM that survives power cycles and
+//   re-flashing. Each record starts with its own magic number and version and
+//   ends with a checksum, so a blank, stale or half-written region is detected
+//   and ignored. Keep the regions below non-overlapping when adding records.
+//
+// ============================================================
+
+const uint16_t EEPROM_SIZE_BYTES = 1024;
+
+const uint16_t EEPROM_MOTOR_CALIBRATION_ADDR = 0;    // MotorCalibrationRecord
+const uint16_t EEPROM_MOTOR_CALIBRATION_SIZE = 160;
+
+const uint16_t EEPROM_ODOMETRY_CALIBRATION_ADDR = 160;  // OdometryCalibrationRecord
+const uint16_t EEPROM_ODOMETRY_CALIBRATION_SIZE = 32;
+
+#endif
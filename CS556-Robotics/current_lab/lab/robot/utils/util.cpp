@@ -1,16 +1,18 @@
 #include "util.h"
+#include <Arduino.h>
 
 // Utility functions
-int convert_duration_to_ms(float duration) {
-  return (int)(duration * 1000);
+// Durations are unsigned long: a 16-bit int on AVR overflows past 32.7 s (e.g. 15 m at 0.2 m/s).
+unsigned long convert_duration_to_ms(float duration) {
+  return (unsigned long)(duration * 1000);
 }
 
 int calculate_inner_speed(int outer_speed_mm_per_s, float turn_speed_ratio) {
   return (int)(outer_speed_mm_per_s * turn_speed_ratio);
 }
 
-int calculate_motion_duration_ms(float distance_m, float speed_m_per_s) {
-  return (int)((distance_m / speed_m_per_s) * 1000);
+unsigned long calculate_motion_duration_ms(float distance_m, float speed_m_per_s) {
+  return (unsigned long)((distance_m / speed_m_per_s) * 1000);
 }
 
 // Validate a float value is within bounds, return false if out of range
@@ -29,6 +31,11 @@ float degrees_to_radians(float degrees) {
 float radians_to_degrees(float radians) {
   return radians * 180.0 / M_PI;
 }
+// Convert meters to millimeters
+float meters_to_millimeters(float meters) {
+  return meters * 1000.0;
+}
+
 // Convert meters per second to millimeters per second
 float meters_per_s_to_mm_per_s(float m_per_s) {
   return m_per_s * 1000.0;
@@ -41,6 +48,17 @@ float calculate_turn_duration_s(float angle_rad, float wheelbase_mm, float speed
   return (angle_rad * wheelbase_mm) / (2.0f * speed_mm_per_s);
 }
 
+// Fletcher-16: two running sums mod 255, sensitive to byte order unlike a plain sum
+uint16_t calculate_checksum(const uint8_t* data, uint16_t length) {
+  uint16_t sum1 = 0;
+  uint16_t sum2 = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    sum1 = (sum1 + data[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  return (sum2 << 8) | sum1;
+}
+
 // ========== Odometry math helpers ==========
 
 float compute_delta_l(int32_t leftCountsDelta, float wheelDiameterL, float leftCountsPerWheelRev) {
@@ -58,3 +76,59 @@ float compute_delta_x(float delta_l, float delta_r, float theta) {
 float compute_delta_y(float delta_l, float delta_r, float theta) {
   return (delta_l + delta_r) / 2.0f * sinf(theta);
 }
+
+// ========== Fixed-point trigonometry ==========
+
+// sin(i * 90 deg / 128) in Q15, i = 0..128 (the last entry saturates at 32767)
+static const int16_t SIN_QUARTER_Q15[129] PROGMEM = {
+  0, 402, 804, 1206, 1608, 2009, 2411, 2811,
+  3212, 3612, 4011, 4410, 4808, 5205, 5602, 5998,
+  6393, 6787, 7180, 7571, 7962, 8351, 8740, 9127,
+  9512, 9896, 10279, 10660, 11039, 11417, 11793, 12167,
+  12540, 12910, 13279, 13646, 14010, 14373, 14733, 15091,
+  15447, 15800, 16151, 16500, 16846, 17190, 17531, 17869,
+  18205, 18538, 18868, 19195, 19520, 19841, 20160, 20475,
+  20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884,
+  23170, 23453, 23732, 24008, 24279, 24548, 24812, 25073,
+  25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020,
+  27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707,
+  28899, 29086, 29269, 29448, 29622, 29792, 29957, 30118,
+  30274, 30425, 30572, 30715, 30853, 30986, 31114, 31238,
+  31357, 31471, 31581, 31686, 31786, 31881, 31972, 32058,
+  32138, 32214, 32286, 32352, 32413, 32470, 32522, 32568,
+  32610, 32647, 32679, 32706, 32729, 32746, 32758, 32766,
+  32767,
+};
+
+// Quarter-wave lookup: position 0..16384 within the first quadrant
+static int16_t sin_quarter_q15(uint16_t position) {
+  uint8_t index = position >> 7;
+  int16_t low = (int16_t)pgm_read_word(&SIN_QUARTER_Q15[index]);
+  uint8_t fraction = position & 0x7F;
+  if (fraction == 0) {
+    return low;
+  }
+  int16_t high = (int16_t)pgm_read_word(&SIN_QUARTER_Q15[index + 1]);
+  return low + (int16_t)(((int32_t)(high - low) * fraction + 64) >> 7);
+}
+
+int16_t sin_q15(uint16_t angle) {
+  uint16_t position = angle & 0x3FFF;
+  uint8_t quadrant = angle >> 14;
+
+  // Quadrants 1 and 3 mirror the table, 2 and 3 negate it.
+  int16_t value = (quadrant & 1) ? sin_quarter_q15(0x4000 - position) : sin_quarter_q15(position);
+  return (quadrant & 2) ? -value : value;
+}
+
+int16_t cos_q15(uint16_t angle) {
+  return sin_q15(angle + 0x4000);
+}
+
+int32_t multiply_q15(int32_t a, int16_t b) {
+  // a = high * 2^15 + low with 0 <= low < 2^15, so both partial products fit in 32 bits.
+  // Rounded, not truncated: odometry sums thousands of these and a floor would bias the pose.
+  int32_t high = a >> 15;
+  int32_t low = a & 0x7FFF;
+  return high * b + ((low * b + 0x4000) >> 15);
+}
@@ -10,14 +10,14 @@
 
 // Utility functions for unit conversions
 int convert_speed_to_mm_per_s(float speed, float base_speed);
-int convert_duration_to_ms(float duration);
+unsigned long convert_duration_to_ms(float duration);
 int calculate_duration_ms(float distance, float speed, float base_speed);
 
 // Utility function for calculating inner wheel speed for curved motion
 int calculate_inner_speed(int outer_speed_mm_per_s, float turn_speed_ratio);
 
 // Utility function for calculating motion duration in milliseconds
-int calculate_motion_duration_ms(float distance_m, float speed_m_per_s);
+unsigned long calculate_motion_duration_ms(float distance_m, float speed_m_per_s);
 
 // Utility function for boundary validation - returns false if out of bounds
 bool validate_float(float value, float min, float max);
@@ -53,5 +53,18 @@ float mm_per_s_to_meters_per_s(float mm_per_s);
 // Using formula: theta = (2*v/L) * t => t = theta * L / (2*v)
 float calculate_turn_duration_s(float angle_rad, float wheelbase_mm, float speed_mm_per_s);
 
+// Fletcher-16 checksum of a byte buffer, used to validate records stored in EEPROM
+uint16_t calculate_checksum(const uint8_t* data, uint16_t length);
+
+// Fixed-point trigonometry for the integer odometry kernel
+// Angles are binary angles: 65536 = one full turn (uint16_t wraps like the angle does).
+// Results are Q15 (32767 = 1.0), from a quarter-wave table in flash with linear
+// interpolation; worst-case error about 2e-5, well below one Q15 step.
+int16_t sin_q15(uint16_t angle);
+int16_t cos_q15(uint16_t angle);
+
+// Multiply a 32-bit value by a Q15 factor without a 64-bit product: a * b / 32768
+int32_t multiply_q15(int32_t a, int16_t b);
+
 
 #endif
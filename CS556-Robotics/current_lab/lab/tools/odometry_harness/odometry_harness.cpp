@@ -0,0 +1,178 @@
+// ============================================================
+// ODOMETRY INTEGRATION HARNESS (host)
+// ============================================================
+//
+// Purpose: Show how pose error depends on the odometry update rate for each
+//   integration scheme, using the robot's own integrate_pose_step()
+//
+// Description:
+//   A reference robot drives a course from (v, ω) commands. Its true pose is
+//   integrated in double precision at 10 kHz; its wheel travel is quantised to
+//   encoder counts exactly like the 3pi+ encoders. At each update rate the
+//   counts are fed to integrate_pose_step() the way Odometry::update_odom()
+//   does, and the position error against the true pose is recorded.
+//
+// Courses:
+//   - arcs:    lines and arcs of different radii (piecewise constant curvature)
+//   - slalom:  sinusoidal turn rate (curvature changes continuously)
+//
+// Output: one table per course, rows = update rate, columns = scheme,
+//   cells = final / maximum position error [cm]. The "segments" row updates
+//   once per course segment, like a Navigator::update() after each motion.
+//
+// ============================================================
+
+#include <math.h>
+#include <stdio.h>
+
+#include "pose_integration.h"
+
+// Match odometer/odometry.h
+static const double WHEEL_DIAMETER_CM = 3.2;
+static const double COUNTS_PER_WHEEL_REV = 12.0 * 75.0;
+static const double WHEELBASE_CM = 9.6;
+static const double CM_PER_COUNT = M_PI * WHEEL_DIAMETER_CM / COUNTS_PER_WHEEL_REV;
+
+static const double SIM_DT_S = 1.0e-4;
+
+struct Segment {
+  double duration_s;
+  double speed_cm_per_s;
+  double turn_rate_rad_per_s;   // Constant part of ω
+  double slalom_rad_per_s;      // Amplitude of the sinusoidal part of ω
+  double slalom_hz;
+};
+
+struct Course {
+  const char *name;
+  const Segment *segments;
+  int count;
+};
+
+static const Segment ARCS[] = {
+  {2.5, 20.0, 0.0, 0.0, 0.0},          // 50 cm line
+  {2.36, 20.0, 20.0 / 30.0, 0.0, 0.0}, // left 90 deg, R = 30 cm
+  {3.93, 20.0, -20.0 / 50.0, 0.0, 0.0},// right 90 deg, R = 50 cm
+  {1.5, 0.0, 1.5, 0.0, 0.0},           // spin in place
+  {4.71, 15.0, 15.0 / 22.5, 0.0, 0.0}, // left 180 deg, R = 22.5 cm
+  {2.5, 20.0, 0.0, 0.0, 0.0},          // 50 cm line
+};
+
+static const Segment SLALOM[] = {
+  {20.0, 20.0, 0.0, 1.5, 0.25},
+};
+
+static const Course COURSES[] = {
+  {"arcs", ARCS, sizeof(ARCS) / sizeof(ARCS[0])},
+  {"slalom", SLALOM, sizeof(SLALOM) / sizeof(SLALOM[0])},
+};
+
+static const double RATES_HZ[] = {500.0, 200.0, 100.0, 50.0, 20.0, 10.0, 5.0, 2.0, 1.0};
+
+static const OdometryIntegration SCHEMES[] = {
+  OdometryIntegration::EULER,
+  OdometryIntegration::MIDPOINT,
+  OdometryIntegration::EXACT_ARC,
+};
+static const char *SCHEME_NAMES[] = {"EULER", "MIDPOINT", "EXACT_ARC"};
+static const int SCHEME_COUNT = 3;
+
+struct Result {
+  double final_cm;
+  double max_cm;
+};
+
+// Odometry as the robot runs it: float state, counts in, integrate_pose_step() per update.
+struct Estimator {
+  OdometryIntegration scheme;
+  long left_prev;
+  long right_prev;
+  float x;
+  float y;
+  float theta;
+
+  void update(long left, long right) {
+    float delta_l = (float)((left - left_prev) * CM_PER_COUNT);
+    float delta_r = (float)((right - right_prev) * CM_PER_COUNT);
+    left_prev = left;
+    right_prev = right;
+
+    float rotation = (delta_r - delta_l) / (float)WHEELBASE_CM;
+    float dx, dy;
+    integrate_pose_step(scheme, theta, (delta_l + delta_r) / 2.0f, rotation, dx, dy);
+    theta += rotation;
+    x += dx;
+    y += dy;
+  }
+};
+
+// Drive the course; update every period_s (or at segment ends if period_s <= 0).
+static Result run_course(const Course &course, OdometryIntegration scheme, double period_s) {
+  Estimator estimator = {scheme, 0, 0, 0.0f, 0.0f, 0.0f};
+  double x = 0.0, y = 0.0, theta = 0.0;
+  double left_cm = 0.0, right_cm = 0.0;
+  double t = 0.0;
+  double next_update_s = period_s;
+  Result result = {0.0, 0.0};
+
+  for (int s = 0; s < course.count; s++) {
+    const Segment &segment = course.segments[s];
+    long steps = lround(segment.duration_s / SIM_DT_S);
+
+    for (long i = 0; i < steps; i++) {
+      double omega = segment.turn_rate_rad_per_s +
+                     segment.slalom_rad_per_s * sin(2.0 * M_PI * segment.slalom_hz * (t + 0.5 * SIM_DT_S));
+      double v = segment.speed_cm_per_s;
+
+      // Exact arc over the sub-step.
+      double rotation = omega * SIM_DT_S;
+      double chord = v * SIM_DT_S * (fabs(rotation) > 1e-12 ? sin(rotation / 2.0) / (rotation / 2.0) : 1.0);
+      x += chord * cos(theta + rotation / 2.0);
+      y += chord * sin(theta + rotation / 2.0);
+      theta += rotation;
+      left_cm += (v - omega * WHEELBASE_CM / 2.0) * SIM_DT_S;
+      right_cm += (v + omega * WHEELBASE_CM / 2.0) * SIM_DT_S;
+      t += SIM_DT_S;
+
+      bool update = period_s > 0.0 ? t >= next_update_s - 1e-9 : i == steps - 1;
+      if (update) {
+        next_update_s += period_s;
+        estimator.update(lround(floor(left_cm / CM_PER_COUNT)), lround(floor(right_cm / CM_PER_COUNT)));
+        double error = hypot(estimator.x - x, estimator.y - y);
+        if (error > result.max_cm) {
+          result.max_cm = error;
+        }
+        result.final_cm = error;
+      }
+    }
+  }
+  return result;
+}
+
+static void print_row(const char *label, const Course &course, double period_s) {
+  printf("%-10s", label);
+  for (int k = 0; k < SCHEME_COUNT; k++) {
+    Result r = run_course(course, SCHEMES[k], period_s);
+    printf("  %8.3f / %8.3f", r.final_cm, r.max_cm);
+  }
+  printf("\n");
+}
+
+int main() {
+  for (const Course &course : COURSES) {
+    printf("\ncourse: %s  (position error, final / max [cm])\n", course.name);
+    printf("%-10s", "rate");
+    for (int k = 0; k < SCHEME_COUNT; k++) {
+      printf("  %19s", SCHEME_NAMES[k]);
+    }
+    printf("\n");
+
+    for (double rate : RATES_HZ) {
+      char label[16];
+      snprintf(label, sizeof(label), "%g Hz", rate);
+      print_row(label, course, 1.0 / rate);
+    }
+    print_row("segments", course, 0.0);
+  }
+  return 0;
+}
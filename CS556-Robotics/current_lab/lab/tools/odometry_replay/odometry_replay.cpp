@@ -0,0 +1,460 @@
+// ============================================================
+// ODOMETRY REPLAY ENGINE (host)
+// ============================================================
+//
+// Purpose: Re-run the robot's own pose estimation on recorded encoder/gyro
+//   logs with other wheel geometry, kernels and heading sources, without
+//   reflashing or re-driving the robot
+//
+// Description:
+//   Odometry, HeadingEstimator and util.cpp are compiled unchanged against the
+//   stub headers in stubs/. micros() and the gyro reading are per-thread replay
+//   state, so every worker thread replays its own log. Each (log, parameter
+//   combination) pair is one job; a pool of std::threads (one per core by
+//   default) pulls jobs from an atomic counter.
+//
+// Log format (test_4_9_record_replay_log prints it; lines without "replay:"
+// are skipped, so a raw serial capture can be used as-is):
+//   replay: t_us,left_counts,right_counts,gyro_z_lsb     one sample
+//   replay: # truth x y                                  measured end position [cm]
+//   replay: # <anything else>                            comment
+//   The "replay: " prefix is optional in files that contain nothing else.
+//
+// Parameters (value, list a,b,c or range from:to:step):
+//   --diameter   mean wheel diameter [cm]         (default 3.2)
+//   --ratio      right/left diameter ratio        (default 1)
+//   --wheelbase  wheelbase [cm]                   (default 9.6)
+//   --scheme     euler,midpoint,exact_arc         (default exact_arc)
+//   --kernel     float,fixed                      (default float)
+//   --heading    encoders,imu                     (default encoders)
+//
+// Output:
+//   - Logs with a truth line: combinations ranked by RMS end-position error
+//     over those logs (--top N, default 10)
+//   - --csv: the end pose of every (log, combination), for plotting
+//
+// Synthetic logs: --generate DIR COUNT writes COUNT logs of random squares
+//   driven by a robot with known wheel errors (see generate_log()), with truth
+//   lines, to try the tool without a robot.
+//
+// ============================================================
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "heading_estimator.h"
+#include "logger.h"
+#include "odometry.h"
+
+// ========== LOGS ==========
+
+struct Sample {
+  unsigned long t_us;
+  long left;
+  long right;
+  int gyro_z_lsb;
+};
+
+struct ReplayLog {
+  std::string name;
+  std::vector<Sample> samples;
+  bool has_truth;
+  double truth_x;
+  double truth_y;
+};
+
+static bool load_log(const std::string &path, ReplayLog &log) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path.c_str());
+    return false;
+  }
+
+  log.name = path;
+  log.samples.clear();
+  log.has_truth = false;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    const char *text = line.c_str();
+    const char *tag = strstr(text, "replay:");
+    if (tag != nullptr) {
+      text = tag + strlen("replay:");
+    }
+    while (*text == ' ' || *text == '\t') {
+      text++;
+    }
+
+    Sample sample;
+    if (sscanf(text, "# truth %lf %lf", &log.truth_x, &log.truth_y) == 2) {
+      log.has_truth = true;
+    } else if (sscanf(text, "%lu,%ld,%ld,%d", &sample.t_us, &sample.left, &sample.right, &sample.gyro_z_lsb) == 4) {
+      log.samples.push_back(sample);
+    }
+  }
+
+  if (log.samples.size() < 2) {
+    fprintf(stderr, "%s: no samples\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// ========== PARAMETERS ==========
+
+struct Parameters {
+  double diameter_cm;
+  double ratio;
+  double wheelbase_cm;
+  OdometryIntegration scheme;
+  OdometryMode kernel;
+  bool imu_heading;
+};
+
+struct EndPose {
+  float x;
+  float y;
+  float theta;
+};
+
+static const char *scheme_name(OdometryIntegration scheme) {
+  switch (scheme) {
+    case OdometryIntegration::EULER: return "euler";
+    case OdometryIntegration::MIDPOINT: return "midpoint";
+    default: return "exact_arc";
+  }
+}
+
+// "3.2", "9.5,9.6" or "9.4:9.8:0.05"
+static bool parse_values(const char *text, std::vector<double> &values) {
+  values.clear();
+  double from, to, step;
+  char tail;
+  if (sscanf(text, "%lf:%lf:%lf%c", &from, &to, &step, &tail) == 3) {
+    if (step <= 0.0 || to < from) {
+      return false;
+    }
+    for (long i = 0; from + i * step <= to + 1.0e-9; i++) {
+      values.push_back(from + i * step);
+    }
+    return true;
+  }
+
+  std::stringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    char *end;
+    double value = strtod(item.c_str(), &end);
+    if (end == item.c_str() || *end != '\0') {
+      return false;
+    }
+    values.push_back(value);
+  }
+  return !values.empty();
+}
+
+template <typename T>
+static bool parse_names(const char *text, const char *const *names, const T *choices, size_t count, std::vector<T> &values) {
+  values.clear();
+  std::stringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    size_t i = 0;
+    while (i < count && item != names[i]) {
+      i++;
+    }
+    if (i == count) {
+      return false;
+    }
+    values.push_back(choices[i]);
+  }
+  return !values.empty();
+}
+
+// ========== REPLAY ==========
+
+// Same sequence as Navigator::update(), once per logged sample.
+static EndPose replay(const ReplayLog &log, const Parameters &p) {
+  OdometryGeometry geometry;
+  geometry.diameter_left_cm = (float)(2.0 * p.diameter_cm / (1.0 + p.ratio));
+  geometry.diameter_right_cm = (float)(p.ratio * geometry.diameter_left_cm);
+  geometry.wheelbase_cm = (float)p.wheelbase_cm;
+
+  const Sample &first = log.samples[0];
+  replay_clock_us = first.t_us;
+  replay_gyro_z_lsb = (int16_t)first.gyro_z_lsb;
+
+  Odometry odometry;
+  odometry.set_geometry(geometry);
+  odometry.set_integration(p.scheme);
+  odometry.set_mode(p.kernel, 0.0f, 0.0f, 0.0f);
+
+  HeadingEstimator heading;
+  heading.set_geometry(geometry);
+  heading.begin();
+
+  EndPose pose = {0.0f, 0.0f, 0.0f};
+  long previous_left = 0;
+  long previous_right = 0;
+  for (size_t i = 1; i < log.samples.size(); i++) {
+    const Sample &s = log.samples[i];
+    replay_clock_us = s.t_us;
+    replay_gyro_z_lsb = (int16_t)s.gyro_z_lsb;
+
+    long left = s.left - first.left;
+    long right = s.right - first.right;
+    heading.update((int32_t)(left - previous_left), (int32_t)(right - previous_right));
+    previous_left = left;
+    previous_right = right;
+
+    if (p.imu_heading) {
+      odometry.update_odom_heading((int32_t)left, (int32_t)right, heading.get_heading(), pose.x, pose.y, pose.theta);
+    } else {
+      odometry.update_odom((int32_t)left, (int32_t)right, pose.x, pose.y, pose.theta);
+    }
+  }
+  return pose;
+}
+
+// ========== SYNTHETIC LOGS ==========
+
+// Robot with the errors UMBmark looks for: unequal wheels and a wider
+// wheelbase than nominal; the controller drives by nominal encoder counts.
+static const double TRUE_DIAMETER_L_CM = 3.19;
+static const double TRUE_DIAMETER_R_CM = 3.21;
+static const double TRUE_WHEELBASE_CM = 9.75;
+static const double TRUE_GYRO_BIAS_LSB = 20.0;
+static const double COUNTS_PER_REV = N_L * GEAR_RATIO;
+
+static bool generate_log(const std::string &path, unsigned seed) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return false;
+  }
+
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> side_cm(50.0, 150.0);
+  std::normal_distribution<double> gyro_noise(0.0, 3.0);
+  double turn_sign = (seed % 2 == 0) ? 1.0 : -1.0;
+  double side = side_cm(random);
+
+  // Commanded wheel rates in counts/s per phase: still, then line/turn x 4.
+  const double count_cm = M_PI * DIA_L / COUNTS_PER_REV;
+  const double line_rate = 20.0 / count_cm;
+  const double turn_counts = 0.25 * M_PI * W / count_cm;
+  struct Phase { double duration_s; double left_rate; double right_rate; };
+  std::vector<Phase> phases;
+  phases.push_back({2.0, 0.0, 0.0});
+  for (int i = 0; i < 4; i++) {
+    phases.push_back({side / 20.0, line_rate, line_rate});
+    phases.push_back({turn_counts / line_rate, -turn_sign * line_rate, turn_sign * line_rate});
+  }
+  phases.push_back({0.5, 0.0, 0.0});
+
+  fprintf(file, "# synthetic square, side %.1f cm, %s\n", side, turn_sign > 0 ? "ccw" : "cw");
+  const double dt = 1.0e-3;
+  double left = 0.0, right = 0.0, x = 0.0, y = 0.0, theta = 0.0;
+  unsigned long t_us = 1000000UL + seed * 7919UL;
+  unsigned step = 0;
+  for (const Phase &phase : phases) {
+    long steps = lround(phase.duration_s / dt);
+    for (long k = 0; k < steps; k++, step++) {
+      double dl = phase.left_rate * dt;
+      double dr = phase.right_rate * dt;
+      double travel_l = dl * M_PI * TRUE_DIAMETER_L_CM / COUNTS_PER_REV;
+      double travel_r = dr * M_PI * TRUE_DIAMETER_R_CM / COUNTS_PER_REV;
+      double rotation = (travel_r - travel_l) / TRUE_WHEELBASE_CM;
+      double distance = 0.5 * (travel_l + travel_r);
+      x += distance * cos(theta + 0.5 * rotation);
+      y += distance * sin(theta + 0.5 * rotation);
+      theta += rotation;
+      left += dl;
+      right += dr;
+      t_us += 1000;
+
+      if (step % 10 == 0) {
+        double rate_dps = rotation / dt * 180.0 / M_PI;
+        long gyro = lround(rate_dps / GYRO_SENSITIVITY_DPS_PER_LSB + TRUE_GYRO_BIAS_LSB + gyro_noise(random));
+        fprintf(file, "%lu,%ld,%ld,%ld\n", t_us, (long)floor(left), (long)floor(right), gyro);
+      }
+    }
+  }
+  fprintf(file, "# truth %.3f %.3f\n", x, y);
+  fclose(file);
+  return true;
+}
+
+// ========== MAIN ==========
+
+static void usage() {
+  fprintf(stderr,
+          "usage: odometry_replay [options] LOG...\n"
+          "       odometry_replay --generate DIR COUNT\n"
+          "  --diameter V  --ratio V  --wheelbase V   value, a,b,c or from:to:step\n"
+          "  --scheme euler,midpoint,exact_arc  --kernel float,fixed  --heading encoders,imu\n"
+          "  -j N threads (default: all cores)  --top N  --csv\n");
+}
+
+int main(int argc, char **argv) {
+  Logger::set_log_level(LogLevel::ERROR);
+
+  static const char *const scheme_names[] = {"euler", "midpoint", "exact_arc"};
+  static const OdometryIntegration scheme_choices[] = {OdometryIntegration::EULER, OdometryIntegration::MIDPOINT,
+                                                       OdometryIntegration::EXACT_ARC};
+  static const char *const kernel_names[] = {"float", "fixed"};
+  static const OdometryMode kernel_choices[] = {OdometryMode::FLOAT, OdometryMode::FIXED};
+  static const char *const heading_names[] = {"encoders", "imu"};
+  static const bool heading_choices[] = {false, true};
+
+  std::vector<double> diameters(1, DIA_L);
+  std::vector<double> ratios(1, 1.0);
+  std::vector<double> wheelbases(1, W);
+  std::vector<OdometryIntegration> schemes(1, DEFAULT_ODOMETRY_INTEGRATION);
+  std::vector<OdometryMode> kernels(1, DEFAULT_ODOMETRY_MODE);
+  std::vector<bool> headings(1, false);
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t top = 10;
+  bool csv = false;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    bool ok = true;
+    if (arg == "--generate" && i + 2 < argc) {
+      int count = atoi(argv[i + 2]);
+      for (int n = 0; n < count; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/square_%04d.csv", n);
+        if (!generate_log(std::string(argv[i + 1]) + name, (unsigned)n)) {
+          return 1;
+        }
+      }
+      printf("wrote %d logs to %s\n", count, argv[i + 1]);
+      return 0;
+    } else if (arg == "--diameter" && has_value) {
+      ok = parse_values(argv[++i], diameters);
+    } else if (arg == "--ratio" && has_value) {
+      ok = parse_values(argv[++i], ratios);
+    } else if (arg == "--wheelbase" && has_value) {
+      ok = parse_values(argv[++i], wheelbases);
+    } else if (arg == "--scheme" && has_value) {
+      ok = parse_names(argv[++i], scheme_names, scheme_choices, 3, schemes);
+    } else if (arg == "--kernel" && has_value) {
+      ok = parse_names(argv[++i], kernel_names, kernel_choices, 2, kernels);
+    } else if (arg == "--heading" && has_value) {
+      ok = parse_names(argv[++i], heading_names, heading_choices, 2, headings);
+    } else if (arg == "-j" && has_value) {
+      threads = (unsigned)std::max(1, atoi(argv[++i]));
+    } else if (arg == "--top" && has_value) {
+      top = (size_t)std::max(1, atoi(argv[++i]));
+    } else if (arg == "--csv") {
+      csv = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      ok = false;
+    } else {
+      paths.push_back(arg);
+    }
+    if (!ok) {
+      fprintf(stderr, "bad option: %s\n", arg.c_str());
+      usage();
+      return 1;
+    }
+  }
+  if (paths.empty()) {
+    usage();
+    return 1;
+  }
+
+  std::vector<ReplayLog> logs(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!load_log(paths[i], logs[i])) {
+      return 1;
+    }
+  }
+
+  std::vector<Parameters> combos;
+  for (double diameter : diameters)
+    for (double ratio : ratios)
+      for (double wheelbase : wheelbases)
+        for (OdometryIntegration scheme : schemes)
+          for (OdometryMode kernel : kernels)
+            for (bool imu : headings)
+              combos.push_back({diameter, ratio, wheelbase, scheme, kernel, imu});
+
+  // One job per (combination, log); results land in a preallocated slot, so no locking.
+  size_t jobs = combos.size() * logs.size();
+  std::vector<EndPose> results(jobs);
+  std::atomic<size_t> next(0);
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < std::min<size_t>(threads, jobs); t++) {
+    pool.emplace_back([&]() {
+      for (size_t job = next++; job < jobs; job = next++) {
+        results[job] = replay(logs[job % logs.size()], combos[job / logs.size()]);
+      }
+    });
+  }
+  for (std::thread &worker : pool) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (csv) {
+    printf("log,diameter,ratio,wheelbase,scheme,kernel,heading,x,y,theta\n");
+    for (size_t job = 0; job < jobs; job++) {
+      const Parameters &p = combos[job / logs.size()];
+      const EndPose &e = results[job];
+      printf("%s,%.4f,%.4f,%.4f,%s,%s,%s,%.3f,%.3f,%.5f\n", logs[job % logs.size()].name.c_str(), p.diameter_cm,
+             p.ratio, p.wheelbase_cm, scheme_name(p.scheme), p.kernel == OdometryMode::FIXED ? "fixed" : "float",
+             p.imu_heading ? "imu" : "encoders", e.x, e.y, e.theta);
+    }
+  }
+  fprintf(stderr, "%zu logs x %zu combinations = %zu replays on %zu threads in %.2f s\n", logs.size(), combos.size(),
+          jobs, pool.size(), seconds);
+
+  // Rank the combinations by RMS end error over the logs with a truth line.
+  std::vector<std::pair<double, size_t> > ranking;
+  for (size_t c = 0; c < combos.size(); c++) {
+    double sum_sq = 0.0;
+    size_t counted = 0;
+    for (size_t l = 0; l < logs.size(); l++) {
+      if (logs[l].has_truth) {
+        const EndPose &e = results[c * logs.size() + l];
+        sum_sq += pow(e.x - logs[l].truth_x, 2) + pow(e.y - logs[l].truth_y, 2);
+        counted++;
+      }
+    }
+    if (counted > 0) {
+      ranking.push_back(std::make_pair(sqrt(sum_sq / counted), c));
+    }
+  }
+  if (ranking.empty()) {
+    if (!csv) {
+      fprintf(stderr, "no truth lines: nothing to rank (use --csv for the end poses)\n");
+    }
+    return 0;
+  }
+
+  std::sort(ranking.begin(), ranking.end());
+  FILE *out = csv ? stderr : stdout;
+  fprintf(out, "%10s %8s %8s %10s %10s %7s %9s\n", "rms [cm]", "diameter", "ratio", "wheelbase", "scheme", "kernel", "heading");
+  for (size_t i = 0; i < std::min(top, ranking.size()); i++) {
+    const Parameters &p = combos[ranking[i].second];
+    fprintf(out, "%10.3f %8.4f %8.4f %10.4f %10s %7s %9s\n", ranking[i].first, p.diameter_cm, p.ratio, p.wheelbase_cm,
+            scheme_name(p.scheme), p.kernel == OdometryMode::FIXED ? "fixed" : "float", p.imu_heading ? "imu" : "encoders");
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+// Host stand-in for the Arduino core: just what the odometry sources use.
+// Time and the gyro come from per-thread replay state, so every worker
+// thread replays its own log independently.
+#ifndef replay_arduino_h
+#define replay_arduino_h
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+
+extern thread_local unsigned long replay_clock_us;  // micros() of the sample being replayed
+
+inline unsigned long micros() { return replay_clock_us; }
+inline unsigned long millis() { return replay_clock_us / 1000UL; }
+inline void delay(unsigned long) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// Logger output goes to stderr; only errors are enabled by the replay tool.
+class HostSerial {
+  public:
+    void begin(unsigned long) {}
+    int availableForWrite() { return 64; }
+    size_t write(const uint8_t *data, size_t length) { return fwrite(data, 1, length, stderr); }
+    operator bool() const { return true; }
+};
+extern HostSerial Serial;
+
+#endif
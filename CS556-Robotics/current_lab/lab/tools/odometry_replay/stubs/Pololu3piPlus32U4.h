@@ -0,0 +1,9 @@
+// Host stand-in: the odometry sources only need the namespace.
+#ifndef replay_pololu3piplus32u4_h
+#define replay_pololu3piplus32u4_h
+
+#include <Arduino.h>
+
+namespace Pololu3piPlus32U4 {}
+
+#endif
@@ -0,0 +1,28 @@
+// Host stand-in for the 3pi+ IMU: readGyro() returns the logged gyro sample.
+#ifndef replay_pololu3piplus32u4imu_h
+#define replay_pololu3piplus32u4imu_h
+
+#include <stdint.h>
+
+extern thread_local int16_t replay_gyro_z_lsb;  // Gyro z of the sample being replayed
+
+namespace Pololu3piPlus32U4 {
+
+class IMU {
+  public:
+    struct Vector {
+      int16_t x;
+      int16_t y;
+      int16_t z;
+    };
+
+    Vector g = {0, 0, 0};
+
+    bool init() { return true; }
+    void enableDefault() {}
+    void readGyro() { g.z = replay_gyro_z_lsb; }
+};
+
+}
+
+#endif
@@ -0,0 +1,12 @@
+// Host stand-in for the I2C bus used by HeadingEstimator::begin().
+#ifndef replay_wire_h
+#define replay_wire_h
+
+class TwoWire {
+  public:
+    void begin() {}
+    void setClock(unsigned long) {}
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,9 @@
+#include <Arduino.h>
+#include <Pololu3piPlus32U4IMU.h>
+#include <Wire.h>
+
+thread_local unsigned long replay_clock_us = 0;
+thread_local int16_t replay_gyro_z_lsb = 0;
+
+HostSerial Serial;
+TwoWire Wire;